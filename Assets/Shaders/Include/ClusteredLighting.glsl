@@ -0,0 +1,56 @@
+// Point lights binned per froxel by ClusteredLighting.cpp, bindings and layouts must match it.
+// Include after Lighting.glsl, the per light terms reuse its Phong functions.
+
+struct PointLight
+{
+	vec4 PositionRadius;	// world space position, reach
+	vec4 ColorIntensity;
+};
+
+layout (std430, binding = 0) readonly buffer ClusterLights { PointLight lights[]; };
+layout (std430, binding = 1) readonly buffer ClusterRanges { uvec2 clusters[]; };		// offset, count into lightIndices
+layout (std430, binding = 2) readonly buffer ClusterLightIndices { uint lightIndices[]; };
+
+uniform uvec3 clusterGrid;
+uniform float clusterScale;		// slice = log(view depth) * clusterScale + clusterBias
+uniform float clusterBias;
+uniform vec2 clusterViewport;
+uniform mat4 clusterView;
+
+uint GetClusterIndex(vec3 worldPos)
+{
+	float depth = -(clusterView * vec4(worldPos, 1.0)).z;
+	uint slice = uint(clamp(floor(log(depth) * clusterScale + clusterBias), 0.0, float(clusterGrid.z - 1u)));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterViewport * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+
+	return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+// Smooth window so a light fades out to exactly nothing at its radius
+float PointLightAttenuation(float lightDistance, float radius)
+{
+	float window = clamp(1.0 - pow(lightDistance / radius, 4.0), 0.0, 1.0);
+	return window * window / (lightDistance * lightDistance + 1.0);
+}
+
+// Adds every light of the fragment's cluster, specular only when the variant has FEATURE_SPECULAR
+void AddClusteredLights(vec3 worldPos, vec3 norm, vec3 viewDir, float specularStrength, inout vec3 diffuse, inout vec3 specular)
+{
+	uvec2 range = clusters[GetClusterIndex(worldPos)];
+
+	for (uint i = 0u; i < range.y; i++) {
+		PointLight light = lights[lightIndices[range.x + i]];
+		vec3 toLight = light.PositionRadius.xyz - worldPos;
+		float lightDistance = length(toLight);
+		if (lightDistance >= light.PositionRadius.w) {
+			continue;
+		}
+
+		vec3 lightDir = toLight / lightDistance;
+		vec3 lightColor = light.ColorIntensity.rgb * (light.ColorIntensity.w * PointLightAttenuation(lightDistance, light.PositionRadius.w));
+		diffuse += DiffuseLight(norm, lightDir, lightColor);
+#ifdef FEATURE_SPECULAR
+		specular += SpecularLight(norm, lightDir, viewDir, lightColor, specularStrength);
+#endif
+	}
+}
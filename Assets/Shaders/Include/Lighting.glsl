@@ -0,0 +1,19 @@
+// Phong terms shared by the lit shaders, every vector is in world space and normalized
+
+vec3 AmbientLight(vec3 lightColor, float ambientStrength)
+{
+	return ambientStrength * lightColor;
+}
+
+vec3 DiffuseLight(vec3 norm, vec3 lightDir, vec3 lightColor)
+{
+	float diff = max(dot(norm, lightDir), 0.0);
+	return diff * lightColor;
+}
+
+vec3 SpecularLight(vec3 norm, vec3 lightDir, vec3 viewDir, vec3 lightColor, float specularStrength)
+{
+	vec3 reflectionDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectionDir), 0.0), 128);
+	return specularStrength * spec * lightColor;
+}
@@ -1,5 +1,12 @@
 #version 450 core
 
+// Variants: FEATURE_TEXTURE samples the albedo, FEATURE_SPECULAR adds the highlight,
+// FEATURE_CLUSTERED adds the point lights of the fragment's cluster
+#include "Include/Lighting.glsl"
+#ifdef FEATURE_CLUSTERED
+#include "Include/ClusteredLighting.glsl"
+#endif
+
 in vec2 TexCoord;
 in vec3 Normal;
 in vec3 fragWorldPos;
@@ -11,37 +18,38 @@ uniform vec3 lightColor;
 uniform float specularStrength;
 uniform float ambientStrength;
 
+#ifdef FEATURE_TEXTURE
 // texture
 uniform sampler2D Texture;
+#endif
 
 out vec4 color;
 
 void main(){
 		
-		//color = texture(Texture, TexCoord);
-		
 		vec3 norm = normalize(Normal);
+#ifdef FEATURE_TEXTURE
 		vec4 objColor = texture(Texture, TexCoord);
+#else
+		vec4 objColor = vec4(1.0);
+#endif
 
-		//**ambient
-		vec3 ambient = ambientStrength * lightColor;
-		
-		//**diffuse
 		vec3 lightDir = normalize(lightPos - fragWorldPos);
-		float diff = max(dot(norm, lightDir), 0.0);
-		vec3 diffuse = diff * lightColor;
-		
-		//**specular 
+		vec3 light = AmbientLight(lightColor, ambientStrength) + DiffuseLight(norm, lightDir, lightColor);
+
+		// Highlight is added on top of the surface color rather than tinted by it
+		vec3 specular = vec3(0.0);
+#ifdef FEATURE_SPECULAR
 		vec3 viewDir = normalize(cameraPos - fragWorldPos);
-		vec3 reflectionDir = reflect(-lightDir, norm);
-		float spec = pow(max(dot(viewDir, reflectionDir),0.0),128);
-		vec3 specular = specularStrength * spec * lightColor;
-		
-		// lighting calculation
-		
+		specular = SpecularLight(norm, lightDir, viewDir, lightColor, specularStrength);
+#else
+		vec3 viewDir = vec3(0.0);
+#endif
 
-		vec3 totalColor = (ambient + diffuse) * objColor.rgb;
+#ifdef FEATURE_CLUSTERED
+		AddClusteredLights(fragWorldPos, norm, viewDir, specularStrength, light, specular);
+#endif
 
-		color = vec4(totalColor, 1.0f);
+		color = vec4(light * objColor.rgb + specular, 1.0f);
 		
-}
\ No newline at end of file
+}
@@ -0,0 +1,40 @@
+#version 450 core
+
+#include "Include/VertexPacking.glsl"
+
+// PackedVertex layout, see VertexPacking.h
+layout (location = 0) in vec3 position;		// unorm16, 0..1 inside the mesh bounds
+layout (location = 1) in vec2 texCoord;		// half float
+layout (location = 2) in vec2 octNormal;	// octahedral snorm16
+
+#ifdef FEATURE_INSTANCING
+layout (location = 3) in mat4 instanceModel;	// locations 3 to 6, one per instance
+#else
+uniform mat4 model;
+#endif
+
+uniform mat4 vp;
+
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 fragWorldPos;
+
+void main()
+{
+#ifdef FEATURE_INSTANCING
+	mat4 modelMatrix = instanceModel;
+#else
+	mat4 modelMatrix = model;
+#endif
+
+	vec3 localPos = boundsMin + position * boundsExtent;
+
+	gl_Position = vp * modelMatrix * vec4(localPos, 1.0);
+
+	fragWorldPos = vec3(modelMatrix * vec4(localPos, 1.0));
+	Normal = mat3(transpose(inverse(modelMatrix))) * DecodeOctahedral(octNormal);
+	TexCoord = texCoord;
+}
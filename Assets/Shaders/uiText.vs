@@ -0,0 +1,16 @@
+#version 450 core
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec4 vertexColor;
+
+out vec2 TexCoords;
+out vec4 TextColor;
+
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+    TexCoords = texCoord;
+    TextColor = vertexColor;
+}
@@ -0,0 +1,15 @@
+#version 450 core
+in vec2 TexCoords;
+in vec4 TextColor;
+out vec4 color;
+
+uniform sampler2D text;
+
+void main()
+{    
+    // 0.5 is the glyph edge, fwidth keeps the antialiased band one pixel wide at any scale
+    float distance = texture(text, TexCoords).r;
+    float width = fwidth(distance);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    color = vec4(TextColor.rgb, TextColor.a * alpha);
+}
@@ -0,0 +1,424 @@
+#include "ClusteredLighting.h"
+
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+#include "GLCallStats.h"
+
+// Shader storage bindings, must match Include/ClusteredLighting.glsl
+static const GLuint kLightBinding = 0;
+static const GLuint kClusterBinding = 1;
+static const GLuint kLightIndexBinding = 2;
+
+static const GLuint kClusterGridUniform = CommandBuffer::getUniformId("clusterGrid");
+static const GLuint kClusterScaleUniform = CommandBuffer::getUniformId("clusterScale");
+static const GLuint kClusterBiasUniform = CommandBuffer::getUniformId("clusterBias");
+static const GLuint kClusterViewportUniform = CommandBuffer::getUniformId("clusterViewport");
+static const GLuint kClusterViewUniform = CommandBuffer::getUniformId("clusterView");
+
+// Below this binning costs less than starting the workers
+static const size_t kMinThreadedLights = 256;
+
+static const uint32_t kClustersPerSlice = ClusteredLighting::kClustersX * ClusteredLighting::kClustersY;
+
+const uint32_t ClusteredLighting::kClustersX;
+const uint32_t ClusteredLighting::kClustersY;
+const uint32_t ClusteredLighting::kClustersZ;
+const uint32_t ClusteredLighting::kClusterCount;
+
+glm::vec2 ClusteredLighting::viewportSize = glm::vec2(800.0f, 600.0f);
+
+static uint32_t GetTile(float _ndc, uint32_t _tiles)
+{
+	const float kTile = std::floor((_ndc * 0.5f + 0.5f) * _tiles);
+	return static_cast<uint32_t>(std::min(std::max(kTile, 0.0f), static_cast<float>(_tiles - 1)));
+}
+
+static void UploadBuffer(GLuint _buffer, size_t _bytes, const void* _data)
+{
+	// Never empty so the binding stays valid, new storage every frame so the driver doesn't wait on last frame's draws
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(_bytes, 16), _bytes > 0 ? _data : nullptr, GL_DYNAMIC_DRAW);
+
+	return;
+}
+
+// Public //
+
+ClusteredLighting::ClusteredLighting()
+{
+	this->clusters.resize(kClusterCount);
+	this->boxes.resize(kClusterCount);
+	this->view = glm::mat4(1.0f);
+	this->boxProjection = glm::mat4(0.0f);
+	this->nearPlane = 0.0f;
+	this->farPlane = 0.0f;
+	this->sliceScale = 0.0f;
+	this->sliceBias = 0.0f;
+	this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+	this->stats = { 0, 0, 0, 0, 0, 0.0f };
+
+	// Created on the first upload so binning alone needs no context
+	this->lightBuffer = 0;
+	this->clusterBuffer = 0;
+	this->indexBuffer = 0;
+
+	return;
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	if (lightBuffer != 0) {
+		glDeleteBuffers(1, &lightBuffer);
+		glDeleteBuffers(1, &clusterBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+
+	return;
+}
+
+void ClusteredLighting::AddLight(const PointLight& _light)
+{
+	lights.push_back(_light);
+	return;
+}
+
+void ClusteredLighting::ClearLights()
+{
+	lights.clear();
+	return;
+}
+
+void ClusteredLighting::Update(const Camera* _camera)
+{
+	Bin(_camera->GetViewMatrix(), _camera->GetProjectionMatrix());
+	Upload();
+
+	return;
+}
+
+void ClusteredLighting::Bin(const glm::mat4& _view, const glm::mat4& _projection)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	this->view = _view;
+	if (_projection != boxProjection) {
+		BuildBoxes(_projection);
+	}
+	BuildBounds(_projection);
+
+	// Workers take interleaved depth slices, lights bunch up near the camera so contiguous ranges would be uneven
+	const unsigned int kWorkerCount = (bounds.size() < kMinThreadedLights) ? 1 : std::min(threadCount, kClustersZ);
+	workerIndices.resize(kWorkerCount);
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < kWorkerCount; i++) {
+		threads.push_back(std::thread(&ClusteredLighting::BinSlices, this, i, kWorkerCount));
+	}
+	BinSlices(0, kWorkerCount);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	// Each worker's offsets are local to its own list, rebase them onto the concatenated one
+	std::vector<uint32_t> bases(kWorkerCount, 0);
+	size_t indexCount = 0;
+	for (unsigned int i = 0; i < kWorkerCount; i++) {
+		bases[i] = static_cast<uint32_t>(indexCount);
+		indexCount += workerIndices[i].size();
+	}
+
+	lightIndices.resize(indexCount);
+	for (unsigned int i = 0; i < kWorkerCount; i++) {
+		if (!workerIndices[i].empty()) {
+			std::copy(workerIndices[i].begin(), workerIndices[i].end(), lightIndices.begin() + bases[i]);
+		}
+	}
+
+	stats.Lights = static_cast<uint32_t>(lights.size());
+	stats.VisibleLights = static_cast<uint32_t>(bounds.size());
+	stats.OccupiedClusters = 0;
+	stats.LightIndices = static_cast<uint32_t>(indexCount);
+	stats.MaxClusterLights = 0;
+
+	for (uint32_t z = 0; z < kClustersZ; z++) {
+		const uint32_t kBase = bases[z % kWorkerCount];
+		for (uint32_t i = z * kClustersPerSlice; i < (z + 1) * kClustersPerSlice; i++) {
+			clusters[i].Offset += kBase;
+			stats.OccupiedClusters += (clusters[i].Count > 0) ? 1 : 0;
+			stats.MaxClusterLights = std::max(stats.MaxClusterLights, clusters[i].Count);
+		}
+	}
+
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	stats.BinningMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	return;
+}
+
+void ClusteredLighting::Record(CommandBuffer& commands) const
+{
+	commands.BindStorageBuffer(kLightBinding, lightBuffer);
+	commands.BindStorageBuffer(kClusterBinding, clusterBuffer);
+	commands.BindStorageBuffer(kLightIndexBinding, indexBuffer);
+
+	commands.SetConstant(kClusterGridUniform, glm::uvec3(kClustersX, kClustersY, kClustersZ));
+	commands.SetConstant(kClusterScaleUniform, sliceScale);
+	commands.SetConstant(kClusterBiasUniform, sliceBias);
+	commands.SetConstant(kClusterViewportUniform, viewportSize);
+	commands.SetConstant(kClusterViewUniform, view);
+
+	return;
+}
+
+void ClusteredLighting::setThreadCount(unsigned int _threadCount)
+{
+	this->threadCount = std::max(1u, _threadCount);
+	return;
+}
+
+void ClusteredLighting::setViewportSize(glm::vec2 _viewportSize)
+{
+	viewportSize = _viewportSize;
+	return;
+}
+
+std::vector<PointLight>& ClusteredLighting::getLights()
+{
+	return lights;
+}
+
+const std::vector<LightCluster>& ClusteredLighting::getClusters() const
+{
+	return clusters;
+}
+
+const std::vector<uint32_t>& ClusteredLighting::getLightIndices() const
+{
+	return lightIndices;
+}
+
+const ClusterStats& ClusteredLighting::getStats() const
+{
+	return stats;
+}
+
+void ClusteredLighting::Benchmark(int _iterations)
+{
+	const size_t kLightCounts[4] = { 1000, 2000, 5000, 10000 };
+	const unsigned int kThreadCounts[2] = { 1, std::max(1u, std::thread::hardware_concurrency()) };
+
+	// Same camera as the game, lights scattered through the part of the level it sees
+	const Camera kCamera(45.0f, 800, 600, 0.1f, 100.0f, glm::vec3(0.0f, 4.0f, 30.0f));
+
+	for (size_t lightCount : kLightCounts) {
+		ClusteredLighting clusteredLighting;
+
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		for (size_t i = 0; i < lightCount; i++) {
+			const PointLight kLight = {
+				glm::vec3(position(random), unit(random) * 8.0f, position(random) - 10.0f), 1.0f + unit(random) * 3.0f,
+				glm::vec3(unit(random), unit(random), unit(random)), 1.0f
+			};
+			clusteredLighting.AddLight(kLight);
+		}
+
+		for (unsigned int threads : kThreadCounts) {
+			clusteredLighting.setThreadCount(threads);
+
+			double bestSeconds = 0.0;
+			for (int i = 0; i < std::max(1, _iterations); i++) {
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				clusteredLighting.Bin(kCamera.GetViewMatrix(), kCamera.GetProjectionMatrix());
+				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+				const double kSeconds = std::chrono::duration<double>(end - start).count();
+				bestSeconds = (i == 0) ? kSeconds : std::min(bestSeconds, kSeconds);
+			}
+
+			const ClusterStats& kStats = clusteredLighting.getStats();
+			std::cout << "Clustered Lighting : " << kStats.Lights << " lights"
+				<< " | " << threads << " threads"
+				<< " | " << kStats.VisibleLights << " visible"
+				<< " | " << kStats.OccupiedClusters << "/" << kClusterCount << " clusters lit"
+				<< " | " << kStats.LightIndices << " indices"
+				<< " | max " << kStats.MaxClusterLights << " per cluster"
+				<< " | best " << bestSeconds * 1000.0 << " ms" << std::endl;
+		}
+	}
+
+	return;
+}
+
+// Private //
+
+void ClusteredLighting::BuildBoxes(const glm::mat4& _projection)
+{
+	this->boxProjection = _projection;
+
+	// Planes straight from the matrix so the grid always agrees with what is rasterized
+	nearPlane = _projection[3][2] / (_projection[2][2] - 1.0f);
+	farPlane = _projection[3][2] / (_projection[2][2] + 1.0f);
+
+	// slice = log(depth) * scale + bias spreads the slices exponentially between the planes
+	const float kLogRatio = std::log(farPlane / nearPlane);
+	sliceScale = static_cast<float>(kClustersZ) / kLogRatio;
+	sliceBias = -std::log(nearPlane) * sliceScale;
+
+	const float kScaleX = 1.0f / _projection[0][0];
+	const float kScaleY = 1.0f / _projection[1][1];
+
+	for (uint32_t z = 0; z < kClustersZ; z++) {
+		const float kNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / kClustersZ);
+		const float kFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / kClustersZ);
+
+		for (uint32_t y = 0; y < kClustersY; y++) {
+			const float kMinY = (-1.0f + 2.0f * y / kClustersY) * kScaleY;
+			const float kMaxY = (-1.0f + 2.0f * (y + 1) / kClustersY) * kScaleY;
+
+			for (uint32_t x = 0; x < kClustersX; x++) {
+				const float kMinX = (-1.0f + 2.0f * x / kClustersX) * kScaleX;
+				const float kMaxX = (-1.0f + 2.0f * (x + 1) / kClustersX) * kScaleX;
+
+				// The tile widens with depth, the box has to cover both of its ends
+				ClusterBox& box = boxes[(z * kClustersY + y) * kClustersX + x];
+				box.Min = glm::vec3(std::min(kMinX * kNear, kMinX * kFar), std::min(kMinY * kNear, kMinY * kFar), -kFar);
+				box.Max = glm::vec3(std::max(kMaxX * kNear, kMaxX * kFar), std::max(kMaxY * kNear, kMaxY * kFar), -kNear);
+			}
+		}
+	}
+
+	return;
+}
+
+void ClusteredLighting::BuildBounds(const glm::mat4& _projection)
+{
+	bounds.clear();
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		const glm::vec3 kCenter = glm::vec3(view * glm::vec4(lights[i].Position, 1.0f));
+		const float kRadius = lights[i].Radius;
+		const float kDepth = -kCenter.z;
+
+		if (kDepth + kRadius < nearPlane || kDepth - kRadius > farPlane) {
+			continue;
+		}
+
+		// Projected extent of the sphere's view space box, its corners bound every point on screen
+		const float kMinDepth = std::max(kDepth - kRadius, nearPlane);
+		const float kMaxDepth = kDepth + kRadius;
+		float minNdc[2] = { 1.0f, 1.0f };
+		float maxNdc[2] = { -1.0f, -1.0f };
+
+		for (int axis = 0; axis < 2; axis++) {
+			const float kScale = _projection[axis][axis];
+			const float kExtents[4] = {
+				kScale * (kCenter[axis] - kRadius) / kMinDepth, kScale * (kCenter[axis] - kRadius) / kMaxDepth,
+				kScale * (kCenter[axis] + kRadius) / kMinDepth, kScale * (kCenter[axis] + kRadius) / kMaxDepth
+			};
+			minNdc[axis] = *std::min_element(kExtents, kExtents + 4);
+			maxNdc[axis] = *std::max_element(kExtents, kExtents + 4);
+		}
+
+		if (minNdc[0] > 1.0f || maxNdc[0] < -1.0f || minNdc[1] > 1.0f || maxNdc[1] < -1.0f) {
+			continue;
+		}
+
+		LightBounds lightBounds;
+		lightBounds.Center = kCenter;
+		lightBounds.Radius = kRadius;
+		lightBounds.Light = static_cast<uint32_t>(i);
+		lightBounds.MinX = GetTile(minNdc[0], kClustersX);
+		lightBounds.MaxX = GetTile(maxNdc[0], kClustersX);
+		lightBounds.MinY = GetTile(minNdc[1], kClustersY);
+		lightBounds.MaxY = GetTile(maxNdc[1], kClustersY);
+		lightBounds.MinZ = GetSlice(kMinDepth);
+		lightBounds.MaxZ = GetSlice(std::min(kMaxDepth, farPlane));
+		bounds.push_back(lightBounds);
+	}
+
+	return;
+}
+
+void ClusteredLighting::BinSlices(unsigned int _worker, unsigned int _workerCount)
+{
+	std::vector<uint32_t>& indices = workerIndices[_worker];
+	indices.clear();
+
+	// Hits of one slice as (cluster in slice, light), counting sorted into the cluster ranges
+	std::vector<std::pair<uint32_t, uint32_t>> hits;
+	uint32_t counts[kClustersPerSlice];
+
+	for (uint32_t z = _worker; z < kClustersZ; z += _workerCount) {
+		hits.clear();
+		std::fill(counts, counts + kClustersPerSlice, 0u);
+
+		for (size_t i = 0; i < bounds.size(); i++) {
+			const LightBounds& kBounds = bounds[i];
+			if (z < kBounds.MinZ || z > kBounds.MaxZ) {
+				continue;
+			}
+
+			for (uint32_t y = kBounds.MinY; y <= kBounds.MaxY; y++) {
+				for (uint32_t x = kBounds.MinX; x <= kBounds.MaxX; x++) {
+					const uint32_t kCluster = y * kClustersX + x;
+					const ClusterBox& kBox = boxes[z * kClustersPerSlice + kCluster];
+
+					// Sphere against box, the tile range alone is too loose at the corners
+					const glm::vec3 kClosest = glm::clamp(kBounds.Center, kBox.Min, kBox.Max);
+					const glm::vec3 kDelta = kClosest - kBounds.Center;
+					if (glm::dot(kDelta, kDelta) <= kBounds.Radius * kBounds.Radius) {
+						hits.push_back(std::make_pair(kCluster, kBounds.Light));
+						counts[kCluster]++;
+					}
+				}
+			}
+		}
+
+		const size_t kFirst = indices.size();
+		uint32_t offset = static_cast<uint32_t>(kFirst);
+		for (uint32_t i = 0; i < kClustersPerSlice; i++) {
+			clusters[z * kClustersPerSlice + i].Offset = offset;
+			clusters[z * kClustersPerSlice + i].Count = counts[i];
+			offset += counts[i];
+		}
+
+		// Hits are in light order, so each cluster's list stays sorted
+		indices.resize(offset);
+		std::fill(counts, counts + kClustersPerSlice, 0u);
+		for (size_t i = 0; i < hits.size(); i++) {
+			const LightCluster& kCluster = clusters[z * kClustersPerSlice + hits[i].first];
+			indices[kCluster.Offset + counts[hits[i].first]++] = hits[i].second;
+		}
+	}
+
+	return;
+}
+
+void ClusteredLighting::Upload()
+{
+	if (lightBuffer == 0) {
+		glGenBuffers(1, &lightBuffer);
+		glGenBuffers(1, &clusterBuffer);
+		glGenBuffers(1, &indexBuffer);
+	}
+
+	UploadBuffer(lightBuffer, lights.size() * sizeof(PointLight), lights.empty() ? nullptr : &lights[0]);
+	UploadBuffer(clusterBuffer, clusters.size() * sizeof(LightCluster), &clusters[0]);
+	UploadBuffer(indexBuffer, lightIndices.size() * sizeof(uint32_t), lightIndices.empty() ? nullptr : &lightIndices[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	return;
+}
+
+uint32_t ClusteredLighting::GetSlice(float _depth) const
+{
+	const float kSlice = std::floor(std::log(_depth) * sliceScale + sliceBias);
+	return static_cast<uint32_t>(std::min(std::max(kSlice, 0.0f), static_cast<float>(kClustersZ - 1)));
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "Dependencies/glm/glm/glm.hpp"
+
+#include "Camera.h"
+#include "CommandBuffer.h"
+
+// Laid out like the std430 PointLight in Include/ClusteredLighting.glsl
+struct PointLight
+{
+	glm::vec3	Position;		// world space
+	float		Radius;			// no light reaches past it
+	glm::vec3	Color;
+	float		Intensity;
+};
+
+static_assert(sizeof(PointLight) == 32, "PointLight must match the std430 layout");
+
+// Range of lightIndices one cluster reads, a uvec2 on the GPU
+struct LightCluster
+{
+	uint32_t	Offset;
+	uint32_t	Count;
+};
+
+struct ClusterStats
+{
+	uint32_t	Lights;
+	uint32_t	VisibleLights;		// inside the frustum, only these are binned
+	uint32_t	OccupiedClusters;
+	uint32_t	LightIndices;
+	uint32_t	MaxClusterLights;
+	float		BinningMs;
+};
+
+// Grid of froxels over the camera frustum, 16 x 9 screen tiles by 24 exponential depth slices.
+// Every frame the point lights are binned into it on worker threads and uploaded as shader storage,
+// so a fragment only loops over the lights of its own cluster instead of all of them.
+class ClusteredLighting
+{
+public:
+	static const uint32_t kClustersX = 16;
+	static const uint32_t kClustersY = 9;
+	static const uint32_t kClustersZ = 24;
+	static const uint32_t kClusterCount = kClustersX * kClustersY * kClustersZ;
+
+	ClusteredLighting();
+	~ClusteredLighting();
+
+	void AddLight(const PointLight& _light);
+	void ClearLights();
+
+	// Bins against the camera and uploads, call once per frame before drawing
+	void Update(const Camera* _camera);
+	// CPU part of Update, the projection must be a symmetric perspective
+	void Bin(const glm::mat4& _view, const glm::mat4& _projection);
+	// Binds the buffers and sets the cluster uniforms for the program bound before it, built with FEATURE_CLUSTERED
+	void Record(CommandBuffer& commands) const;
+
+	void setThreadCount(unsigned int _threadCount);
+	// Fragments find their screen tile from gl_FragCoord, keep it in step with glViewport
+	static void setViewportSize(glm::vec2 _viewportSize);
+
+	std::vector<PointLight>& getLights();
+	const std::vector<LightCluster>& getClusters() const;
+	const std::vector<uint32_t>& getLightIndices() const;
+	const ClusterStats& getStats() const;
+
+	// Bins 1k to 10k random lights on one thread and on every core and prints the times
+	static void Benchmark(int _iterations);
+
+private:
+	// Light in view space with the clusters it can touch, found once before the workers start
+	struct LightBounds
+	{
+		glm::vec3	Center;
+		float		Radius;
+		uint32_t	Light;
+		uint32_t	MinX, MaxX;
+		uint32_t	MinY, MaxY;
+		uint32_t	MinZ, MaxZ;
+	};
+
+	// View space box of a cluster
+	struct ClusterBox
+	{
+		glm::vec3	Min;
+		glm::vec3	Max;
+	};
+
+	std::vector<PointLight> lights;
+	std::vector<LightCluster> clusters;
+	std::vector<uint32_t> lightIndices;
+
+	std::vector<LightBounds> bounds;
+	std::vector<ClusterBox> boxes;
+	std::vector<std::vector<uint32_t>> workerIndices;
+
+	glm::mat4 view;
+	glm::mat4 boxProjection;	// boxes are only rebuilt when the projection changes
+	float nearPlane;
+	float farPlane;
+	float sliceScale;
+	float sliceBias;
+
+	unsigned int threadCount;
+	ClusterStats stats;
+
+	static glm::vec2 viewportSize;
+
+	GLuint lightBuffer;
+	GLuint clusterBuffer;
+	GLuint indexBuffer;
+
+	void BuildBoxes(const glm::mat4& _projection);
+	void BuildBounds(const glm::mat4& _projection);
+	void BinSlices(unsigned int _worker, unsigned int _workerCount);
+	void Upload();
+	uint32_t GetSlice(float _depth) const;
+};
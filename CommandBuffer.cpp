@@ -0,0 +1,581 @@
+#include "CommandBuffer.h"
+
+#include <iostream>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+
+#include "Dependencies/glm/glm/gtc/type_ptr.hpp"
+
+#include "IndexBuffer.h"
+
+#include "GLCallStats.h"
+
+std::map<std::pair<GLuint, GLuint>, GLint> GLCommandExecutor::uniformLocations;
+
+// Ranges per multi draw command, 8 bytes each
+static const GLsizei kMaxMultiDrawRanges = 4096;
+
+// Function statics so renderers can register their uniform names from their own static initializers
+static std::mutex& getUniformMutex()
+{
+	static std::mutex uniformMutex;
+	return uniformMutex;
+}
+
+static std::map<std::string, GLuint>& getUniformIds()
+{
+	static std::map<std::string, GLuint> uniformIds;
+	return uniformIds;
+}
+
+static std::vector<std::string>& getUniformNames()
+{
+	static std::vector<std::string> uniformNames;
+	return uniformNames;
+}
+
+// Payloads are packed back to back with 4 byte alignment, so they are copied out rather than cast
+template <typename T>
+static T ReadPayload(const uint8_t* _payload)
+{
+	T payload;
+	std::memcpy(&payload, _payload, sizeof(T));
+	return payload;
+}
+
+static size_t getConstantSize(GLuint _type)
+{
+	switch (_type) {
+	case kConstantFloat:
+		return sizeof(float);
+	case kConstantVec2:
+		return sizeof(float) * 2;
+	case kConstantVec3:
+		return sizeof(float) * 3;
+	case kConstantUVec3:
+		return sizeof(GLuint) * 3;
+	case kConstantMat4:
+		return sizeof(float) * 16;
+	default:
+		return 0;
+	}
+}
+
+// Public //
+
+CommandBuffer::CommandBuffer()
+{
+	this->commandCount = 0;
+	return;
+}
+
+CommandBuffer::~CommandBuffer()
+{
+	return;
+}
+
+void CommandBuffer::Clear()
+{
+	data.clear();
+	commandCount = 0;
+	return;
+}
+
+void CommandBuffer::BindProgram(GLuint _program)
+{
+	const BindProgramCommand kCommand = { _program };
+	std::memcpy(Allocate(kCommandBindProgram, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::BindTexture(GLuint _unit, GLuint _texture)
+{
+	const BindTextureCommand kCommand = { _unit, _texture };
+	std::memcpy(Allocate(kCommandBindTexture, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::BindVertexBuffers(const VertexLayout& _layout, GLuint _vbo, GLuint _ebo)
+{
+	const BindVertexBuffersCommand kCommand = { &_layout, _vbo, _ebo };
+	std::memcpy(Allocate(kCommandBindVertexBuffers, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::BindStorageBuffer(GLuint _binding, GLuint _buffer)
+{
+	const BindStorageBufferCommand kCommand = { _binding, _buffer };
+	std::memcpy(Allocate(kCommandBindStorageBuffer, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, float _value)
+{
+	SetConstant(_uniform, kConstantFloat, &_value, sizeof(float));
+	return;
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, glm::vec2 _value)
+{
+	SetConstant(_uniform, kConstantVec2, glm::value_ptr(_value), sizeof(float) * 2);
+	return;
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, glm::vec3 _value)
+{
+	SetConstant(_uniform, kConstantVec3, glm::value_ptr(_value), sizeof(float) * 3);
+	return;
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, glm::uvec3 _value)
+{
+	const GLuint kValues[3] = { _value.x, _value.y, _value.z };
+	SetConstant(_uniform, kConstantUVec3, kValues, sizeof(kValues));
+	return;
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, const glm::mat4& _value)
+{
+	SetConstant(_uniform, kConstantMat4, glm::value_ptr(_value), sizeof(float) * 16);
+	return;
+}
+
+void CommandBuffer::Draw(GLenum _indexType, GLsizei _indexCount, GLuint _firstIndex, GLint _baseVertex)
+{
+	const DrawIndexedCommand kCommand = { _indexType, _indexCount, _firstIndex, _baseVertex, 1 };
+	std::memcpy(Allocate(kCommandDraw, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::DrawInstanced(GLenum _indexType, GLsizei _indexCount, GLuint _firstIndex, GLint _baseVertex, GLsizei _instanceCount)
+{
+	const DrawIndexedCommand kCommand = { _indexType, _indexCount, _firstIndex, _baseVertex, _instanceCount };
+	std::memcpy(Allocate(kCommandDrawInstanced, sizeof(kCommand)), &kCommand, sizeof(kCommand));
+	return;
+}
+
+void CommandBuffer::MultiDraw(GLenum _indexType, const GLsizei* _counts, const void* const* _offsets, GLsizei _drawCount)
+{
+	// Long lists are split so the command size still fits its header
+	if (_drawCount > kMaxMultiDrawRanges) {
+		for (GLsizei first = 0; first < _drawCount; first += kMaxMultiDrawRanges) {
+			MultiDraw(_indexType, _counts + first, _offsets + first, std::min(kMaxMultiDrawRanges, _drawCount - first));
+		}
+		return;
+	}
+	if (_drawCount <= 0) {
+		return;
+	}
+
+	const MultiDrawCommand kCommand = { _indexType, _drawCount };
+	const size_t kRangesSize = sizeof(GLsizei) * _drawCount + sizeof(GLuint) * _drawCount;
+	uint8_t* payload = static_cast<uint8_t*>(Allocate(kCommandMultiDraw, sizeof(kCommand) + kRangesSize));
+
+	std::memcpy(payload, &kCommand, sizeof(kCommand));
+	payload += sizeof(kCommand);
+	std::memcpy(payload, _counts, sizeof(GLsizei) * _drawCount);
+	payload += sizeof(GLsizei) * _drawCount;
+
+	const size_t kIndexSize = IndexBuffer::getTypeSize(_indexType);
+	for (GLsizei i = 0; i < _drawCount; i++) {
+		const GLuint kFirstIndex = static_cast<GLuint>(reinterpret_cast<size_t>(_offsets[i]) / kIndexSize);
+		std::memcpy(payload + sizeof(GLuint) * i, &kFirstIndex, sizeof(GLuint));
+	}
+
+	return;
+}
+
+size_t CommandBuffer::getCommandCount() const
+{
+	return commandCount;
+}
+
+const std::vector<uint8_t>& CommandBuffer::getData() const
+{
+	return data;
+}
+
+GLuint CommandBuffer::getUniformId(const std::string& _name)
+{
+	std::lock_guard<std::mutex> lock(getUniformMutex());
+
+	std::map<std::string, GLuint>& uniformIds = getUniformIds();
+	std::map<std::string, GLuint>::iterator it = uniformIds.find(_name);
+	if (it != uniformIds.end()) {
+		return it->second;
+	}
+
+	const GLuint kId = static_cast<GLuint>(getUniformNames().size());
+	getUniformNames().push_back(_name);
+	uniformIds[_name] = kId;
+
+	return kId;
+}
+
+std::string CommandBuffer::getUniformName(GLuint _uniform)
+{
+	std::lock_guard<std::mutex> lock(getUniformMutex());
+
+	const std::vector<std::string>& kNames = getUniformNames();
+	return (_uniform < kNames.size()) ? kNames[_uniform] : std::string();
+}
+
+void CommandBuffer::Benchmark(size_t _drawCount, int _iterations)
+{
+	const GLuint kModelUniform = getUniformId("model");
+	const GLuint kViewProjectionUniform = getUniformId("vp");
+	const GLuint kCameraPosUniform = getUniformId("cameraPos");
+	const GLuint kLightPosUniform = getUniformId("lightPos");
+	const GLuint kLightColorUniform = getUniformId("lightColor");
+	const GLuint kSpecularStrengthUniform = getUniformId("specularStrength");
+	const GLuint kAmbientStrengthUniform = getUniformId("ambientStrength");
+
+	// Per draw what MeshRenderer::Record writes, a few programs and textures so binds can't all be skipped
+	std::vector<glm::mat4> models(_drawCount);
+	for (size_t i = 0; i < _drawCount; i++) {
+		models[i] = glm::mat4(1.0f);
+		models[i][3] = glm::vec4(static_cast<float>(i % 100), 0.0f, static_cast<float>(i / 100), 1.0f);
+	}
+	const glm::mat4 kViewProjection(1.0f);
+
+	const auto kRecord = [&](CommandBuffer& _commands, size_t _first, size_t _last) {
+		for (size_t i = _first; i < _last; i++) {
+			_commands.BindProgram(1 + static_cast<GLuint>(i % 4));
+			_commands.SetConstant(kModelUniform, models[i]);
+			_commands.SetConstant(kViewProjectionUniform, kViewProjection);
+			_commands.BindTexture(0, 1 + static_cast<GLuint>(i % 8));
+			_commands.SetConstant(kCameraPosUniform, glm::vec3(0.0f, 4.0f, 30.0f));
+			_commands.SetConstant(kLightPosUniform, glm::vec3(0.0f, 10.0f, 0.0f));
+			_commands.SetConstant(kLightColorUniform, glm::vec3(1.0f));
+			_commands.SetConstant(kSpecularStrengthUniform, 0.5f);
+			_commands.SetConstant(kAmbientStrengthUniform, 0.1f);
+			_commands.BindVertexBuffers(kLitVertexLayout, 1 + static_cast<GLuint>(i % 16), 1 + static_cast<GLuint>(i % 16));
+			_commands.Draw(GL_UNSIGNED_SHORT, 36, 0, 0);
+		}
+	};
+
+	const unsigned int kThreadCounts[2] = { 1, WorkerPool::getShared().getThreadCount() };
+	for (unsigned int threadCount : kThreadCounts) {
+		std::vector<CommandBuffer> buffers;
+		NullCommandExecutor executor;
+
+		double bestRecord = 0.0;
+		double bestExecute = 0.0;
+		for (int i = 0; i < std::max(1, _iterations); i++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			RecordParallel(buffers, _drawCount, threadCount, kRecord);
+			std::chrono::high_resolution_clock::time_point recorded = std::chrono::high_resolution_clock::now();
+			executor.ResetStats();
+			executor.ExecuteAll(buffers);
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+			const double kRecordMs = std::chrono::duration<double, std::milli>(recorded - start).count();
+			const double kExecuteMs = std::chrono::duration<double, std::milli>(end - recorded).count();
+			bestRecord = (i == 0) ? kRecordMs : std::min(bestRecord, kRecordMs);
+			bestExecute = (i == 0) ? kExecuteMs : std::min(bestExecute, kExecuteMs);
+		}
+
+		const CommandStats& kStats = executor.getStats();
+		std::cout << "Command Buffer : " << kStats.Draws << " draws"
+			<< " | " << kStats.Commands << " commands"
+			<< " | " << kStats.Bytes / 1024 << " KB"
+			<< " | " << threadCount << " threads"
+			<< " | record " << bestRecord << " ms"
+			<< " | replay " << bestExecute << " ms"
+			<< " | " << (bestRecord + bestExecute) * 1000000.0 / std::max<size_t>(1, _drawCount) << " ns per draw" << std::endl;
+	}
+
+	return;
+}
+
+// Private //
+
+void* CommandBuffer::Allocate(CommandType _type, size_t _payloadSize)
+{
+	const size_t kSize = (sizeof(CommandHeader) + _payloadSize + 3) & ~static_cast<size_t>(3);
+	const CommandHeader kHeader = { static_cast<uint16_t>(_type), static_cast<uint16_t>(kSize) };
+
+	const size_t kOffset = data.size();
+	data.resize(kOffset + kSize);
+	std::memcpy(&data[kOffset], &kHeader, sizeof(kHeader));
+	commandCount++;
+
+	return &data[kOffset + sizeof(CommandHeader)];
+}
+
+void CommandBuffer::SetConstant(GLuint _uniform, ConstantType _type, const void* _values, size_t _size)
+{
+	const SetConstantsCommand kCommand = { _uniform, static_cast<GLuint>(_type) };
+	uint8_t* payload = static_cast<uint8_t*>(Allocate(kCommandSetConstants, sizeof(kCommand) + _size));
+
+	std::memcpy(payload, &kCommand, sizeof(kCommand));
+	std::memcpy(payload + sizeof(kCommand), _values, _size);
+
+	return;
+}
+
+// Command Executor //
+
+CommandExecutor::CommandExecutor()
+{
+	ResetStats();
+	return;
+}
+
+CommandExecutor::~CommandExecutor()
+{
+	return;
+}
+
+void CommandExecutor::ExecuteAll(const std::vector<CommandBuffer>& _buffers)
+{
+	for (size_t i = 0; i < _buffers.size(); i++) {
+		Execute(_buffers[i]);
+	}
+
+	return;
+}
+
+const CommandStats& CommandExecutor::getStats() const
+{
+	return stats;
+}
+
+void CommandExecutor::ResetStats()
+{
+	std::memset(&stats, 0, sizeof(stats));
+	return;
+}
+
+void CommandExecutor::Count(const CommandHeader& _header, const uint8_t* _payload)
+{
+	stats.Commands++;
+	stats.Bytes += _header.Size;
+	if (_header.Type < kCommandTypeCount) {
+		stats.ByType[_header.Type]++;
+	}
+
+	if (_header.Type == kCommandDraw || _header.Type == kCommandDrawInstanced) {
+		const DrawIndexedCommand kDraw = ReadPayload<DrawIndexedCommand>(_payload);
+		const GLsizei kInstances = (_header.Type == kCommandDrawInstanced) ? kDraw.InstanceCount : 1;
+		stats.Draws++;
+		stats.Triangles += static_cast<uint32_t>(kDraw.IndexCount / 3 * kInstances);
+	}
+	else if (_header.Type == kCommandMultiDraw) {
+		const MultiDrawCommand kMultiDraw = ReadPayload<MultiDrawCommand>(_payload);
+		const uint8_t* kCounts = _payload + sizeof(MultiDrawCommand);
+		stats.Draws += kMultiDraw.DrawCount;
+		for (GLsizei i = 0; i < kMultiDraw.DrawCount; i++) {
+			stats.Triangles += static_cast<uint32_t>(ReadPayload<GLsizei>(kCounts + sizeof(GLsizei) * i) / 3);
+		}
+	}
+
+	return;
+}
+
+// GL Command Executor //
+
+GLCommandExecutor::GLCommandExecutor()
+{
+	return;
+}
+
+GLCommandExecutor::~GLCommandExecutor()
+{
+	return;
+}
+
+void GLCommandExecutor::Execute(const CommandBuffer& _commands)
+{
+	const std::vector<uint8_t>& kData = _commands.getData();
+
+	// Only what this buffer bound is trusted, anything drawn in between may have changed it
+	GLuint currentProgram = 0;
+	bool bProgramBound = false;
+	GLuint currentTextures[2] = { 0, 0 };		// unit, texture
+	bool bTextureBound = false;
+	BindVertexBuffersCommand currentBuffers = { nullptr, 0, 0 };
+	GLuint activeUnit = 0;
+
+	size_t offset = 0;
+	while (offset + sizeof(CommandHeader) <= kData.size()) {
+		const CommandHeader kHeader = ReadPayload<CommandHeader>(&kData[offset]);
+		const uint8_t* kPayload = &kData[offset + sizeof(CommandHeader)];
+		offset += kHeader.Size;
+		Count(kHeader, kPayload);
+
+		switch (kHeader.Type) {
+		case kCommandBindProgram: {
+			const BindProgramCommand kCommand = ReadPayload<BindProgramCommand>(kPayload);
+			if (bProgramBound && kCommand.Program == currentProgram) {
+				stats.Redundant++;
+				break;
+			}
+			glUseProgram(kCommand.Program);
+			currentProgram = kCommand.Program;
+			bProgramBound = true;
+			break;
+		}
+		case kCommandBindTexture: {
+			const BindTextureCommand kCommand = ReadPayload<BindTextureCommand>(kPayload);
+			if (bTextureBound && kCommand.Unit == currentTextures[0] && kCommand.Texture == currentTextures[1]) {
+				stats.Redundant++;
+				break;
+			}
+			if (kCommand.Unit != activeUnit || !bTextureBound) {
+				glActiveTexture(GL_TEXTURE0 + kCommand.Unit);
+				activeUnit = kCommand.Unit;
+			}
+			glBindTexture(GL_TEXTURE_2D, kCommand.Texture);
+			currentTextures[0] = kCommand.Unit;
+			currentTextures[1] = kCommand.Texture;
+			bTextureBound = true;
+			break;
+		}
+		case kCommandBindVertexBuffers: {
+			const BindVertexBuffersCommand kCommand = ReadPayload<BindVertexBuffersCommand>(kPayload);
+			if (kCommand.Layout == currentBuffers.Layout && kCommand.Vbo == currentBuffers.Vbo && kCommand.Ebo == currentBuffers.Ebo) {
+				stats.Redundant++;
+				break;
+			}
+			VertexArrayCache::Bind(*kCommand.Layout, kCommand.Vbo, kCommand.Ebo);
+			currentBuffers = kCommand;
+			break;
+		}
+		case kCommandBindStorageBuffer: {
+			const BindStorageBufferCommand kCommand = ReadPayload<BindStorageBufferCommand>(kPayload);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCommand.Binding, kCommand.Buffer);
+			break;
+		}
+		case kCommandSetConstants: {
+			const SetConstantsCommand kCommand = ReadPayload<SetConstantsCommand>(kPayload);
+			const GLint kLocation = bProgramBound ? getUniformLocation(currentProgram, kCommand.Uniform) : -1;
+			if (kLocation < 0) {
+				break;
+			}
+
+			// Copied out for alignment, a mat4 is the largest
+			GLfloat values[16];
+			std::memcpy(values, kPayload + sizeof(SetConstantsCommand), getConstantSize(kCommand.Type));
+
+			switch (kCommand.Type) {
+			case kConstantFloat:
+				glUniform1f(kLocation, values[0]);
+				break;
+			case kConstantVec2:
+				glUniform2f(kLocation, values[0], values[1]);
+				break;
+			case kConstantVec3:
+				glUniform3f(kLocation, values[0], values[1], values[2]);
+				break;
+			case kConstantUVec3: {
+				GLuint uints[3];
+				std::memcpy(uints, values, sizeof(uints));
+				glUniform3ui(kLocation, uints[0], uints[1], uints[2]);
+				break;
+			}
+			case kConstantMat4:
+				glUniformMatrix4fv(kLocation, 1, GL_FALSE, values);
+				break;
+			}
+			break;
+		}
+		case kCommandDraw:
+		case kCommandDrawInstanced: {
+			const DrawIndexedCommand kCommand = ReadPayload<DrawIndexedCommand>(kPayload);
+			const size_t kOffset = static_cast<size_t>(kCommand.FirstIndex) * IndexBuffer::getTypeSize(kCommand.IndexType);
+			if (kHeader.Type == kCommandDrawInstanced) {
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, kCommand.IndexCount, kCommand.IndexType, (void*)kOffset, kCommand.InstanceCount, kCommand.BaseVertex);
+			}
+			else if (kCommand.BaseVertex != 0) {
+				glDrawElementsBaseVertex(GL_TRIANGLES, kCommand.IndexCount, kCommand.IndexType, (void*)kOffset, kCommand.BaseVertex);
+			}
+			else {
+				glDrawElements(GL_TRIANGLES, kCommand.IndexCount, kCommand.IndexType, (void*)kOffset);
+			}
+			break;
+		}
+		case kCommandMultiDraw: {
+			const MultiDrawCommand kCommand = ReadPayload<MultiDrawCommand>(kPayload);
+			const uint8_t* kCounts = kPayload + sizeof(MultiDrawCommand);
+			const uint8_t* kFirstIndices = kCounts + sizeof(GLsizei) * kCommand.DrawCount;
+			const size_t kIndexSize = IndexBuffer::getTypeSize(kCommand.IndexType);
+
+			multiDrawCounts.resize(kCommand.DrawCount);
+			multiDrawOffsets.resize(kCommand.DrawCount);
+			std::memcpy(&multiDrawCounts[0], kCounts, sizeof(GLsizei) * kCommand.DrawCount);
+			for (GLsizei i = 0; i < kCommand.DrawCount; i++) {
+				multiDrawOffsets[i] = reinterpret_cast<const void*>(ReadPayload<GLuint>(kFirstIndices + sizeof(GLuint) * i) * kIndexSize);
+			}
+
+			glMultiDrawElements(GL_TRIANGLES, &multiDrawCounts[0], kCommand.IndexType, &multiDrawOffsets[0], kCommand.DrawCount);
+			break;
+		}
+		default:
+			std::cout << "Command Buffer : Unknown command " << kHeader.Type << std::endl;
+			return;
+		}
+	}
+
+	// Leaves the state the way immediate drawing did
+	if (bTextureBound) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if (activeUnit != 0) {
+		glActiveTexture(GL_TEXTURE0);
+	}
+	if (bProgramBound) {
+		glUseProgram(0);
+	}
+
+	return;
+}
+
+void GLCommandExecutor::ClearUniformLocations()
+{
+	uniformLocations.clear();
+	return;
+}
+
+// Private //
+
+GLint GLCommandExecutor::getUniformLocation(GLuint _program, GLuint _uniform)
+{
+	const std::pair<GLuint, GLuint> kKey(_program, _uniform);
+	std::map<std::pair<GLuint, GLuint>, GLint>::iterator it = uniformLocations.find(kKey);
+	if (it != uniformLocations.end()) {
+		return it->second;
+	}
+
+	const GLint kLocation = glGetUniformLocation(_program, CommandBuffer::getUniformName(_uniform).c_str());
+	uniformLocations[kKey] = kLocation;
+
+	return kLocation;
+}
+
+// Null Command Executor //
+
+NullCommandExecutor::NullCommandExecutor()
+{
+	return;
+}
+
+NullCommandExecutor::~NullCommandExecutor()
+{
+	return;
+}
+
+void NullCommandExecutor::Execute(const CommandBuffer& _commands)
+{
+	const std::vector<uint8_t>& kData = _commands.getData();
+
+	size_t offset = 0;
+	while (offset + sizeof(CommandHeader) <= kData.size()) {
+		const CommandHeader kHeader = ReadPayload<CommandHeader>(&kData[offset]);
+		Count(kHeader, &kData[offset + sizeof(CommandHeader)]);
+		offset += kHeader.Size;
+	}
+
+	return;
+}
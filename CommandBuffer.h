@@ -0,0 +1,217 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "Dependencies/glm/glm/glm.hpp"
+
+#include "VertexLayout.h"
+#include "WorkerPool.h"
+
+enum CommandType
+{
+	kCommandBindProgram = 0,
+	kCommandBindTexture,
+	kCommandBindVertexBuffers,
+	kCommandBindStorageBuffer,
+	kCommandSetConstants,
+	kCommandDraw,
+	kCommandDrawInstanced,
+	kCommandMultiDraw,
+	kCommandTypeCount
+};
+
+enum ConstantType
+{
+	kConstantFloat = 0,
+	kConstantVec2,
+	kConstantVec3,
+	kConstantUVec3,
+	kConstantMat4
+};
+
+// Every command starts with this, Size covers the header and the payload and is a multiple of 4
+struct CommandHeader
+{
+	uint16_t	Type;
+	uint16_t	Size;
+};
+
+struct BindProgramCommand
+{
+	GLuint	Program;
+};
+
+struct BindTextureCommand
+{
+	GLuint	Unit;			// 0 is GL_TEXTURE0
+	GLuint	Texture;
+};
+
+struct BindVertexBuffersCommand
+{
+	const VertexLayout*	Layout;		// VertexArrayCache picks the vao from it
+	GLuint				Vbo;
+	GLuint				Ebo;
+};
+
+struct BindStorageBufferCommand
+{
+	GLuint	Binding;
+	GLuint	Buffer;
+};
+
+// Followed by the values, 1 to 16 floats or 3 uints
+struct SetConstantsCommand
+{
+	GLuint	Uniform;		// from CommandBuffer::getUniformId, resolved per program when replayed
+	GLuint	Type;			// ConstantType
+};
+
+// Indexed triangles, InstanceCount is only read by kCommandDrawInstanced
+struct DrawIndexedCommand
+{
+	GLenum	IndexType;
+	GLsizei	IndexCount;
+	GLuint	FirstIndex;
+	GLint	BaseVertex;
+	GLsizei	InstanceCount;
+};
+
+// Followed by DrawCount index counts then DrawCount first indices
+struct MultiDrawCommand
+{
+	GLenum	IndexType;
+	GLsizei	DrawCount;
+};
+
+struct CommandStats
+{
+	uint32_t	Commands;
+	uint32_t	Draws;			// draw calls, a multi draw counts every range
+	uint32_t	Triangles;		// including every instance
+	uint32_t	Redundant;		// binds skipped because the state was already set
+	uint32_t	Bytes;
+	uint32_t	ByType[kCommandTypeCount];
+};
+
+// Compact list of draw state changes and draws. Recording never touches GL, so it works without a context
+// and from worker threads, an executor replays the list afterwards. Uniforms are referred to by an id
+// from getUniformId instead of a location since programs may still be linking when commands are recorded.
+class CommandBuffer
+{
+public:
+	CommandBuffer();
+	~CommandBuffer();
+
+	// Drops the commands and keeps the memory for the next frame
+	void Clear();
+
+	void BindProgram(GLuint _program);
+	void BindTexture(GLuint _unit, GLuint _texture);
+	void BindVertexBuffers(const VertexLayout& _layout, GLuint _vbo, GLuint _ebo);
+	void BindStorageBuffer(GLuint _binding, GLuint _buffer);
+
+	void SetConstant(GLuint _uniform, float _value);
+	void SetConstant(GLuint _uniform, glm::vec2 _value);
+	void SetConstant(GLuint _uniform, glm::vec3 _value);
+	void SetConstant(GLuint _uniform, glm::uvec3 _value);
+	void SetConstant(GLuint _uniform, const glm::mat4& _value);
+
+	void Draw(GLenum _indexType, GLsizei _indexCount, GLuint _firstIndex, GLint _baseVertex);
+	void DrawInstanced(GLenum _indexType, GLsizei _indexCount, GLuint _firstIndex, GLint _baseVertex, GLsizei _instanceCount);
+	// Byte offsets like glMultiDrawElements takes, they are stored as first indices
+	void MultiDraw(GLenum _indexType, const GLsizei* _counts, const void* const* _offsets, GLsizei _drawCount);
+
+	size_t getCommandCount() const;
+	const std::vector<uint8_t>& getData() const;
+
+	// Same name always gives the same id, safe to call from any thread
+	static GLuint getUniformId(const std::string& _name);
+	static std::string getUniformName(GLuint _uniform);
+
+	// Records _count items split into contiguous ranges on up to _threadCount threads of the shared worker pool
+	// with _record(buffer, first, last). Range i lands in buffers[i], replaying the buffers in order keeps the submission order.
+	template <typename Record>
+	static void RecordParallel(std::vector<CommandBuffer>& buffers, size_t _count, unsigned int _threadCount, Record _record)
+	{
+		WorkerPool& pool = WorkerPool::getShared();
+		const size_t kRanges = std::max<size_t>(1, std::min<size_t>(std::min(_threadCount, pool.getThreadCount()), _count));
+		buffers.resize(kRanges);
+
+		pool.Run(static_cast<unsigned int>(kRanges), [&buffers, &_record, kRanges, _count](unsigned int _range) {
+			buffers[_range].Clear();
+			_record(buffers[_range], _count * _range / kRanges, _count * (_range + 1) / kRanges);
+		});
+
+		return;
+	}
+
+	// Records a scene of _drawCount mesh draws like MeshRenderer does and replays it on the null executor,
+	// on one thread then on every core, and prints the cost per draw
+	static void Benchmark(size_t _drawCount, int _iterations);
+
+private:
+	std::vector<uint8_t> data;
+	size_t commandCount;
+
+	void* Allocate(CommandType _type, size_t _payloadSize);
+	void SetConstant(GLuint _uniform, ConstantType _type, const void* _values, size_t _size);
+};
+
+// Replays command buffers somewhere
+class CommandExecutor
+{
+public:
+	CommandExecutor();
+	virtual ~CommandExecutor();
+
+	// Replays every command in the order it was recorded
+	virtual void Execute(const CommandBuffer& _commands) = 0;
+	// Buffers from RecordParallel, in order
+	void ExecuteAll(const std::vector<CommandBuffer>& _buffers);
+
+	const CommandStats& getStats() const;
+	void ResetStats();
+
+protected:
+	CommandStats stats;
+
+	void Count(const CommandHeader& _header, const uint8_t* _payload);
+};
+
+// Issues the GL calls, skipping binds of what is already bound within a buffer
+class GLCommandExecutor : public CommandExecutor
+{
+public:
+	GLCommandExecutor();
+	virtual ~GLCommandExecutor();
+
+	virtual void Execute(const CommandBuffer& _commands);
+
+	// Locations are looked up once per program and uniform, so only replay once the programs are linked.
+	// Call when programs are deleted.
+	static void ClearUniformLocations();
+
+private:
+	std::vector<GLsizei> multiDrawCounts;
+	std::vector<const void*> multiDrawOffsets;
+
+	static std::map<std::pair<GLuint, GLuint>, GLint> uniformLocations;
+
+	static GLint getUniformLocation(GLuint _program, GLuint _uniform);
+};
+
+// Walks the commands and only counts them, measures what recording and submission cost on our side
+class NullCommandExecutor : public CommandExecutor
+{
+public:
+	NullCommandExecutor();
+	virtual ~NullCommandExecutor();
+
+	virtual void Execute(const CommandBuffer& _commands);
+};
@@ -0,0 +1,287 @@
+#include "CookedMesh.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cfloat>
+
+#include "Loader.h"
+#include "MeshOptimizer.h"
+#include "IndexBuffer.h"
+
+static const uint64_t kSectionAlignment = 16;
+
+static uint64_t AlignSection(uint64_t _offset)
+{
+	return (_offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+static void ComputeBounds(const std::vector<Vertex>& _vertices, uint32_t _baseVertex, const uint32_t* _indices, uint32_t _indexCount, float _min[3], float _max[3])
+{
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+
+	for (uint32_t i = 0; i < _indexCount; i++) {
+		boundsMin = glm::min(boundsMin, _vertices[_baseVertex + _indices[i]].position);
+		boundsMax = glm::max(boundsMax, _vertices[_baseVertex + _indices[i]].position);
+	}
+	if (_indexCount == 0) {
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		_min[i] = boundsMin[i];
+		_max[i] = boundsMax[i];
+	}
+
+	return;
+}
+
+// Public //
+
+CookedMesh::CookedMesh()
+{
+	this->header = nullptr;
+	return;
+}
+
+CookedMesh::~CookedMesh()
+{
+	return;
+}
+
+bool CookedMesh::Open(std::string _fileName)
+{
+	Close();
+
+	if (!file.Open(_fileName)) {
+		return false;
+	}
+
+	// Validate every section against the file size before anything points into it
+	const size_t kSize = file.getSize();
+	const CookedMeshHeader* mapped = reinterpret_cast<const CookedMeshHeader*>(file.getData());
+
+	const bool kValid =
+		kSize >= sizeof(CookedMeshHeader) &&
+		mapped->Magic == kCookedMeshMagic &&
+		mapped->Version == kCookedMeshVersion &&
+		mapped->VertexStride == sizeof(Vertex) &&
+		(mapped->IndexStride == sizeof(uint16_t) || mapped->IndexStride == sizeof(uint32_t)) &&
+		mapped->VertexOffset + uint64_t(mapped->VertexCount) * sizeof(Vertex) <= kSize &&
+		mapped->IndexOffset + uint64_t(mapped->IndexCount) * mapped->IndexStride <= kSize &&
+		mapped->SubmeshOffset + uint64_t(mapped->SubmeshCount) * sizeof(CookedSubmesh) <= kSize;
+
+	if (!kValid) {
+		std::cout << "Cooked Mesh : " << _fileName << " is not a valid cooked mesh, re-cook it" << std::endl;
+		Close();
+		return false;
+	}
+
+	header = mapped;
+
+	return true;
+}
+
+void CookedMesh::Close()
+{
+	header = nullptr;
+	file.Close();
+
+	return;
+}
+
+void CookedMesh::Upload() const
+{
+	if (!header) {
+		return;
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * header->VertexCount, getVertices(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, header->IndexStride * header->IndexCount, getIndices(), GL_STATIC_DRAW);
+
+	return;
+}
+
+const Vertex* CookedMesh::getVertices() const
+{
+	return header ? reinterpret_cast<const Vertex*>(file.getData() + header->VertexOffset) : nullptr;
+}
+
+const void* CookedMesh::getIndices() const
+{
+	return header ? file.getData() + header->IndexOffset : nullptr;
+}
+
+GLenum CookedMesh::getIndexType() const
+{
+	return (header && header->IndexStride == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+const CookedSubmesh* CookedMesh::getSubmeshes() const
+{
+	return header ? reinterpret_cast<const CookedSubmesh*>(file.getData() + header->SubmeshOffset) : nullptr;
+}
+
+uint32_t CookedMesh::getVertexCount() const
+{
+	return header ? header->VertexCount : 0;
+}
+
+uint32_t CookedMesh::getIndexCount() const
+{
+	return header ? header->IndexCount : 0;
+}
+
+uint32_t CookedMesh::getSubmeshCount() const
+{
+	return header ? header->SubmeshCount : 0;
+}
+
+glm::vec3 CookedMesh::getBoundsMin() const
+{
+	return header ? glm::vec3(header->BoundsMin[0], header->BoundsMin[1], header->BoundsMin[2]) : glm::vec3(0.0f);
+}
+
+glm::vec3 CookedMesh::getBoundsMax() const
+{
+	return header ? glm::vec3(header->BoundsMax[0], header->BoundsMax[1], header->BoundsMax[2]) : glm::vec3(0.0f);
+}
+
+// Converters //
+
+bool CookedMesh::Write(std::string _fileName, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices)
+{
+	// One submesh per chunk, a mesh under 65536 vertices comes back as a single chunk covering every index
+	std::vector<Vertex> chunkVertices;
+	std::vector<uint32_t> chunkIndices;
+	std::vector<MeshChunk> chunks;
+	IndexBuffer::Split(_vertices, _indices, kMaxShortIndexVertices, chunkVertices, chunkIndices, chunks);
+
+	std::vector<CookedSubmesh> submeshes(chunks.size());
+	for (size_t i = 0; i < chunks.size(); i++) {
+		submeshes[i].FirstIndex = chunks[i].FirstIndex;
+		submeshes[i].IndexCount = chunks[i].IndexCount;
+		submeshes[i].BaseVertex = chunks[i].BaseVertex;
+		submeshes[i].VertexCount = chunks[i].VertexCount;
+		ComputeBounds(chunkVertices, chunks[i].BaseVertex, &chunkIndices[chunks[i].FirstIndex], chunks[i].IndexCount, submeshes[i].BoundsMin, submeshes[i].BoundsMax);
+	}
+
+	return Write(_fileName, chunkVertices, chunkIndices, submeshes);
+}
+
+bool CookedMesh::Write(std::string _fileName, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const std::vector<CookedSubmesh>& _submeshes)
+{
+	// Indices are stored relative to each submesh's base vertex, 16 bit whenever they all fit
+	uint32_t maxIndex = 0;
+	for (size_t i = 0; i < _indices.size(); i++) {
+		maxIndex = std::max(maxIndex, _indices[i]);
+	}
+	const bool kShortIndices = maxIndex < kMaxShortIndexVertices;
+
+	std::vector<uint16_t> shortIndices;
+	if (kShortIndices) {
+		shortIndices.assign(_indices.begin(), _indices.end());
+	}
+
+	CookedMeshHeader cookedHeader;
+	cookedHeader.Magic = kCookedMeshMagic;
+	cookedHeader.Version = kCookedMeshVersion;
+	cookedHeader.VertexStride = sizeof(Vertex);
+	cookedHeader.IndexStride = kShortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	cookedHeader.VertexCount = static_cast<uint32_t>(_vertices.size());
+	cookedHeader.IndexCount = static_cast<uint32_t>(_indices.size());
+	cookedHeader.SubmeshCount = static_cast<uint32_t>(_submeshes.size());
+	cookedHeader.Padding = 0;
+	cookedHeader.VertexOffset = AlignSection(sizeof(CookedMeshHeader));
+	cookedHeader.IndexOffset = AlignSection(cookedHeader.VertexOffset + sizeof(Vertex) * _vertices.size());
+	cookedHeader.SubmeshOffset = AlignSection(cookedHeader.IndexOffset + cookedHeader.IndexStride * _indices.size());
+
+	// Whole mesh bounds are the union of the submeshes since their indices aren't absolute
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+	for (size_t i = 0; i < _submeshes.size(); i++) {
+		boundsMin = glm::min(boundsMin, glm::vec3(_submeshes[i].BoundsMin[0], _submeshes[i].BoundsMin[1], _submeshes[i].BoundsMin[2]));
+		boundsMax = glm::max(boundsMax, glm::vec3(_submeshes[i].BoundsMax[0], _submeshes[i].BoundsMax[1], _submeshes[i].BoundsMax[2]));
+	}
+	if (_submeshes.empty()) {
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+	}
+	for (int i = 0; i < 3; i++) {
+		cookedHeader.BoundsMin[i] = boundsMin[i];
+		cookedHeader.BoundsMax[i] = boundsMax[i];
+	}
+
+	std::ofstream out(_fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.good()) {
+		std::cout << "Cooked Mesh : Can't write file " << _fileName << std::endl;
+		return false;
+	}
+
+	const char kPadding[kSectionAlignment] = {};
+	uint64_t written = 0;
+
+	// Pads up to each section's offset then writes it
+	auto WriteSection = [&](uint64_t _offset, const void* _data, size_t _bytes) {
+		out.write(kPadding, static_cast<std::streamsize>(_offset - written));
+		if (_bytes > 0) {
+			out.write(static_cast<const char*>(_data), static_cast<std::streamsize>(_bytes));
+		}
+		written = _offset + _bytes;
+	};
+
+	WriteSection(0, &cookedHeader, sizeof(cookedHeader));
+	WriteSection(cookedHeader.VertexOffset, _vertices.data(), sizeof(Vertex) * _vertices.size());
+	if (kShortIndices) {
+		WriteSection(cookedHeader.IndexOffset, shortIndices.data(), sizeof(uint16_t) * shortIndices.size());
+	}
+	else {
+		WriteSection(cookedHeader.IndexOffset, _indices.data(), sizeof(uint32_t) * _indices.size());
+	}
+	WriteSection(cookedHeader.SubmeshOffset, _submeshes.data(), sizeof(CookedSubmesh) * _submeshes.size());
+
+	return out.good();
+}
+
+bool CookedMesh::CookFile(std::string _sourceFileName, std::string _cookedFileName)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	Loader loader;
+	if (!loader.LoadMesh(_sourceFileName, vertices, indices)) {
+		return false;
+	}
+
+	// Imported meshes are in whatever order the exporter wrote, the cooked file stores them optimized
+	MeshOptimizer::Optimize(_sourceFileName, vertices, indices, true);
+
+	return Write(_cookedFileName, vertices, indices);
+}
+
+bool CookedMesh::CookMeshType(MeshType _meshType, std::string _cookedFileName)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	switch (_meshType) {
+	case kTriangle:
+		Mesh::SetTriangleData(vertices, indices);
+		break;
+	case kQuad:
+		Mesh::SetQuadData(vertices, indices);
+		break;
+	case kCube:
+		Mesh::SetCubeData(vertices, indices);
+		break;
+	case kSphere:
+		Mesh::SetSphereData(vertices, indices);
+		break;
+	}
+
+	MeshOptimizer::Optimize(_cookedFileName, vertices, indices, true);
+
+	return Write(_cookedFileName, vertices, indices);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+// On disk layout of a cooked mesh, every section starts 16 byte aligned:
+// [CookedMeshHeader][Vertex * VertexCount][IndexStride * IndexCount][CookedSubmesh * SubmeshCount]
+struct CookedMeshHeader
+{
+	uint32_t	Magic;			// kCookedMeshMagic
+	uint32_t	Version;		// kCookedMeshVersion
+	uint32_t	VertexStride;	// sizeof(Vertex) when cooked, a mismatch means the file is stale
+	uint32_t	IndexStride;	// 2 when every index fits in 16 bits, otherwise 4
+	uint32_t	VertexCount;
+	uint32_t	IndexCount;
+	uint32_t	SubmeshCount;
+	uint32_t	Padding;
+	uint64_t	VertexOffset;	// bytes from the start of the file
+	uint64_t	IndexOffset;
+	uint64_t	SubmeshOffset;
+	float		BoundsMin[3];
+	float		BoundsMax[3];
+};
+
+struct CookedSubmesh
+{
+	uint32_t	FirstIndex;
+	uint32_t	IndexCount;
+	uint32_t	BaseVertex;		// indices are relative to it, drawn with glDrawElementsBaseVertex
+	uint32_t	VertexCount;
+	float		BoundsMin[3];
+	float		BoundsMax[3];
+};
+
+static const uint32_t kCookedMeshMagic = 0x48534D43;	// "CMSH"
+static const uint32_t kCookedMeshVersion = 2;
+
+// A cooked mesh mapped straight from disk, its streams are uploaded without being parsed or copied
+class CookedMesh
+{
+public:
+	CookedMesh();
+	~CookedMesh();
+
+	bool Open(std::string _fileName);
+	void Close();
+
+	// Fills the bound GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER directly from the mapping
+	void Upload() const;
+
+	const Vertex* getVertices() const;
+	const void* getIndices() const;
+	GLenum getIndexType() const;
+	const CookedSubmesh* getSubmeshes() const;
+	uint32_t getVertexCount() const;
+	uint32_t getIndexCount() const;
+	uint32_t getSubmeshCount() const;
+	glm::vec3 getBoundsMin() const;
+	glm::vec3 getBoundsMax() const;
+
+	// Converters
+	// Splits meshes too big for 16 bit indices into one submesh per chunk
+	static bool Write(std::string _fileName, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices);
+	static bool Write(std::string _fileName, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const std::vector<CookedSubmesh>& _submeshes);
+	static bool CookFile(std::string _sourceFileName, std::string _cookedFileName);
+	static bool CookMeshType(MeshType _meshType, std::string _cookedFileName);
+
+private:
+	MappedFile file;
+	const CookedMeshHeader* header;
+};
@@ -0,0 +1,521 @@
+#include "FontCache.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include FT_MODULE_H
+
+#include "GLCallStats.h"
+
+// FreeType gained its SDF renderer in 2.11, older versions get their distance fields from BuildDistanceField
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define FONT_CACHE_HAS_SDF 1
+#endif
+
+// Size of each font atlas, glyphs live in fixed size cells inside it
+static const int kAtlasSize = 1024;
+// Empty texels around each cell so linear filtering doesn't bleed neighbours in
+static const int kCellPadding = 1;
+// Every SDF font is rasterized at this size whatever size it is drawn at
+static const int kSDFPixelSize = 32;
+// Distance in pixels the SDF covers on each side of a glyph edge
+static const int kSDFSpread = 4;
+
+#ifndef FONT_CACHE_HAS_SDF
+// Distance field of a coverage bitmap, grown by the spread on every side and encoded like FreeType's:
+// 128 on the edge, higher inside. Each texel measures to the nearest texel across the edge within the
+// spread, that texel's coverage places the edge inside it so the field stays smooth when scaled up.
+static void BuildDistanceField(const FT_Bitmap& _bitmap, std::vector<unsigned char>& _field)
+{
+	const int kWidth = (int)_bitmap.width;
+	const int kRows = (int)_bitmap.rows;
+	const int kFieldWidth = kWidth + kSDFSpread * 2;
+	const int kFieldRows = kRows + kSDFSpread * 2;
+
+	// Coverage from 0 to 1 at a texel of the grown bitmap, nothing outside the glyph
+	std::vector<float> coverage(kFieldWidth * kFieldRows, 0.0f);
+	for (int y = 0; y < kRows; y++)
+	{
+		for (int x = 0; x < kWidth; x++)
+		{
+			coverage[(y + kSDFSpread) * kFieldWidth + x + kSDFSpread] = _bitmap.buffer[y * _bitmap.pitch + x] / 255.0f;
+		}
+	}
+
+	_field.resize(kFieldWidth * kFieldRows);
+	for (int y = 0; y < kFieldRows; y++)
+	{
+		for (int x = 0; x < kFieldWidth; x++)
+		{
+			const float kCoverage = coverage[y * kFieldWidth + x];
+			const bool kInside = kCoverage >= 0.5f;
+
+			// Distance to the edge, positive outside
+			float distance = kInside ? -(float)kSDFSpread : (float)kSDFSpread;
+			if (kCoverage > 0.0f && kCoverage < 1.0f)
+			{
+				distance = 0.5f - kCoverage;
+			}
+			else
+			{
+				const int kMinY = std::max(0, y - kSDFSpread);
+				const int kMaxY = std::min(kFieldRows - 1, y + kSDFSpread);
+				const int kMinX = std::max(0, x - kSDFSpread);
+				const int kMaxX = std::min(kFieldWidth - 1, x + kSDFSpread);
+				for (int ny = kMinY; ny <= kMaxY; ny++)
+				{
+					for (int nx = kMinX; nx <= kMaxX; nx++)
+					{
+						const float kOther = coverage[ny * kFieldWidth + nx];
+						const float kLength = std::sqrt((float)((nx - x) * (nx - x) + (ny - y) * (ny - y)));
+						if (!kInside && kOther > 0.0f)
+						{
+							distance = std::min(distance, kLength + 0.5f - kOther);
+						}
+						else if (kInside && kOther < 1.0f)
+						{
+							distance = std::max(distance, -(kLength + kOther - 0.5f));
+						}
+					}
+				}
+			}
+
+			const float kValue = 128.0f - distance / kSDFSpread * 128.0f;
+			_field[y * kFieldWidth + x] = (unsigned char)std::min(255.0f, std::max(0.0f, kValue + 0.5f));
+		}
+	}
+
+	return;
+}
+#endif
+
+FT_Library FontCache::library = NULL;
+bool FontCache::bHeadless = false;
+GLuint FontCache::frame = 0;
+std::map<std::tuple<std::string, int, FontRenderMode>, Font*> FontCache::fonts;
+
+// Font //
+
+Font::Font(FT_Library _library, std::string _font, int _size, FontRenderMode _mode)
+{
+	this->face = NULL;
+	this->mode = _mode;
+	this->pixelSize = _size;
+	this->atlas = 0;
+	this->useClock = 0;
+	this->fullFrame = 0;
+	this->generation = 0;
+	this->ascender = 0.0f;
+	this->descender = 0.0f;
+	this->lineHeight = 0.0f;
+
+	// Load font, the face stays open so glyphs can be rasterized later
+	if (FT_New_Face(_library, _font.c_str(), 0, &face))
+	{
+		std::cout << "ERROR::FREETYPE: Failed to load font " << _font << std::endl;
+		face = NULL;
+	}
+
+	int cellWidth = _size;
+	int cellHeight = _size;
+
+	if (face)
+	{
+		// Set size of glyphs
+		FT_Set_Pixel_Sizes(face, 0, _size);
+
+		// Line metrics are in 1 / 64 pixels like the advances
+		this->ascender = (face->size->metrics.ascender >> 6);
+		this->descender = (face->size->metrics.descender >> 6);
+		this->lineHeight = (face->size->metrics.height >> 6);
+
+		cellWidth = std::max(cellWidth, (int)(face->size->metrics.max_advance >> 6));
+		cellHeight = std::max(cellHeight, (int)((face->size->metrics.ascender - face->size->metrics.descender) >> 6));
+	}
+
+	// Distance field bitmaps extend by the spread on every side
+	if (mode == kSDF)
+	{
+		cellWidth += kSDFSpread * 2;
+		cellHeight += kSDFSpread * 2;
+	}
+
+	this->cellSize = glm::ivec2(cellWidth + kCellPadding * 2, cellHeight + kCellPadding * 2);
+	this->cellCount = glm::ivec2(std::max(1, kAtlasSize / cellSize.x), std::max(1, kAtlasSize / cellSize.y));
+
+	const int kCells = cellCount.x * cellCount.y;
+	for (int cell = kCells - 1; cell >= 0; cell--)
+	{
+		freeCells.push_back(cell);
+	}
+	cellFrames.assign(kCells, 0);
+
+	// Generate atlas texture, it starts empty
+	atlasPixels.assign(kAtlasSize * kAtlasSize, 0);
+	if (FontCache::isHeadless())
+	{
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, kAtlasSize, kAtlasSize, 0, GL_RED, GL_UNSIGNED_BYTE, &atlasPixels[0]);
+
+	// Set texture filtering options
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return;
+}
+
+Font::~Font()
+{
+	if (face)
+	{
+		FT_Done_Face(face);
+	}
+	if (atlas)
+	{
+		glDeleteTextures(1, &atlas);
+	}
+}
+
+const Character* Font::getGlyph(GLuint _codepoint)
+{
+	if (characters.find(_codepoint) == characters.end())
+	{
+		Character character;
+		if (!LoadGlyph(_codepoint, character))
+		{
+			return nullptr;
+		}
+		characters.insert(std::pair<GLuint, Character>(_codepoint, character));
+	}
+
+	return findGlyph(_codepoint);
+}
+
+const Character* Font::findGlyph(GLuint _codepoint)
+{
+	std::map<GLuint, Character>::iterator it = characters.find(_codepoint);
+	if (it == characters.end())
+	{
+		return nullptr;
+	}
+
+	it->second.LastUse = ++useClock;
+	if (it->second.Cell >= 0)
+	{
+		cellFrames[it->second.Cell] = FontCache::getFrame();
+	}
+
+	return &it->second;
+}
+
+void Font::PinCells(const std::vector<GLint>& _cells)
+{
+	const GLuint kFrame = FontCache::getFrame();
+	for (size_t i = 0; i < _cells.size(); i++)
+	{
+		cellFrames[_cells[i]] = kFrame;
+	}
+
+	return;
+}
+
+GLuint Font::getAtlas() const
+{
+	return atlas;
+}
+
+const std::vector<unsigned char>& Font::getAtlasPixels() const
+{
+	return atlasPixels;
+}
+
+int Font::getAtlasSize() const
+{
+	return kAtlasSize;
+}
+
+FontRenderMode Font::getMode() const
+{
+	return mode;
+}
+
+int Font::getPixelSize() const
+{
+	return pixelSize;
+}
+
+GLuint Font::getGeneration() const
+{
+	return generation;
+}
+
+GLfloat Font::getAscender() const
+{
+	return ascender;
+}
+
+GLfloat Font::getDescender() const
+{
+	return descender;
+}
+
+GLfloat Font::getLineHeight() const
+{
+	return lineHeight;
+}
+
+size_t Font::getResidentGlyphCount() const
+{
+	return characters.size();
+}
+
+bool Font::isFull() const
+{
+	return fullFrame != 0 && fullFrame == FontCache::getFrame();
+}
+
+// Private //
+
+bool Font::LoadGlyph(GLuint _codepoint, Character& _character)
+{
+	if (!face)
+	{
+		return false;
+	}
+
+	// SDF glyphs are rendered from the outline below instead of from the coverage bitmap
+	FT_Int32 loadFlags = FT_LOAD_RENDER;
+#ifdef FONT_CACHE_HAS_SDF
+	if (mode == kSDF)
+	{
+		loadFlags = FT_LOAD_DEFAULT;
+	}
+#endif
+
+	// Load character glyph
+	if (FT_Load_Char(face, _codepoint, loadFlags))
+	{
+		std::cout << "ERROR::FREETYTPE: Failed to load Glyph " << _codepoint << std::endl;
+		return false;
+	}
+
+#ifdef FONT_CACHE_HAS_SDF
+	// Re-render the outline as a distance field, 128 is the edge and higher values are inside
+	if (mode == kSDF && FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF))
+	{
+		std::cout << "ERROR::FREETYTPE: Failed to render SDF Glyph " << _codepoint << std::endl;
+		return false;
+	}
+#endif
+
+	const FT_Bitmap& bitmap = face->glyph->bitmap;
+	const unsigned char* source = bitmap.buffer;
+	int sourcePitch = bitmap.pitch;
+	glm::ivec2 sourceSize((int)bitmap.width, (int)bitmap.rows);
+	glm::ivec2 bearing(face->glyph->bitmap_left, face->glyph->bitmap_top);
+
+#ifndef FONT_CACHE_HAS_SDF
+	std::vector<unsigned char> distanceField;
+	if (mode == kSDF && sourceSize.x > 0 && sourceSize.y > 0)
+	{
+		BuildDistanceField(bitmap, distanceField);
+		sourceSize += glm::ivec2(kSDFSpread * 2);
+		source = &distanceField[0];
+		sourcePitch = sourceSize.x;
+		bearing += glm::ivec2(-kSDFSpread, kSDFSpread);
+	}
+#endif
+
+	// Glyphs bigger than a cell (rare overhanging ones) are cropped to it
+	const int kWidth = std::min(sourceSize.x, cellSize.x - kCellPadding * 2);
+	const int kRows = std::min(sourceSize.y, cellSize.y - kCellPadding * 2);
+
+	_character.Size = glm::ivec2(kWidth, kRows);
+	_character.Bearing = bearing;
+	_character.Advance = static_cast<GLuint>(face->glyph->advance.x);
+	_character.Cell = -1;
+	_character.UVMin = glm::vec2(0.0f, 0.0f);
+	_character.UVMax = glm::vec2(0.0f, 0.0f);
+	_character.LastUse = 0;
+
+	// Whitespace only needs its metrics
+	if (kWidth <= 0 || kRows <= 0)
+	{
+		return true;
+	}
+
+	// Every cell holds a glyph some label drew this frame, nothing can be evicted
+	_character.Cell = AllocateCell();
+	if (_character.Cell < 0)
+	{
+		fullFrame = FontCache::getFrame();
+		return false;
+	}
+
+	const int kX = (_character.Cell % cellCount.x) * cellSize.x + kCellPadding;
+	const int kY = (_character.Cell / cellCount.x) * cellSize.y + kCellPadding;
+
+	// Copy row by row since FreeType rows can be padded past the glyph width, the rest of the cell is cleared
+	std::vector<unsigned char> pixels((cellSize.x - kCellPadding * 2) * (cellSize.y - kCellPadding * 2), 0);
+	for (int row = 0; row < kRows; row++)
+	{
+		std::copy(
+			source + row * sourcePitch,
+			source + row * sourcePitch + kWidth,
+			pixels.begin() + row * (cellSize.x - kCellPadding * 2)
+		);
+	}
+
+	for (int row = 0; row < cellSize.y - kCellPadding * 2; row++)
+	{
+		std::copy(
+			pixels.begin() + row * (cellSize.x - kCellPadding * 2),
+			pixels.begin() + (row + 1) * (cellSize.x - kCellPadding * 2),
+			atlasPixels.begin() + (kY + row) * kAtlasSize + kX
+		);
+	}
+
+	if (atlas)
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, kX, kY, cellSize.x - kCellPadding * 2, cellSize.y - kCellPadding * 2, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	_character.UVMin = glm::vec2(kX, kY) / glm::vec2(kAtlasSize, kAtlasSize);
+	_character.UVMax = glm::vec2(kX + kWidth, kY + kRows) / glm::vec2(kAtlasSize, kAtlasSize);
+
+	return true;
+}
+
+GLint Font::AllocateCell()
+{
+	if (!freeCells.empty())
+	{
+		const GLint kCell = freeCells.back();
+		freeCells.pop_back();
+		return kCell;
+	}
+
+	// Atlas is full, evict the least recently used glyph that no label has used this frame
+	const GLuint kFrame = FontCache::getFrame();
+	std::map<GLuint, Character>::iterator oldest = characters.end();
+	for (std::map<GLuint, Character>::iterator it = characters.begin(); it != characters.end(); it++)
+	{
+		if (it->second.Cell < 0 || (kFrame != 0 && cellFrames[it->second.Cell] == kFrame))
+		{
+			continue;
+		}
+		if (oldest == characters.end() || it->second.LastUse < oldest->second.LastUse)
+		{
+			oldest = it;
+		}
+	}
+
+	if (oldest == characters.end())
+	{
+		return -1;
+	}
+
+	const GLint kCell = oldest->second.Cell;
+	characters.erase(oldest);
+	generation++;
+
+	return kCell;
+}
+
+// FontCache //
+
+Font* FontCache::getFont(std::string _font, int _size, FontRenderMode _mode)
+{
+	// Initialise freetype once for the whole process
+	if (!library)
+	{
+		if (FT_Init_FreeType(&library))
+		{
+			std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+			library = NULL;
+			return nullptr;
+		}
+
+#ifdef FONT_CACHE_HAS_SDF
+		FT_Int spread = kSDFSpread;
+		FT_Property_Set(library, "sdf", "spread", &spread);
+#else
+		std::cout << "FreeType is older than 2.11, SDF glyphs are built from coverage bitmaps on the CPU" << std::endl;
+#endif
+	}
+
+	// SDF fonts share one atlas for every size they are drawn at
+	if (_mode == kSDF)
+	{
+		_size = kSDFPixelSize;
+	}
+
+	const std::tuple<std::string, int, FontRenderMode> kKey(_font, _size, _mode);
+
+	std::map<std::tuple<std::string, int, FontRenderMode>, Font*>::iterator it = fonts.find(kKey);
+	if (it != fonts.end())
+	{
+		return it->second;
+	}
+
+	Font* font = new Font(library, _font, _size, _mode);
+	fonts.insert(std::pair<std::tuple<std::string, int, FontRenderMode>, Font*>(kKey, font));
+
+	return font;
+}
+
+void FontCache::Clear()
+{
+	for (std::map<std::tuple<std::string, int, FontRenderMode>, Font*>::iterator it = fonts.begin(); it != fonts.end(); it++)
+	{
+		delete it->second;
+	}
+	fonts.clear();
+
+	// Destroy FreeType once we're finished
+	if (library)
+	{
+		FT_Done_FreeType(library);
+		library = NULL;
+	}
+
+	return;
+}
+
+void FontCache::setHeadless(bool _bHeadless)
+{
+	bHeadless = _bHeadless;
+
+	return;
+}
+
+bool FontCache::isHeadless()
+{
+	return bHeadless;
+}
+
+void FontCache::BeginFrame()
+{
+	frame++;
+
+	return;
+}
+
+GLuint FontCache::getFrame()
+{
+	return frame;
+}
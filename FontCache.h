@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <GL/glew.h>
+#include "Dependencies/glm/glm/glm.hpp"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+enum FontRenderMode
+{
+	kBitmap = 0,	// coverage bitmaps, crisp only at the rasterized size
+	kSDF,			// signed distance field, one small atlas scales to any size
+};
+
+struct Character
+{
+	glm::vec2	UVMin;		// top left of the glyph in the atlas
+	glm::vec2	UVMax;		// bottom right of the glyph in the atlas
+	glm::ivec2	Size;		// glyph Size
+	glm::ivec2	Bearing;	// baseline to left/top of glyph
+	GLuint		Advance;	// id to next glyph
+	GLint		Cell;		// atlas cell holding the bitmap, -1 for empty glyphs
+	GLuint		LastUse;	// use stamp for LRU eviction
+};
+
+// One face at one pixel size, glyphs are rasterized into its atlas the first time they are asked for
+class Font
+{
+public:
+	Font(FT_Library _library, std::string _font, int _size, FontRenderMode _mode);
+	~Font();
+
+	// Loads the glyph on first use, null when it can't be loaded or every atlas cell is pinned this frame
+	const Character* getGlyph(GLuint _codepoint);
+	// Only glyphs already in the atlas, never loads or evicts
+	const Character* findGlyph(GLuint _codepoint);
+	// Keeps the glyphs in these cells from being evicted until FontCache::BeginFrame is called again
+	void PinCells(const std::vector<GLint>& _cells);
+
+	// 0 while FontCache is headless
+	GLuint getAtlas() const;
+	// CPU copy of the atlas, kept in step with every upload, rows from v = 0 like the texture
+	const std::vector<unsigned char>& getAtlasPixels() const;
+	int getAtlasSize() const;
+	FontRenderMode getMode() const;
+	int getPixelSize() const;
+	GLuint getGeneration() const;
+	GLfloat getAscender() const;
+	GLfloat getDescender() const;
+	GLfloat getLineHeight() const;
+	size_t getResidentGlyphCount() const;
+	// A glyph failed to load this frame because every atlas cell was pinned
+	bool isFull() const;
+
+private:
+	FT_Face face;
+
+	FontRenderMode mode;
+	int pixelSize;
+
+	std::map<GLuint, Character> characters;
+
+	GLuint atlas;
+	std::vector<unsigned char> atlasPixels;
+	glm::ivec2 cellSize;
+	glm::ivec2 cellCount;
+	std::vector<GLint> freeCells;
+	std::vector<GLuint> cellFrames;	// FontCache frame each cell was last used in, the current frame's are pinned
+
+	GLuint useClock;
+	GLuint fullFrame;	// FontCache frame a glyph last failed to fit in, 0 if never
+	GLuint generation;	// bumped whenever a glyph is evicted, cached layouts must be rebuilt
+
+	GLfloat ascender;
+	GLfloat descender;
+	GLfloat lineHeight;
+
+	bool LoadGlyph(GLuint _codepoint, Character& _character);
+	// -1 when the atlas is full and every glyph in it is pinned
+	GLint AllocateCell();
+};
+
+// Process wide cache so every label using the same font and size shares one face and atlas
+class FontCache
+{
+public:
+	static Font* getFont(std::string _font, int _size, FontRenderMode _mode);
+	static void Clear();
+
+	// Starts a frame. Labels laid out earlier in a frame keep their UVs, the glyphs they use can't be
+	// evicted for another label until the next frame. Nothing is pinned before the first call.
+	static void BeginFrame();
+	static GLuint getFrame();
+
+	// Fonts created while headless keep their atlas in memory only, for running without a GL context
+	static void setHeadless(bool _bHeadless);
+	static bool isHeadless();
+
+private:
+	static FT_Library library;
+	static bool bHeadless;
+	static GLuint frame;
+	static std::map<std::tuple<std::string, int, FontRenderMode>, Font*> fonts;
+};
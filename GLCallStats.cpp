@@ -0,0 +1,255 @@
+#include "GLCallStats.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+// Calls made outside every scope land here
+static const char* kDefaultScope = "Other";
+
+static const char* kCallTypeNames[kGLCallTypeCount] = {
+	"draws",
+	"uniforms",
+	"uniform_lookups",
+	"program_binds",
+	"texture_binds",
+	"buffer_binds",
+	"state_changes",
+	"buffer_uploads",
+	"texture_uploads"
+};
+
+static std::ofstream logFile;
+
+std::vector<std::pair<std::string, GLCallCounts>> GLCallStats::scopes(1, std::make_pair(std::string(kDefaultScope), GLCallCounts()));
+std::vector<std::pair<std::string, GLCallCounts>> GLCallStats::lastScopes;
+GLCallCounts GLCallStats::lastTotals = {};
+size_t GLCallStats::currentScope = 0;
+uint64_t GLCallStats::frame = 0;
+
+static void WriteRow(std::ostream& _stream, uint64_t _frame, const std::string& _scope, const GLCallCounts& _counts)
+{
+	_stream << _frame << "," << _scope;
+	for (int i = 0; i < kGLCallTypeCount; i++) {
+		_stream << "," << _counts.Calls[i];
+	}
+	_stream << "," << _counts.Triangles << "," << _counts.UploadBytes << "\n";
+
+	return;
+}
+
+// Public //
+
+GLCallStats::Scope::Scope(const std::string& _name)
+{
+	this->previous = currentScope;
+	currentScope = FindScope(_name);
+	return;
+}
+
+GLCallStats::Scope::~Scope()
+{
+	currentScope = previous;
+	return;
+}
+
+void GLCallStats::BeginFrame()
+{
+	// Scopes are kept so their order, and the log columns, stay the same from frame to frame
+	for (size_t i = 0; i < scopes.size(); i++) {
+		std::memset(&scopes[i].second, 0, sizeof(GLCallCounts));
+	}
+	currentScope = 0;
+
+	return;
+}
+
+void GLCallStats::EndFrame()
+{
+	lastScopes = scopes;
+	std::memset(&lastTotals, 0, sizeof(GLCallCounts));
+	for (size_t i = 0; i < scopes.size(); i++) {
+		for (int type = 0; type < kGLCallTypeCount; type++) {
+			lastTotals.Calls[type] += scopes[i].second.Calls[type];
+		}
+		lastTotals.Triangles += scopes[i].second.Triangles;
+		lastTotals.UploadBytes += scopes[i].second.UploadBytes;
+	}
+
+	if (logFile.is_open()) {
+		for (size_t i = 0; i < scopes.size(); i++) {
+			WriteRow(logFile, frame, scopes[i].first, scopes[i].second);
+		}
+		WriteRow(logFile, frame, "Total", lastTotals);
+	}
+
+	frame++;
+
+	return;
+}
+
+void GLCallStats::Count(GLCallType _type)
+{
+	scopes[currentScope].second.Calls[_type]++;
+	return;
+}
+
+void GLCallStats::CountDraw(GLenum _mode, GLsizei _count, GLsizei _instanceCount)
+{
+	GLCallCounts& counts = scopes[currentScope].second;
+	counts.Calls[kGLCallDraw]++;
+	if (_mode == GL_TRIANGLES) {
+		counts.Triangles += static_cast<uint64_t>(_count / 3) * _instanceCount;
+	}
+
+	return;
+}
+
+void GLCallStats::CountUpload(GLCallType _type, size_t _bytes)
+{
+	GLCallCounts& counts = scopes[currentScope].second;
+	counts.Calls[_type]++;
+	counts.UploadBytes += _bytes;
+
+	return;
+}
+
+size_t GLCallStats::getImageSize(GLsizei _width, GLsizei _height, GLenum _format, GLenum _type, const void* _pixels)
+{
+	if (!_pixels) {
+		return 0;
+	}
+
+	size_t components = 4;
+	switch (_format) {
+	case GL_RED:
+		components = 1;
+		break;
+	case GL_RG:
+		components = 2;
+		break;
+	case GL_RGB:
+	case GL_BGR:
+		components = 3;
+		break;
+	}
+
+	size_t componentSize = 1;
+	switch (_type) {
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+		componentSize = 2;
+		break;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:
+		componentSize = 4;
+		break;
+	}
+
+	return static_cast<size_t>(_width) * _height * components * componentSize;
+}
+
+bool GLCallStats::OpenLog(const std::string& _fileName)
+{
+	if (!isEnabled()) {
+		std::cout << "GL Call Stats : Build with GL_CALL_STATS defined to log GL calls" << std::endl;
+		return false;
+	}
+
+	CloseLog();
+	logFile.open(_fileName, std::ios::out | std::ios::trunc);
+	if (!logFile.good()) {
+		std::cout << "GL Call Stats : Can't write " << _fileName << std::endl;
+		return false;
+	}
+
+	logFile << "frame,scope";
+	for (int i = 0; i < kGLCallTypeCount; i++) {
+		logFile << "," << kCallTypeNames[i];
+	}
+	logFile << ",triangles,upload_bytes\n";
+
+	return true;
+}
+
+void GLCallStats::CloseLog()
+{
+	if (logFile.is_open()) {
+		logFile.close();
+	}
+
+	return;
+}
+
+bool GLCallStats::isEnabled()
+{
+#ifdef GL_CALL_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t GLCallStats::getFrame()
+{
+	return frame;
+}
+
+const GLCallCounts& GLCallStats::getFrameTotals()
+{
+	return lastTotals;
+}
+
+const std::vector<std::pair<std::string, GLCallCounts>>& GLCallStats::getFrameScopes()
+{
+	return lastScopes;
+}
+
+std::string GLCallStats::getOverlayText()
+{
+	if (!isEnabled()) {
+		return "GL call stats need a GL_CALL_STATS build";
+	}
+
+	std::ostringstream text;
+	text << "GL calls, frame " << frame;
+
+	std::vector<std::pair<std::string, GLCallCounts>> rows = lastScopes;
+	rows.push_back(std::make_pair(std::string("Total"), lastTotals));
+	for (size_t i = 0; i < rows.size(); i++) {
+		const GLCallCounts& kCounts = rows[i].second;
+		text << "\n" << rows[i].first << ": "
+			<< kCounts.Calls[kGLCallDraw] << " draws, " << kCounts.Triangles << " tris, "
+			<< kCounts.Calls[kGLCallUniform] << " uniforms, " << kCounts.Calls[kGLCallUniformLookup] << " lookups, "
+			<< kCounts.Calls[kGLCallProgramBind] + kCounts.Calls[kGLCallTextureBind] + kCounts.Calls[kGLCallBufferBind] + kCounts.Calls[kGLCallStateChange] << " state, "
+			<< kCounts.Calls[kGLCallBufferUpload] + kCounts.Calls[kGLCallTextureUpload] << " uploads, "
+			<< kCounts.UploadBytes / 1024 << " KB";
+	}
+
+	return text.str();
+}
+
+const char* GLCallStats::getCallTypeName(GLCallType _type)
+{
+	return (_type < kGLCallTypeCount) ? kCallTypeNames[_type] : "";
+}
+
+// Private //
+
+size_t GLCallStats::FindScope(const std::string& _name)
+{
+	for (size_t i = 0; i < scopes.size(); i++) {
+		if (scopes[i].first == _name) {
+			return i;
+		}
+	}
+
+	GLCallCounts counts;
+	std::memset(&counts, 0, sizeof(counts));
+	scopes.push_back(std::make_pair(_name, counts));
+
+	return scopes.size() - 1;
+}
@@ -0,0 +1,288 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+enum GLCallType
+{
+	kGLCallDraw = 0,		// glDrawElements*, glDrawArrays, every range of a multi draw
+	kGLCallUniform,			// glUniform*
+	kGLCallUniformLookup,	// glGetUniformLocation
+	kGLCallProgramBind,		// glUseProgram
+	kGLCallTextureBind,		// glBindTexture, glActiveTexture
+	kGLCallBufferBind,		// glBindBuffer, glBindBufferBase, glBindVertexBuffer, glBindVertexArray
+	kGLCallStateChange,		// glEnable, glDisable, glBlendFunc
+	kGLCallBufferUpload,	// glBufferData, glBufferSubData
+	kGLCallTextureUpload,	// glTexImage2D, glTexSubImage2D
+	kGLCallTypeCount
+};
+
+struct GLCallCounts
+{
+	uint32_t	Calls[kGLCallTypeCount];
+	uint64_t	Triangles;		// GL_TRIANGLES draws, every instance
+	uint64_t	UploadBytes;	// buffer and texture data handed to the driver
+};
+
+// Debug tallies of the GL calls a frame makes, split by the scope that was open when they were made.
+// Counting only happens in builds with GL_CALL_STATS defined, where including this header last in a
+// .cpp routes the GL entry points the renderers use through counting wrappers. Elsewhere it costs nothing.
+class GLCallStats
+{
+public:
+	// Calls until it goes away are put down to _name, scopes nest
+	class Scope
+	{
+	public:
+		Scope(const std::string& _name);
+		~Scope();
+
+	private:
+		size_t previous;
+	};
+
+	// Starts counting a new frame, the last one stays readable until the next EndFrame
+	static void BeginFrame();
+	// Closes the frame and appends a row per scope to the log when one is open
+	static void EndFrame();
+
+	static void Count(GLCallType _type);
+	static void CountDraw(GLenum _mode, GLsizei _count, GLsizei _instanceCount);
+	static void CountUpload(GLCallType _type, size_t _bytes);
+	// Bytes a glTexImage2D sized upload sends, 0 when there is no data
+	static size_t getImageSize(GLsizei _width, GLsizei _height, GLenum _format, GLenum _type, const void* _pixels);
+
+	// CSV with one row per scope per frame and a "Total" row, for comparing builds
+	static bool OpenLog(const std::string& _fileName);
+	static void CloseLog();
+
+	static bool isEnabled();
+	static uint64_t getFrame();
+	// Last finished frame
+	static const GLCallCounts& getFrameTotals();
+	static const std::vector<std::pair<std::string, GLCallCounts>>& getFrameScopes();
+	// A line per scope for the on-screen overlay
+	static std::string getOverlayText();
+	static const char* getCallTypeName(GLCallType _type);
+
+private:
+	static std::vector<std::pair<std::string, GLCallCounts>> scopes;
+	static std::vector<std::pair<std::string, GLCallCounts>> lastScopes;
+	static GLCallCounts lastTotals;
+	static size_t currentScope;
+	static uint64_t frame;
+
+	static size_t FindScope(const std::string& _name);
+};
+
+#ifdef GL_CALL_STATS
+
+// Wrappers call through whatever the names meant before, a plain function or a GLEW pointer
+inline void GLCallStats_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	GLCallStats::CountDraw(mode, count, 1);
+	glDrawElements(mode, count, type, indices);
+}
+
+inline void GLCallStats_glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+{
+	GLCallStats::CountDraw(mode, count, 1);
+	glDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+}
+
+inline void GLCallStats_glDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex)
+{
+	GLCallStats::CountDraw(mode, count, instancecount);
+	glDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+}
+
+inline void GLCallStats_glMultiDrawElements(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawcount)
+{
+	for (GLsizei i = 0; i < drawcount; i++) {
+		GLCallStats::CountDraw(mode, count[i], 1);
+	}
+	glMultiDrawElements(mode, count, type, indices, drawcount);
+}
+
+inline void GLCallStats_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	GLCallStats::CountDraw(mode, count, 1);
+	glDrawArrays(mode, first, count);
+}
+
+inline void GLCallStats_glUniform1f(GLint location, GLfloat v0)
+{
+	GLCallStats::Count(kGLCallUniform);
+	glUniform1f(location, v0);
+}
+
+inline void GLCallStats_glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	GLCallStats::Count(kGLCallUniform);
+	glUniform2f(location, v0, v1);
+}
+
+inline void GLCallStats_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	GLCallStats::Count(kGLCallUniform);
+	glUniform3f(location, v0, v1, v2);
+}
+
+inline void GLCallStats_glUniform3ui(GLint location, GLuint v0, GLuint v1, GLuint v2)
+{
+	GLCallStats::Count(kGLCallUniform);
+	glUniform3ui(location, v0, v1, v2);
+}
+
+inline void GLCallStats_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	GLCallStats::Count(kGLCallUniform);
+	glUniformMatrix4fv(location, count, transpose, value);
+}
+
+inline GLint GLCallStats_glGetUniformLocation(GLuint program, const GLchar* name)
+{
+	GLCallStats::Count(kGLCallUniformLookup);
+	return glGetUniformLocation(program, name);
+}
+
+inline void GLCallStats_glUseProgram(GLuint program)
+{
+	GLCallStats::Count(kGLCallProgramBind);
+	glUseProgram(program);
+}
+
+inline void GLCallStats_glBindTexture(GLenum target, GLuint texture)
+{
+	GLCallStats::Count(kGLCallTextureBind);
+	glBindTexture(target, texture);
+}
+
+inline void GLCallStats_glActiveTexture(GLenum texture)
+{
+	GLCallStats::Count(kGLCallTextureBind);
+	glActiveTexture(texture);
+}
+
+inline void GLCallStats_glBindBuffer(GLenum target, GLuint buffer)
+{
+	GLCallStats::Count(kGLCallBufferBind);
+	glBindBuffer(target, buffer);
+}
+
+inline void GLCallStats_glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	GLCallStats::Count(kGLCallBufferBind);
+	glBindBufferBase(target, index, buffer);
+}
+
+inline void GLCallStats_glBindVertexBuffer(GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride)
+{
+	GLCallStats::Count(kGLCallBufferBind);
+	glBindVertexBuffer(bindingindex, buffer, offset, stride);
+}
+
+inline void GLCallStats_glBindVertexArray(GLuint array)
+{
+	GLCallStats::Count(kGLCallBufferBind);
+	glBindVertexArray(array);
+}
+
+inline void GLCallStats_glEnable(GLenum cap)
+{
+	GLCallStats::Count(kGLCallStateChange);
+	glEnable(cap);
+}
+
+inline void GLCallStats_glDisable(GLenum cap)
+{
+	GLCallStats::Count(kGLCallStateChange);
+	glDisable(cap);
+}
+
+inline void GLCallStats_glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	GLCallStats::Count(kGLCallStateChange);
+	glBlendFunc(sfactor, dfactor);
+}
+
+inline void GLCallStats_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	// Orphaning with no data still counts as a call but sends nothing
+	GLCallStats::CountUpload(kGLCallBufferUpload, data ? static_cast<size_t>(size) : 0);
+	glBufferData(target, size, data, usage);
+}
+
+inline void GLCallStats_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	GLCallStats::CountUpload(kGLCallBufferUpload, static_cast<size_t>(size));
+	glBufferSubData(target, offset, size, data);
+}
+
+inline void GLCallStats_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	GLCallStats::CountUpload(kGLCallTextureUpload, GLCallStats::getImageSize(width, height, format, type, pixels));
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+inline void GLCallStats_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	GLCallStats::CountUpload(kGLCallTextureUpload, GLCallStats::getImageSize(width, height, format, type, pixels));
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+#undef glDrawElements
+#undef glDrawElementsBaseVertex
+#undef glDrawElementsInstancedBaseVertex
+#undef glMultiDrawElements
+#undef glDrawArrays
+#undef glUniform1f
+#undef glUniform2f
+#undef glUniform3f
+#undef glUniform3ui
+#undef glUniformMatrix4fv
+#undef glGetUniformLocation
+#undef glUseProgram
+#undef glBindTexture
+#undef glActiveTexture
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glBindVertexBuffer
+#undef glBindVertexArray
+#undef glEnable
+#undef glDisable
+#undef glBlendFunc
+#undef glBufferData
+#undef glBufferSubData
+#undef glTexImage2D
+#undef glTexSubImage2D
+
+#define glDrawElements GLCallStats_glDrawElements
+#define glDrawElementsBaseVertex GLCallStats_glDrawElementsBaseVertex
+#define glDrawElementsInstancedBaseVertex GLCallStats_glDrawElementsInstancedBaseVertex
+#define glMultiDrawElements GLCallStats_glMultiDrawElements
+#define glDrawArrays GLCallStats_glDrawArrays
+#define glUniform1f GLCallStats_glUniform1f
+#define glUniform2f GLCallStats_glUniform2f
+#define glUniform3f GLCallStats_glUniform3f
+#define glUniform3ui GLCallStats_glUniform3ui
+#define glUniformMatrix4fv GLCallStats_glUniformMatrix4fv
+#define glGetUniformLocation GLCallStats_glGetUniformLocation
+#define glUseProgram GLCallStats_glUseProgram
+#define glBindTexture GLCallStats_glBindTexture
+#define glActiveTexture GLCallStats_glActiveTexture
+#define glBindBuffer GLCallStats_glBindBuffer
+#define glBindBufferBase GLCallStats_glBindBufferBase
+#define glBindVertexBuffer GLCallStats_glBindVertexBuffer
+#define glBindVertexArray GLCallStats_glBindVertexArray
+#define glEnable GLCallStats_glEnable
+#define glDisable GLCallStats_glDisable
+#define glBlendFunc GLCallStats_glBlendFunc
+#define glBufferData GLCallStats_glBufferData
+#define glBufferSubData GLCallStats_glBufferSubData
+#define glTexImage2D GLCallStats_glTexImage2D
+#define glTexSubImage2D GLCallStats_glTexSubImage2D
+
+#endif
@@ -0,0 +1,131 @@
+#include "IndexBuffer.h"
+
+#include <iostream>
+
+#include "GLCallStats.h"
+
+// Marks a vertex that isn't in the chunk being filled yet
+static const uint32_t kUnassigned = 0xFFFFFFFF;
+
+static void Narrow(const uint32_t* _indices, size_t _indexCount, std::vector<uint16_t>& narrowed)
+{
+	narrowed.resize(_indexCount);
+	for (size_t i = 0; i < _indexCount; i++) {
+		narrowed[i] = static_cast<uint16_t>(_indices[i]);
+	}
+	return;
+}
+
+// Public //
+
+GLenum IndexBuffer::SelectType(size_t _vertexCount)
+{
+	return (_vertexCount <= kMaxShortIndexVertices) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+GLsizei IndexBuffer::getTypeSize(GLenum _indexType)
+{
+	return (_indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+void IndexBuffer::Upload(GLenum _indexType, const uint32_t* _indices, size_t _indexCount, GLenum _usage)
+{
+	if (_indexType == GL_UNSIGNED_INT) {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * _indexCount, _indices, _usage);
+		return;
+	}
+
+	std::vector<uint16_t> narrowed;
+	Narrow(_indices, _indexCount, narrowed);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * _indexCount, narrowed.data(), _usage);
+
+	return;
+}
+
+void IndexBuffer::UploadRange(GLenum _indexType, size_t _firstIndex, const uint32_t* _indices, size_t _indexCount)
+{
+	const GLsizei kTypeSize = getTypeSize(_indexType);
+
+	if (_indexType == GL_UNSIGNED_INT) {
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, kTypeSize * _firstIndex, kTypeSize * _indexCount, _indices);
+		return;
+	}
+
+	std::vector<uint16_t> narrowed;
+	Narrow(_indices, _indexCount, narrowed);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, kTypeSize * _firstIndex, kTypeSize * _indexCount, narrowed.data());
+
+	return;
+}
+
+void IndexBuffer::Split(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, size_t _maxVertices, std::vector<Vertex>& chunkVertices, std::vector<uint32_t>& chunkIndices, std::vector<MeshChunk>& chunks)
+{
+	chunks.clear();
+
+	// Small enough already, one chunk covers it as is
+	if (_vertices.size() <= _maxVertices) {
+		chunkVertices = _vertices;
+		chunkIndices = _indices;
+		MeshChunk chunk = { 0, static_cast<uint32_t>(_indices.size()), 0, static_cast<uint32_t>(_vertices.size()) };
+		chunks.push_back(chunk);
+		return;
+	}
+
+	chunkVertices.clear();
+	chunkIndices.clear();
+	chunkVertices.reserve(_vertices.size());
+	chunkIndices.reserve(_indices.size());
+
+	// Chunk local index of each source vertex, only the ones the current chunk touched need resetting
+	std::vector<uint32_t> remap(_vertices.size(), kUnassigned);
+	std::vector<uint32_t> touched;
+	touched.reserve(_maxVertices);
+
+	MeshChunk chunk = { 0, 0, 0, 0 };
+
+	for (size_t t = 0; t + 2 < _indices.size(); t += 3) {
+		const uint32_t kA = _indices[t + 0];
+		const uint32_t kB = _indices[t + 1];
+		const uint32_t kC = _indices[t + 2];
+
+		const uint32_t kNewVertices =
+			(remap[kA] == kUnassigned ? 1 : 0) +
+			(remap[kB] == kUnassigned && kB != kA ? 1 : 0) +
+			(remap[kC] == kUnassigned && kC != kA && kC != kB ? 1 : 0);
+
+		// Close the chunk when this triangle wouldn't fit in it
+		if (chunk.VertexCount + kNewVertices > _maxVertices) {
+			chunks.push_back(chunk);
+
+			for (size_t i = 0; i < touched.size(); i++) {
+				remap[touched[i]] = kUnassigned;
+			}
+			touched.clear();
+
+			chunk.FirstIndex = static_cast<uint32_t>(chunkIndices.size());
+			chunk.IndexCount = 0;
+			chunk.BaseVertex = static_cast<uint32_t>(chunkVertices.size());
+			chunk.VertexCount = 0;
+		}
+
+		for (size_t corner = 0; corner < 3; corner++) {
+			const uint32_t kVertex = _indices[t + corner];
+			if (remap[kVertex] == kUnassigned) {
+				remap[kVertex] = chunk.VertexCount++;
+				chunkVertices.push_back(_vertices[kVertex]);
+				touched.push_back(kVertex);
+			}
+			chunkIndices.push_back(remap[kVertex]);
+		}
+		chunk.IndexCount += 3;
+	}
+
+	if (chunk.IndexCount > 0) {
+		chunks.push_back(chunk);
+	}
+
+	std::cout << "Index Buffer : split " << _vertices.size() << " vertices into " << chunks.size() << " chunks holding "
+		<< chunkVertices.size() << " vertices" << std::endl;
+
+	return;
+}
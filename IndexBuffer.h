@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+// Most vertices a 16 bit index can reach
+static const size_t kMaxShortIndexVertices = 65536;
+
+// A range of a split mesh, its indices are relative to BaseVertex so they always fit in 16 bits
+struct MeshChunk
+{
+	uint32_t	FirstIndex;
+	uint32_t	IndexCount;
+	uint32_t	BaseVertex;
+	uint32_t	VertexCount;
+};
+
+// Picks the narrowest index type a mesh can use and uploads indices in it
+class IndexBuffer
+{
+public:
+	// GL_UNSIGNED_SHORT whenever every vertex is reachable with it, otherwise GL_UNSIGNED_INT
+	static GLenum SelectType(size_t _vertexCount);
+	static GLsizei getTypeSize(GLenum _indexType);
+
+	// Fill the bound GL_ELEMENT_ARRAY_BUFFER, narrowing the indices to _indexType on the way
+	static void Upload(GLenum _indexType, const uint32_t* _indices, size_t _indexCount, GLenum _usage);
+	static void UploadRange(GLenum _indexType, size_t _firstIndex, const uint32_t* _indices, size_t _indexCount);
+
+	// Breaks a mesh into chunks of at most _maxVertices vertices each, walking the triangles in order so
+	// the cache and fetch order survive. Vertices shared across a chunk boundary are duplicated.
+	static void Split(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, size_t _maxVertices, std::vector<Vertex>& chunkVertices, std::vector<uint32_t>& chunkIndices, std::vector<MeshChunk>& chunks);
+};
@@ -8,6 +8,9 @@
 
 #include "Mesh.h"
 #include "Camera.h"
+#include "IndexBuffer.h"
+#include "VertexLayout.h"
+#include "CommandBuffer.h"
 
 class LightRenderer
 {
@@ -15,7 +18,10 @@ public:
 	LightRenderer(MeshType meshType, Camera* camera);
 	~LightRenderer();
 
+	// Records the draw and replays it straight away
 	void Draw();
+	// Appends the draw without touching GL
+	void Record(CommandBuffer& commands);
 
 	void setColor(glm::vec3 _color);
 	void setPosition(glm::vec3 _position);
@@ -27,18 +33,21 @@ public:
 private:
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
+	GLenum indexType;
 
 	glm::vec3 position;
 	glm::vec3 color;
 
 	GLuint vbo; // Vertex Buffer Object
 	GLuint ebo; // Element Buffer Object;
-	GLuint vao; // Vertex Array Object
 	GLuint program;
 
 	Camera* camera;
 
-	virtual void SetupModelViewProjectionMatrix();
+	CommandBuffer drawCommands;	// reused by Draw
+	GLCommandExecutor drawExecutor;
+
+	virtual void RecordModelViewProjectionMatrix(CommandBuffer& commands) const;
 	void HandleMeshType(MeshType _meshType);
 	void HandleGLSetup();
 };
@@ -0,0 +1,987 @@
+#include "Loader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+#include "MappedFile.h"
+
+// Chunks smaller than this are not worth a thread of their own
+static const size_t kMinChunkBytes = 1024 * 1024;
+
+// Runs _function(begin, end) over [0, _count) split across _threadCount threads
+template <typename Function>
+static void ParallelFor(size_t _count, unsigned int _threadCount, Function _function)
+{
+	const size_t kThreads = std::max<size_t>(1, std::min<size_t>(_threadCount, _count / 4096 + 1));
+	if (kThreads == 1) {
+		_function(0, _count);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	const size_t kStep = (_count + kThreads - 1) / kThreads;
+	for (size_t begin = 0; begin < _count; begin += kStep) {
+		threads.push_back(std::thread(_function, begin, std::min(begin + kStep, _count)));
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	return;
+}
+
+// Text Parsing //
+
+static bool IsSpace(char _c)
+{
+	return _c == ' ' || _c == '\t';
+}
+
+static bool IsLineEnd(char _c)
+{
+	return _c == '\n' || _c == '\r';
+}
+
+static const char* SkipSpaces(const char* _p, const char* _end)
+{
+	while (_p < _end && IsSpace(*_p)) {
+		_p++;
+	}
+	return _p;
+}
+
+static const char* SkipLine(const char* _p, const char* _end)
+{
+	while (_p < _end && *_p != '\n') {
+		_p++;
+	}
+	return (_p < _end) ? _p + 1 : _end;
+}
+
+// Like strtod but bounded by _end, the mapped file isn't null terminated
+static const char* ParseDouble(const char* _p, const char* _end, double& _value)
+{
+	static const double kPowers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	bool bNegative = false;
+	if (_p < _end && (*_p == '-' || *_p == '+')) {
+		bNegative = (*_p == '-');
+		_p++;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+
+	while (_p < _end && *_p >= '0' && *_p <= '9') {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*_p - '0');
+			digits++;
+		}
+		else {
+			exponent++;
+		}
+		_p++;
+	}
+
+	if (_p < _end && *_p == '.') {
+		_p++;
+		while (_p < _end && *_p >= '0' && *_p <= '9') {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*_p - '0');
+				digits++;
+				exponent--;
+			}
+			_p++;
+		}
+	}
+
+	if (_p < _end && (*_p == 'e' || *_p == 'E')) {
+		_p++;
+		bool bNegativeExponent = false;
+		if (_p < _end && (*_p == '-' || *_p == '+')) {
+			bNegativeExponent = (*_p == '-');
+			_p++;
+		}
+
+		int explicitExponent = 0;
+		while (_p < _end && *_p >= '0' && *_p <= '9') {
+			explicitExponent = std::min(explicitExponent * 10 + (*_p - '0'), 1000);
+			_p++;
+		}
+		exponent += bNegativeExponent ? -explicitExponent : explicitExponent;
+	}
+
+	double value = static_cast<double>(mantissa);
+	if (exponent < 0) {
+		value = (exponent >= -22) ? value / kPowers[-exponent] : value * std::pow(10.0, exponent);
+	}
+	else if (exponent > 0) {
+		value = (exponent <= 22) ? value * kPowers[exponent] : value * std::pow(10.0, exponent);
+	}
+
+	_value = bNegative ? -value : value;
+	return _p;
+}
+
+static const char* ParseFloat(const char* _p, const char* _end, float& _value)
+{
+	double value = 0.0;
+	_p = ParseDouble(_p, _end, value);
+	_value = static_cast<float>(value);
+	return _p;
+}
+
+static const char* ParseInt(const char* _p, const char* _end, int32_t& _value)
+{
+	bool bNegative = false;
+	if (_p < _end && (*_p == '-' || *_p == '+')) {
+		bNegative = (*_p == '-');
+		_p++;
+	}
+
+	int64_t value = 0;
+	while (_p < _end && *_p >= '0' && *_p <= '9') {
+		value = std::min<int64_t>(value * 10 + (*_p - '0'), INT32_MAX);
+		_p++;
+	}
+
+	_value = static_cast<int32_t>(bNegative ? -value : value);
+	return _p;
+}
+
+// OBJ //
+
+// Zero based indices into the merged position, uv and normal arrays, -1 when absent
+struct ObjCorner
+{
+	int32_t		Position;
+	int32_t		TexCoord;
+	int32_t		Normal;
+};
+
+static bool operator==(const ObjCorner& _a, const ObjCorner& _b)
+{
+	return _a.Position == _b.Position && _a.TexCoord == _b.TexCoord && _a.Normal == _b.Normal;
+}
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& _corner) const
+	{
+		uint64_t hash = static_cast<uint32_t>(_corner.Position);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(_corner.TexCoord);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(_corner.Normal);
+		return static_cast<size_t>(hash ^ (hash >> 29));
+	}
+};
+
+// Negative OBJ indices count back from the current element, which may live in an earlier chunk.
+// Those are stored relative to the chunk start and fixed up once every chunk's counts are known.
+static const uint8_t kRelativePosition = 1;
+static const uint8_t kRelativeTexCoord = 2;
+static const uint8_t kRelativeNormal = 4;
+
+struct ObjChunk
+{
+	const char*				Begin;
+	const char*				End;
+	std::vector<glm::vec3>	Positions;
+	std::vector<glm::vec2>	TexCoords;
+	std::vector<glm::vec3>	Normals;
+	std::vector<ObjCorner>	Corners;		// 3 per triangle
+	std::vector<uint8_t>	RelativeFlags;	// 1 per corner
+};
+
+static int32_t ResolveObjIndex(int32_t _index, size_t _localCount, uint8_t _relativeFlag, uint8_t& _flags)
+{
+	if (_index > 0) {
+		return _index - 1;
+	}
+	if (_index < 0) {
+		_flags |= _relativeFlag;
+		return static_cast<int32_t>(_localCount) + _index;
+	}
+	return -1;
+}
+
+static void ParseObjChunk(ObjChunk& _chunk)
+{
+	std::vector<ObjCorner> face;
+	std::vector<uint8_t> faceFlags;
+
+	const char* p = _chunk.Begin;
+	const char* end = _chunk.End;
+
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (p >= end) {
+			break;
+		}
+
+		if (p[0] == 'v' && p + 1 < end && IsSpace(p[1])) {
+			glm::vec3 position;
+			p = ParseFloat(SkipSpaces(p + 2, end), end, position.x);
+			p = ParseFloat(SkipSpaces(p, end), end, position.y);
+			p = ParseFloat(SkipSpaces(p, end), end, position.z);
+			_chunk.Positions.push_back(position);
+		}
+		else if (p[0] == 'v' && p + 2 < end && p[1] == 't' && IsSpace(p[2])) {
+			glm::vec2 texCoord;
+			p = ParseFloat(SkipSpaces(p + 3, end), end, texCoord.x);
+			p = ParseFloat(SkipSpaces(p, end), end, texCoord.y);
+			// OBJ v goes up, our textures are loaded top row first
+			texCoord.y = 1.0f - texCoord.y;
+			_chunk.TexCoords.push_back(texCoord);
+		}
+		else if (p[0] == 'v' && p + 2 < end && p[1] == 'n' && IsSpace(p[2])) {
+			glm::vec3 normal;
+			p = ParseFloat(SkipSpaces(p + 3, end), end, normal.x);
+			p = ParseFloat(SkipSpaces(p, end), end, normal.y);
+			p = ParseFloat(SkipSpaces(p, end), end, normal.z);
+			_chunk.Normals.push_back(normal);
+		}
+		else if (p[0] == 'f' && p + 1 < end && IsSpace(p[1])) {
+			face.clear();
+			faceFlags.clear();
+			p += 2;
+
+			while (true) {
+				p = SkipSpaces(p, end);
+				if (p >= end || IsLineEnd(*p) || *p == '#') {
+					break;
+				}
+
+				int32_t position = 0;
+				int32_t texCoord = 0;
+				int32_t normal = 0;
+
+				const char* start = p;
+				p = ParseInt(p, end, position);
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') {
+						p = ParseInt(p, end, texCoord);
+					}
+					if (p < end && *p == '/') {
+						p = ParseInt(p + 1, end, normal);
+					}
+				}
+				// Skip anything we couldn't read so a bad token can't stall the loop
+				if (p == start) {
+					while (p < end && !IsSpace(*p) && !IsLineEnd(*p)) {
+						p++;
+					}
+					continue;
+				}
+
+				uint8_t flags = 0;
+				ObjCorner corner;
+				corner.Position = ResolveObjIndex(position, _chunk.Positions.size(), kRelativePosition, flags);
+				corner.TexCoord = ResolveObjIndex(texCoord, _chunk.TexCoords.size(), kRelativeTexCoord, flags);
+				corner.Normal = ResolveObjIndex(normal, _chunk.Normals.size(), kRelativeNormal, flags);
+				face.push_back(corner);
+				faceFlags.push_back(flags);
+			}
+
+			// Polygons are fanned into triangles
+			for (size_t i = 2; i < face.size(); i++) {
+				_chunk.Corners.push_back(face[0]);
+				_chunk.Corners.push_back(face[i - 1]);
+				_chunk.Corners.push_back(face[i]);
+				_chunk.RelativeFlags.push_back(faceFlags[0]);
+				_chunk.RelativeFlags.push_back(faceFlags[i - 1]);
+				_chunk.RelativeFlags.push_back(faceFlags[i]);
+			}
+		}
+
+		p = SkipLine(p, end);
+	}
+
+	return;
+}
+
+// JSON //
+
+struct JsonValue
+{
+	enum Type
+	{
+		kNull = 0,
+		kBool,
+		kNumber,
+		kString,
+		kArray,
+		kObject,
+	};
+
+	Type type = kNull;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	const JsonValue* Find(const char* _key) const
+	{
+		for (const std::pair<std::string, JsonValue>& member : members) {
+			if (member.first == _key) {
+				return &member.second;
+			}
+		}
+		return nullptr;
+	}
+
+	double getNumber(const char* _key, double _default) const
+	{
+		const JsonValue* value = Find(_key);
+		return (value && value->type == kNumber) ? value->number : _default;
+	}
+
+	std::string getString(const char* _key) const
+	{
+		const JsonValue* value = Find(_key);
+		return (value && value->type == kString) ? value->string : std::string();
+	}
+};
+
+static const char* SkipJsonSpaces(const char* _p, const char* _end)
+{
+	while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) {
+		_p++;
+	}
+	return _p;
+}
+
+static const char* ParseJsonString(const char* _p, const char* _end, std::string& _string)
+{
+	// Expects _p on the opening quote
+	_p++;
+	while (_p < _end && *_p != '"') {
+		if (*_p == '\\' && _p + 1 < _end) {
+			_p++;
+			switch (*_p) {
+			case 'n': _string += '\n'; break;
+			case 'r': _string += '\r'; break;
+			case 't': _string += '\t'; break;
+			case 'b': _string += '\b'; break;
+			case 'f': _string += '\f'; break;
+			case 'u': {
+				unsigned int codepoint = 0;
+				for (int i = 0; i < 4 && _p + 1 < _end; i++) {
+					const char kHex = *++_p;
+					codepoint = codepoint * 16 + ((kHex >= '0' && kHex <= '9') ? kHex - '0' : ((kHex | 0x20) - 'a' + 10));
+				}
+				// Keys and URIs we care about are ASCII, anything else is kept as UTF-8
+				if (codepoint < 0x80) {
+					_string += static_cast<char>(codepoint);
+				}
+				else if (codepoint < 0x800) {
+					_string += static_cast<char>(0xC0 | (codepoint >> 6));
+					_string += static_cast<char>(0x80 | (codepoint & 0x3F));
+				}
+				else {
+					_string += static_cast<char>(0xE0 | (codepoint >> 12));
+					_string += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+					_string += static_cast<char>(0x80 | (codepoint & 0x3F));
+				}
+				break;
+			}
+			default: _string += *_p; break;
+			}
+		}
+		else {
+			_string += *_p;
+		}
+		_p++;
+	}
+	return (_p < _end) ? _p + 1 : nullptr;
+}
+
+static const char* ParseJsonValue(const char* _p, const char* _end, JsonValue& _value, int _depth)
+{
+	_p = SkipJsonSpaces(_p, _end);
+	if (_p >= _end || _depth > 64) {
+		return nullptr;
+	}
+
+	if (*_p == '{') {
+		_value.type = JsonValue::kObject;
+		_p = SkipJsonSpaces(_p + 1, _end);
+		if (_p < _end && *_p == '}') {
+			return _p + 1;
+		}
+
+		while (_p && _p < _end) {
+			_p = SkipJsonSpaces(_p, _end);
+			if (_p >= _end || *_p != '"') {
+				return nullptr;
+			}
+
+			std::pair<std::string, JsonValue> member;
+			_p = ParseJsonString(_p, _end, member.first);
+			_p = _p ? SkipJsonSpaces(_p, _end) : nullptr;
+			if (!_p || _p >= _end || *_p != ':') {
+				return nullptr;
+			}
+
+			_p = ParseJsonValue(_p + 1, _end, member.second, _depth + 1);
+			if (!_p) {
+				return nullptr;
+			}
+			_value.members.push_back(std::move(member));
+
+			_p = SkipJsonSpaces(_p, _end);
+			if (_p < _end && *_p == ',') {
+				_p++;
+			}
+			else if (_p < _end && *_p == '}') {
+				return _p + 1;
+			}
+			else {
+				return nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	if (*_p == '[') {
+		_value.type = JsonValue::kArray;
+		_p = SkipJsonSpaces(_p + 1, _end);
+		if (_p < _end && *_p == ']') {
+			return _p + 1;
+		}
+
+		while (_p && _p < _end) {
+			JsonValue element;
+			_p = ParseJsonValue(_p, _end, element, _depth + 1);
+			if (!_p) {
+				return nullptr;
+			}
+			_value.array.push_back(std::move(element));
+
+			_p = SkipJsonSpaces(_p, _end);
+			if (_p < _end && *_p == ',') {
+				_p++;
+			}
+			else if (_p < _end && *_p == ']') {
+				return _p + 1;
+			}
+			else {
+				return nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	if (*_p == '"') {
+		_value.type = JsonValue::kString;
+		return ParseJsonString(_p, _end, _value.string);
+	}
+
+	if (_end - _p >= 4 && std::strncmp(_p, "true", 4) == 0) {
+		_value.type = JsonValue::kBool;
+		_value.boolean = true;
+		return _p + 4;
+	}
+
+	if (_end - _p >= 5 && std::strncmp(_p, "false", 5) == 0) {
+		_value.type = JsonValue::kBool;
+		return _p + 5;
+	}
+
+	if (_end - _p >= 4 && std::strncmp(_p, "null", 4) == 0) {
+		return _p + 4;
+	}
+
+	double number = 0.0;
+	const char* numberEnd = ParseDouble(_p, _end, number);
+	if (numberEnd == _p) {
+		return nullptr;
+	}
+	_value.type = JsonValue::kNumber;
+	_value.number = number;
+
+	return numberEnd;
+}
+
+// glTF //
+
+static const uint32_t kGLBMagic = 0x46546C67;		// "glTF"
+static const uint32_t kGLBChunkJSON = 0x4E4F534A;	// "JSON"
+static const uint32_t kGLBChunkBIN = 0x004E4942;	// "BIN\0"
+
+static const int kComponentUnsignedByte = 5121;
+static const int kComponentUnsignedShort = 5123;
+static const int kComponentUnsignedInt = 5125;
+static const int kComponentFloat = 5126;
+
+static uint32_t ReadUint32(const unsigned char* _p)
+{
+	uint32_t value;
+	std::memcpy(&value, _p, sizeof(value));
+	return value;
+}
+
+// Strided view of one accessor inside the GLB binary chunk
+struct GltfAccessor
+{
+	const unsigned char*	Data;
+	size_t					Count;
+	size_t					Stride;
+	int						ComponentType;
+	int						Components;
+	bool					bNormalized;
+
+	float ReadFloat(size_t _index, int _component) const
+	{
+		const unsigned char* element = Data + _index * Stride;
+		switch (ComponentType) {
+		case kComponentFloat: {
+			float value;
+			std::memcpy(&value, element + _component * sizeof(float), sizeof(float));
+			return value;
+		}
+		case kComponentUnsignedByte: {
+			const float kValue = element[_component];
+			return bNormalized ? kValue / 255.0f : kValue;
+		}
+		case kComponentUnsignedShort: {
+			uint16_t value;
+			std::memcpy(&value, element + _component * sizeof(uint16_t), sizeof(uint16_t));
+			return bNormalized ? value / 65535.0f : value;
+		}
+		}
+		return 0.0f;
+	}
+
+	uint32_t ReadIndex(size_t _index) const
+	{
+		const unsigned char* element = Data + _index * Stride;
+		switch (ComponentType) {
+		case kComponentUnsignedByte:
+			return element[0];
+		case kComponentUnsignedShort: {
+			uint16_t value;
+			std::memcpy(&value, element, sizeof(uint16_t));
+			return value;
+		}
+		case kComponentUnsignedInt:
+			return ReadUint32(element);
+		}
+		return 0;
+	}
+};
+
+static int GetComponentCount(const std::string& _type)
+{
+	if (_type == "SCALAR") return 1;
+	if (_type == "VEC2") return 2;
+	if (_type == "VEC3") return 3;
+	if (_type == "VEC4") return 4;
+	return 0;
+}
+
+static int GetComponentSize(int _componentType)
+{
+	switch (_componentType) {
+	case kComponentUnsignedByte: return 1;
+	case kComponentUnsignedShort: return 2;
+	case kComponentUnsignedInt: return 4;
+	case kComponentFloat: return 4;
+	}
+	return 0;
+}
+
+static bool GetGltfAccessor(const JsonValue& _document, int _accessorIndex, const unsigned char* _bin, size_t _binSize, GltfAccessor& _accessor)
+{
+	const JsonValue* accessors = _document.Find("accessors");
+	const JsonValue* bufferViews = _document.Find("bufferViews");
+	if (!accessors || !bufferViews || _accessorIndex < 0 || _accessorIndex >= (int)accessors->array.size()) {
+		return false;
+	}
+
+	const JsonValue& accessor = accessors->array[_accessorIndex];
+	const int kViewIndex = static_cast<int>(accessor.getNumber("bufferView", -1));
+	if (kViewIndex < 0 || kViewIndex >= (int)bufferViews->array.size()) {
+		return false;
+	}
+
+	const JsonValue& view = bufferViews->array[kViewIndex];
+	if (view.getNumber("buffer", 0) != 0) {
+		std::cout << "Loader : only the GLB embedded buffer is supported" << std::endl;
+		return false;
+	}
+
+	_accessor.ComponentType = static_cast<int>(accessor.getNumber("componentType", 0));
+	_accessor.Components = GetComponentCount(accessor.getString("type"));
+	_accessor.Count = static_cast<size_t>(accessor.getNumber("count", 0));
+	_accessor.bNormalized = accessor.Find("normalized") && accessor.Find("normalized")->boolean;
+
+	const size_t kElementSize = GetComponentSize(_accessor.ComponentType) * _accessor.Components;
+	const size_t kOffset = static_cast<size_t>(view.getNumber("byteOffset", 0) + accessor.getNumber("byteOffset", 0));
+	_accessor.Stride = static_cast<size_t>(view.getNumber("byteStride", static_cast<double>(kElementSize)));
+	_accessor.Data = _bin + kOffset;
+
+	// Never read past the binary chunk, whatever the JSON claims
+	if (kElementSize == 0 || (_accessor.Count > 0 && kOffset + (_accessor.Count - 1) * _accessor.Stride + kElementSize > _binSize)) {
+		std::cout << "Loader : accessor " << _accessorIndex << " is out of bounds" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Public //
+
+Loader::Loader()
+{
+	this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+	return;
+}
+
+Loader::~Loader()
+{
+	return;
+}
+
+bool Loader::LoadMesh(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::string extension = _fileName.substr(_fileName.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension == "obj") {
+		return LoadOBJ(_fileName, vertices, indices);
+	}
+	if (extension == "glb") {
+		return LoadGLB(_fileName, vertices, indices);
+	}
+
+	std::cout << "Loader : unsupported mesh format " << _fileName << std::endl;
+	return false;
+}
+
+bool Loader::LoadOBJ(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	MappedFile file;
+	if (!file.Open(_fileName)) {
+		return false;
+	}
+
+	const char* kBegin = reinterpret_cast<const char*>(file.getData());
+	const char* kEnd = kBegin + file.getSize();
+
+	// Split on line boundaries into one chunk per thread
+	const size_t kChunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file.getSize() / kMinChunkBytes));
+	std::vector<ObjChunk> chunks(kChunkCount);
+
+	const char* chunkBegin = kBegin;
+	for (size_t i = 0; i < kChunkCount; i++) {
+		const char* chunkEnd = (i + 1 == kChunkCount) ? kEnd : kBegin + file.getSize() * (i + 1) / kChunkCount;
+		if (chunkEnd < chunkBegin) {
+			chunkEnd = chunkBegin;
+		}
+		chunkEnd = (chunkEnd < kEnd && chunkEnd > chunkBegin) ? SkipLine(chunkEnd - 1, kEnd) : chunkEnd;
+
+		chunks[i].Begin = chunkBegin;
+		chunks[i].End = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < kChunkCount; i++) {
+		threads.push_back(std::thread(ParseObjChunk, std::ref(chunks[i])));
+	}
+	ParseObjChunk(chunks[0]);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	// Merge attribute arrays in file order and turn chunk relative indices into global ones
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	size_t cornerCount = 0;
+
+	for (ObjChunk& chunk : chunks) {
+		const int32_t kPositionBase = static_cast<int32_t>(positions.size());
+		const int32_t kTexCoordBase = static_cast<int32_t>(texCoords.size());
+		const int32_t kNormalBase = static_cast<int32_t>(normals.size());
+
+		for (size_t i = 0; i < chunk.Corners.size(); i++) {
+			const uint8_t kFlags = chunk.RelativeFlags[i];
+			if (kFlags & kRelativePosition) chunk.Corners[i].Position += kPositionBase;
+			if (kFlags & kRelativeTexCoord) chunk.Corners[i].TexCoord += kTexCoordBase;
+			if (kFlags & kRelativeNormal) chunk.Corners[i].Normal += kNormalBase;
+		}
+
+		positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+		texCoords.insert(texCoords.end(), chunk.TexCoords.begin(), chunk.TexCoords.end());
+		normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+		cornerCount += chunk.Corners.size();
+
+		std::vector<glm::vec3>().swap(chunk.Positions);
+		std::vector<glm::vec2>().swap(chunk.TexCoords);
+		std::vector<glm::vec3>().swap(chunk.Normals);
+	}
+
+	// Deduplicate position/uv/normal triples into shared vertices
+	std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertexCache;
+	vertexCache.reserve(cornerCount / 3);
+
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(cornerCount / 3);
+	indices.reserve(cornerCount);
+
+	bool bMissingNormals = false;
+
+	for (const ObjChunk& chunk : chunks) {
+		for (size_t i = 0; i + 2 < chunk.Corners.size(); i += 3) {
+			// Drop triangles pointing outside the file
+			bool bValid = true;
+			for (size_t j = i; j < i + 3; j++) {
+				const ObjCorner& corner = chunk.Corners[j];
+				bValid = bValid && corner.Position >= 0 && corner.Position < (int32_t)positions.size();
+				bValid = bValid && corner.TexCoord < (int32_t)texCoords.size();
+				bValid = bValid && corner.Normal < (int32_t)normals.size();
+			}
+			if (!bValid) {
+				continue;
+			}
+
+			for (size_t j = i; j < i + 3; j++) {
+				ObjCorner corner = chunk.Corners[j];
+				if (corner.TexCoord < 0) corner.TexCoord = -1;
+				if (corner.Normal < 0) corner.Normal = -1;
+
+				std::pair<std::unordered_map<ObjCorner, uint32_t, ObjCornerHash>::iterator, bool> inserted =
+					vertexCache.insert(std::make_pair(corner, static_cast<uint32_t>(vertices.size())));
+
+				if (inserted.second) {
+					Vertex vertex;
+					vertex.position = positions[corner.Position];
+					vertex.normal = (corner.Normal >= 0) ? normals[corner.Normal] : glm::vec3(0.0f);
+					vertex.color = glm::vec3(1.0f);
+					vertex.texture_coordinate = (corner.TexCoord >= 0) ? texCoords[corner.TexCoord] : glm::vec2(0.0f);
+					vertices.push_back(vertex);
+
+					bMissingNormals = bMissingNormals || corner.Normal < 0;
+				}
+
+				indices.push_back(inserted.first->second);
+			}
+		}
+	}
+
+	// Smooth normals for vertices the file gave none, their shared position makes them one vertex
+	if (bMissingNormals) {
+		std::vector<bool> bGenerated(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			bGenerated[i] = (vertices[i].normal == glm::vec3(0.0f));
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const glm::vec3 kFaceNormal = glm::cross(
+				vertices[indices[i + 1]].position - vertices[indices[i]].position,
+				vertices[indices[i + 2]].position - vertices[indices[i]].position);
+
+			for (size_t j = i; j < i + 3; j++) {
+				if (bGenerated[indices[j]]) {
+					vertices[indices[j]].normal += kFaceNormal;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < vertices.size(); i++) {
+			if (bGenerated[i] && glm::length(vertices[i].normal) > 0.0f) {
+				vertices[i].normal = glm::normalize(vertices[i].normal);
+			}
+		}
+	}
+
+	return !indices.empty();
+}
+
+bool Loader::LoadGLB(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	MappedFile file;
+	if (!file.Open(_fileName)) {
+		return false;
+	}
+
+	const unsigned char* kData = file.getData();
+	const size_t kSize = file.getSize();
+
+	if (kSize < 20 || ReadUint32(kData) != kGLBMagic || ReadUint32(kData + 4) != 2) {
+		std::cout << "Loader : " << _fileName << " is not a glTF 2.0 binary" << std::endl;
+		return false;
+	}
+
+	// Walk the chunks, the binary chunk is used straight from the mapping
+	const char* json = nullptr;
+	size_t jsonSize = 0;
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+
+	size_t offset = 12;
+	while (offset + 8 <= kSize) {
+		const size_t kChunkSize = ReadUint32(kData + offset);
+		const uint32_t kChunkType = ReadUint32(kData + offset + 4);
+		if (offset + 8 + kChunkSize > kSize) {
+			break;
+		}
+
+		if (kChunkType == kGLBChunkJSON) {
+			json = reinterpret_cast<const char*>(kData + offset + 8);
+			jsonSize = kChunkSize;
+		}
+		else if (kChunkType == kGLBChunkBIN) {
+			bin = kData + offset + 8;
+			binSize = kChunkSize;
+		}
+
+		offset += 8 + kChunkSize;
+	}
+
+	JsonValue document;
+	if (!json || !ParseJsonValue(json, json + jsonSize, document, 0)) {
+		std::cout << "Loader : " << _fileName << " has no readable JSON chunk" << std::endl;
+		return false;
+	}
+
+	vertices.clear();
+	indices.clear();
+
+	// Every triangle primitive of every mesh is appended, node transforms are not applied
+	const JsonValue* meshes = document.Find("meshes");
+	if (!meshes) {
+		return false;
+	}
+
+	for (const JsonValue& mesh : meshes->array) {
+		const JsonValue* primitives = mesh.Find("primitives");
+		if (!primitives) {
+			continue;
+		}
+
+		for (const JsonValue& primitive : primitives->array) {
+			const JsonValue* attributes = primitive.Find("attributes");
+			if (!attributes || primitive.getNumber("mode", 4) != 4) {
+				std::cout << "Loader : skipping non triangle primitive in " << _fileName << std::endl;
+				continue;
+			}
+
+			GltfAccessor position;
+			if (!GetGltfAccessor(document, (int)attributes->getNumber("POSITION", -1), bin, binSize, position) ||
+				position.ComponentType != kComponentFloat || position.Components != 3) {
+				continue;
+			}
+
+			GltfAccessor normal;
+			const bool kHasNormal = GetGltfAccessor(document, (int)attributes->getNumber("NORMAL", -1), bin, binSize, normal) &&
+				normal.Count == position.Count && normal.Components == 3;
+
+			GltfAccessor texCoord;
+			const bool kHasTexCoord = GetGltfAccessor(document, (int)attributes->getNumber("TEXCOORD_0", -1), bin, binSize, texCoord) &&
+				texCoord.Count == position.Count && texCoord.Components == 2;
+
+			const size_t kBaseVertex = vertices.size();
+			vertices.resize(kBaseVertex + position.Count);
+
+			ParallelFor(position.Count, threadCount, [&](size_t _begin, size_t _end) {
+				for (size_t i = _begin; i < _end; i++) {
+					Vertex& vertex = vertices[kBaseVertex + i];
+					vertex.position = glm::vec3(position.ReadFloat(i, 0), position.ReadFloat(i, 1), position.ReadFloat(i, 2));
+					vertex.normal = kHasNormal ? glm::vec3(normal.ReadFloat(i, 0), normal.ReadFloat(i, 1), normal.ReadFloat(i, 2)) : glm::vec3(0.0f, 1.0f, 0.0f);
+					vertex.color = glm::vec3(1.0f);
+					// glTF UVs already start at the top left like our textures
+					vertex.texture_coordinate = kHasTexCoord ? glm::vec2(texCoord.ReadFloat(i, 0), texCoord.ReadFloat(i, 1)) : glm::vec2(0.0f);
+				}
+			});
+
+			const size_t kBaseIndex = indices.size();
+			GltfAccessor index;
+			if (GetGltfAccessor(document, (int)primitive.getNumber("indices", -1), bin, binSize, index) && index.Components == 1) {
+				indices.resize(kBaseIndex + index.Count);
+
+				ParallelFor(index.Count, threadCount, [&](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++) {
+						const uint32_t kIndex = index.ReadIndex(i);
+						indices[kBaseIndex + i] = static_cast<uint32_t>(kBaseVertex) + std::min<uint32_t>(kIndex, static_cast<uint32_t>(position.Count - 1));
+					}
+				});
+			}
+			else {
+				// Non indexed primitives draw their vertices in order
+				indices.resize(kBaseIndex + position.Count);
+				for (size_t i = 0; i < position.Count; i++) {
+					indices[kBaseIndex + i] = static_cast<uint32_t>(kBaseVertex + i);
+				}
+			}
+		}
+	}
+
+	return !indices.empty();
+}
+
+void Loader::setThreadCount(unsigned int _threadCount)
+{
+	this->threadCount = std::max(1u, _threadCount);
+	return;
+}
+
+unsigned int Loader::getThreadCount() const
+{
+	return threadCount;
+}
+
+void Loader::Benchmark(std::string _fileName, int _iterations)
+{
+	MappedFile file;
+	if (!file.Open(_fileName)) {
+		return;
+	}
+	const double kMegabytes = file.getSize() / (1024.0 * 1024.0);
+	file.Close();
+
+	const unsigned int kThreadCounts[2] = { 1, std::max(1u, std::thread::hardware_concurrency()) };
+
+	for (unsigned int threads : kThreadCounts) {
+		Loader loader;
+		loader.setThreadCount(threads);
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		double bestSeconds = 0.0;
+
+		for (int i = 0; i < std::max(1, _iterations); i++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			const bool kLoaded = loader.LoadMesh(_fileName, vertices, indices);
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+			if (!kLoaded) {
+				std::cout << "Loader : benchmark failed to load " << _fileName << std::endl;
+				return;
+			}
+
+			const double kSeconds = std::chrono::duration<double>(end - start).count();
+			bestSeconds = (i == 0) ? kSeconds : std::min(bestSeconds, kSeconds);
+		}
+
+		std::cout << "Loader : " << _fileName
+			<< " | " << kMegabytes << " MB"
+			<< " | " << threads << " threads"
+			<< " | " << vertices.size() << " vertices"
+			<< " | " << indices.size() / 3 << " triangles"
+			<< " | best " << bestSeconds * 1000.0 << " ms"
+			<< " | " << kMegabytes / bestSeconds << " MB/s" << std::endl;
+	}
+
+	return;
+}
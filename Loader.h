@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+// Imports OBJ and binary glTF 2.0 (.glb) files into the Vertex format used by every renderer.
+// Files are memory mapped and parsed in parallel chunks, nothing holds a second copy of the file.
+class Loader
+{
+public:
+	Loader();
+	~Loader();
+
+	bool LoadMesh(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	bool LoadOBJ(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	bool LoadGLB(std::string _fileName, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	void setThreadCount(unsigned int _threadCount);
+	unsigned int getThreadCount() const;
+
+	// Loads the file repeatedly with 1 thread and with every thread and prints throughput in MB/s
+	static void Benchmark(std::string _fileName, int _iterations);
+
+private:
+	unsigned int threadCount;
+};
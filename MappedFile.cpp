@@ -0,0 +1,139 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	this->data = nullptr;
+	this->size = 0;
+
+#ifdef _WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = NULL;
+#else
+	this->fileDescriptor = -1;
+#endif
+
+	return;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(std::string _fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		std::cout << "Can't read file " << _fileName << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	// Empty files can't be mapped, they are simply open with no data
+	if (size == 0) {
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle) {
+		data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	fileDescriptor = open(_fileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		std::cout << "Can't read file " << _fileName << std::endl;
+		return false;
+	}
+
+	struct stat fileStat;
+	fstat(fileDescriptor, &fileStat);
+	size = static_cast<size_t>(fileStat.st_size);
+
+	// Empty files can't be mapped, they are simply open with no data
+	if (size == 0) {
+		return true;
+	}
+
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping != MAP_FAILED) {
+		data = static_cast<const unsigned char*>(mapping);
+		madvise(mapping, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!data) {
+		std::cout << "Can't map file " << _fileName << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data) {
+		munmap(const_cast<unsigned char*>(data), size);
+	}
+	if (fileDescriptor >= 0) {
+		close(fileDescriptor);
+	}
+	fileDescriptor = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+
+	return;
+}
+
+const unsigned char* MappedFile::getData() const
+{
+	return data;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
+
+bool MappedFile::isOpen() const
+{
+#ifdef _WIN32
+	return fileHandle != INVALID_HANDLE_VALUE;
+#else
+	return fileDescriptor >= 0;
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+// Read only view of a whole file through the OS page cache, nothing is copied into the process
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(std::string _fileName);
+	void Close();
+
+	const unsigned char* getData() const;
+	size_t getSize() const;
+	bool isOpen() const;
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
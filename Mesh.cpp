@@ -1,182 +1,148 @@
 #include "Mesh.h"
 
+#include <cstring>
+
+// Built-in tables, evaluated by the compiler
+
+static constexpr std::array<MeshVertexData, 3> kTriangleVertices = {{
+	{ { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 0.0 }, { 0.0, 1.0 } },
+	{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 1.0f, 0.0 }, { 0.0, 0.0 } },
+	{ { -1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 0.0f, 1.0 }, { 1.0, 0.0 } }
+}};
+
+static constexpr std::array<uint16_t, 3> kTriangleIndices = {{
+	0, 1, 2
+}};
+
+static constexpr std::array<MeshVertexData, 4> kQuadVertices = {{
+	{ { -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 0.0 }, { 0.0, 1.0 } },
+	{ { -1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 1.0f, 0.0 }, { 0.0, 0.0 } },
+	{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 0.0f, 1.0 }, { 1.0, 0.0 } },
+	{ { 1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 1.0 }, { 1.0, 1.0 } }
+}};
+
+static constexpr std::array<uint16_t, 6> kQuadIndices = {{
+	0, 1, 2,
+	0, 2, 3
+}};
+
+static constexpr std::array<MeshVertexData, 24> kCubeVertices = {{
+	//front
+	{ { -1.0f, -1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0, 1.0 } },
+	{ { -1.0f, 1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 0.0f, 1.0f, 0.0 },{ 0.0, 0.0 } },
+	{ { 1.0f, 1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },
+	{ { 1.0f, -1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 1.0f, 0.0f, 1.0 },{ 1.0, 1.0 } },
+
+	// back
+	{ { 1.0, -1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 1.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //4
+	{ { 1.0f, 1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 0.0f, 1.0f, 1.0 },{ 0.0, 0.0 } }, //5
+	{ { -1.0, 1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 0.0f, 1.0f, 1.0 },{ 1.0, 0.0 } }, //6
+	{ { -1.0, -1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 1.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //7
+
+	//left
+	{ { -1.0, -1.0, -1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //8
+	{ { -1.0f, 1.0, -1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //9
+	{ { -1.0, 1.0, 1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },   //10
+	{ { -1.0, -1.0, 1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //11
+
+	//right
+	{ { 1.0, -1.0, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, // 12
+	{ { 1.0f, 1.0, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //13
+	{ { 1.0, 1.0, -1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } }, //14
+	{ { 1.0, -1.0, -1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //15
+
+	//top
+	{ { -1.0f, 1.0f, 1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //16
+	{ { -1.0f, 1.0f, -1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //17
+	{ { 1.0f, 1.0f, -1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } }, //18
+	{ { 1.0f, 1.0f, 1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //19
+
+	//bottom
+	{ { -1.0f, -1.0, -1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //20
+	{ { -1.0, -1.0, 1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //21
+	{ { 1.0, -1.0, 1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },  //22
+	{ { 1.0, -1.0, -1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //23
+}};
+
+static constexpr std::array<uint16_t, 36> kCubeIndices = {{
+	0, 1, 2,
+	2, 3, 0,
+
+	4, 5, 6,
+	4, 6, 7,
+
+	8, 9, 10,
+	8, 10, 11,
+
+	12, 13, 14,
+	12, 14, 15,
+
+	16, 17, 18,
+	16, 18, 19,
+
+	20, 21, 22,
+	20, 22, 23
+}};
+
+static constexpr float kTriangleRadius = MeshTables::BoundingRadius(kTriangleVertices);
+static constexpr float kQuadRadius = MeshTables::BoundingRadius(kQuadVertices);
+static constexpr float kCubeRadius = MeshTables::BoundingRadius(kCubeVertices);
+
+static constexpr SphereTable<20> kSphereTable = SphereTable<20>::Build();
+
+static void CopyData(const MeshData& _data, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// Same layout, so one copy each with no per vertex work
+	vertices.resize(_data.VertexCount);
+	std::memcpy(static_cast<void*>(&vertices[0]), _data.Vertices, sizeof(Vertex) * _data.VertexCount);
+
+	indices.assign(_data.Indices, _data.Indices + _data.IndexCount);
+	return;
+}
+
 void Mesh::SetTriangleData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
 {
-	std::vector<Vertex> _vertices = {
-		{ { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 0.0 }, { 0.0, 1.0 } },
-		{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 1.0f, 0.0 }, { 0.0, 0.0 } },
-		{ { -1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 0.0f, 1.0 }, { 1.0, 0.0 } }
-	};
-
-	std::vector<uint32_t> _indices = {0, 1, 2};
-	
-	vertices.clear();
-	vertices = _vertices;
-
-	indices.clear();
-	indices = _indices;
+	CopyData(GetBuiltinData(kTriangle), vertices, indices);
 	return;
 }
 
 void Mesh::SetQuadData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
 {
-	std::vector<Vertex> _vertices = {
-
-		{ { -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 0.0 }, { 0.0, 1.0 } },
-		{ { -1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 1.0f, 0.0 }, { 0.0, 0.0 } },
-		{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 0.0f, 0.0f, 1.0 }, { 1.0, 0.0 } },
-		{ { 1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0 }, { 1.0f, 0.0f, 1.0 }, { 1.0, 1.0 } }
-	};
-
-	std::vector<uint32_t> _indices = {
-
-		0, 1, 2,
-		0, 2, 3
-	};
-
-	vertices.clear();
-	vertices = _vertices;
-	
-	indices.clear();
-	indices = _indices;
+	CopyData(GetBuiltinData(kQuad), vertices, indices);
 	return;
 }
 
-void Mesh::SetCubeData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
-
-	std::vector<Vertex> _vertices = {
-
-		//front
-		{ { -1.0f, -1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0, 1.0 } },
-		{ { -1.0f, 1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 0.0f, 1.0f, 0.0 },{ 0.0, 0.0 } },
-		{ { 1.0f, 1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },
-		{ { 1.0f, -1.0f, 1.0f },{ 0.0f, 0.0f, 1.0 },{ 1.0f, 0.0f, 1.0 },{ 1.0, 1.0 } },
-
-		// back 
-		{ { 1.0, -1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 1.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //4
-		{ { 1.0f, 1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 0.0f, 1.0f, 1.0 },{ 0.0, 0.0 } }, //5
-		{ { -1.0, 1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 0.0f, 1.0f, 1.0 },{ 1.0, 0.0 } }, //6
-		{ { -1.0, -1.0, -1.0 },{ 0.0f, 0.0f, -1.0 },{ 1.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //7
-
-
-		//left
-		{ { -1.0, -1.0, -1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //8
-		{ { -1.0f, 1.0, -1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //9
-		{ { -1.0, 1.0, 1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },   //10
-		{ { -1.0, -1.0, 1.0 },{ -1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //11
-
-		//right
-		{ { 1.0, -1.0, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, // 12
-		{ { 1.0f, 1.0, 1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //13
-		{ { 1.0, 1.0, -1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } }, //14
-		{ { 1.0, -1.0, -1.0 },{ 1.0f, 0.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //15
-
-		//top
-		{ { -1.0f, 1.0f, 1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //16
-		{ { -1.0f, 1.0f, -1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //17
-		{ { 1.0f, 1.0f, -1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } }, //18
-		{ { 1.0f, 1.0f, 1.0f },{ 0.0f, 1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //19
-
-		//bottom 
-		{ { -1.0f, -1.0, -1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 1.0 } }, //20
-		{ { -1.0, -1.0, 1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 0.0, 0.0 } }, //21
-		{ { 1.0, -1.0, 1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 0.0 } },  //22
-		{ { 1.0, -1.0, -1.0 },{ 0.0f, -1.0f, 0.0 },{ 0.0f, 0.0f, 1.0 },{ 1.0, 1.0 } }, //23
-
-	};
-
-	std::vector<uint32_t> _indices = {
-
-		0, 1, 2,
-		2, 3, 0,
-
-		4, 5, 6,
-		4, 6, 7,
-
-		8, 9, 10,
-		8, 10, 11,
-
-		12, 13, 14,
-		12, 14, 15,
-
-		16, 17, 18,
-		16, 18, 19,
-
-		20, 21, 22,
-		20, 22, 23
-
-	};
-
-
-	vertices.clear();
-	vertices = _vertices;
-
-	indices.clear();
-	indices = _indices;
+void Mesh::SetCubeData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	CopyData(GetBuiltinData(kCube), vertices, indices);
 	return;
 }
 
-void Mesh::SetSphereData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
-
-	std::vector<Vertex> _vertices;
-	std::vector<uint32_t> _indices;
-
-	float latitudeBands = 20.0f;
-	float longitudeBands = 20.0f;
-	float radius = 1.0f;
-
-	for (float latNumber = 0; latNumber <= latitudeBands; latNumber++) {
-		float theta = latNumber * 3.14 / latitudeBands;
-		float sinTheta = sin(theta);
-		float cosTheta = cos(theta);
-
-		for (float longNumber = 0; longNumber <= longitudeBands; longNumber++) {
-
-			float phi = longNumber * 2 * 3.147 / longitudeBands;
-			float sinPhi = sin(phi);
-			float cosPhi = cos(phi);
-
-			Vertex vs;
-
-			vs.texture_coordinate.x = (longNumber / longitudeBands); // u
-			vs.texture_coordinate.y = (latNumber / latitudeBands);   // v
-
-			vs.normal.x = cosPhi * sinTheta;   // normal x
-			vs.normal.y = cosTheta;            // normal y
-			vs.normal.z = sinPhi * sinTheta;   // normal z
-
-			vs.color.r = vs.normal.x;
-			vs.color.g = vs.normal.y;
-			vs.color.b = vs.normal.z;
-
-			vs.position.x = radius * vs.normal.x; // x
-			vs.position.y = radius * vs.normal.y; // y
-			vs.position.z = radius * vs.normal.z; // z
-
-			_vertices.push_back(vs);
-		}
-	}
-
-	for (uint32_t latNumber = 0; latNumber < latitudeBands; latNumber++) {
-		for (uint32_t longNumber = 0; longNumber < longitudeBands; longNumber++) {
-			uint32_t first = (latNumber * (longitudeBands + 1)) + longNumber;
-			uint32_t second = first + longitudeBands + 1;
-
-			_indices.push_back(first);
-			_indices.push_back(second);
-			_indices.push_back(first + 1);
-
-			_indices.push_back(second);
-			_indices.push_back(second + 1);
-			_indices.push_back(first + 1);
+void Mesh::SetSphereData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	CopyData(GetBuiltinData(kSphere), vertices, indices);
+	return;
+}
 
-		}
+MeshData Mesh::GetBuiltinData(MeshType _meshType)
+{
+	MeshData data = { nullptr, 0, nullptr, 0, 0.0f };
+
+	switch (_meshType) {
+	case kTriangle:
+		data = { &kTriangleVertices[0], kTriangleVertices.size(), &kTriangleIndices[0], kTriangleIndices.size(), kTriangleRadius };
+		break;
+	case kQuad:
+		data = { &kQuadVertices[0], kQuadVertices.size(), &kQuadIndices[0], kQuadIndices.size(), kQuadRadius };
+		break;
+	case kCube:
+		data = { &kCubeVertices[0], kCubeVertices.size(), &kCubeIndices[0], kCubeIndices.size(), kCubeRadius };
+		break;
+	case kSphere:
+		// 20 x 20 bands with the unit radius as its bound
+		data = { kSphereTable.Vertices, SphereTable<20>::kVertexCount, kSphereTable.Indices, SphereTable<20>::kIndexCount, 1.0f };
+		break;
 	}
 
-	vertices.clear();
-	vertices = _vertices;
-
-	indices.clear();
-	indices = _indices;
-	return;
+	return data;
 }
\ No newline at end of file
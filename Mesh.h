@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include "Dependencies/glm/glm/glm.hpp"
 
+#include "MeshTables.h"
+
 enum MeshType
 {
 	kTriangle = 0,
@@ -19,6 +22,21 @@ struct Vertex
 
 };
 
+static_assert(sizeof(MeshVertexData) == sizeof(Vertex), "MeshVertexData must match the Vertex layout");
+static_assert(offsetof(MeshVertexData, Normal) == offsetof(Vertex, normal), "MeshVertexData must match the Vertex layout");
+static_assert(offsetof(MeshVertexData, TexCoord) == offsetof(Vertex, texture_coordinate), "MeshVertexData must match the Vertex layout");
+
+// Read only view of a built-in mesh, the storage is static so it can be handed straight to glBufferData.
+// Every built-in is far below 65536 vertices so the indices are stored as GL_UNSIGNED_SHORT.
+struct MeshData
+{
+	const MeshVertexData*	Vertices;
+	size_t					VertexCount;
+	const uint16_t*			Indices;
+	size_t					IndexCount;
+	float					BoundingRadius;
+};
+
 class Mesh
 {
 public:
@@ -26,5 +44,7 @@ public:
 	static void SetQuadData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 	static void SetCubeData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 	static void SetSphereData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static MeshData GetBuiltinData(MeshType _meshType);
 };
 
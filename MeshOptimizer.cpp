@@ -0,0 +1,289 @@
+#include "MeshOptimizer.h"
+
+#include <iostream>
+#include <algorithm>
+
+// Cache size the passes optimize for and the stats simulate, a conservative fit for current hardware
+static const int kCacheSize = 16;
+// Overdraw ordering may cost at most this much ACMR
+static const float kOverdrawThreshold = 1.05f;
+
+// Public //
+
+void MeshOptimizer::Optimize(std::string _name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool _bOverdraw)
+{
+	if (indices.size() < 3) {
+		return;
+	}
+
+	const MeshCacheStats kBefore = AnalyzeVertexCache(indices, vertices.size());
+
+	const std::vector<uint32_t> kClusters = OptimizeVertexCache(indices, vertices.size());
+	if (_bOverdraw) {
+		OptimizeOverdraw(vertices, indices, kClusters, kOverdrawThreshold);
+	}
+	OptimizeVertexFetch(vertices, indices);
+
+	const MeshCacheStats kAfter = AnalyzeVertexCache(indices, vertices.size());
+
+	std::cout << "Mesh Optimizer : " << _name
+		<< " ACMR " << kBefore.ACMR << " -> " << kAfter.ACMR
+		<< ", ATVR " << kBefore.ATVR << " -> " << kAfter.ATVR << std::endl;
+
+	return;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t _vertexCount)
+{
+	const size_t kTriangleCount = indices.size() / 3;
+
+	// Triangles adjacent to each vertex, packed into one array
+	std::vector<uint32_t> adjacencyOffsets(_vertexCount + 1, 0);
+	for (uint32_t index : indices) {
+		adjacencyOffsets[index + 1]++;
+	}
+	for (size_t v = 0; v < _vertexCount; v++) {
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) {
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<uint32_t> liveTriangles(_vertexCount);
+	for (size_t v = 0; v < _vertexCount; v++) {
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+
+	std::vector<int> cacheTime(_vertexCount, 0);
+	std::vector<bool> emitted(kTriangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	std::vector<uint32_t> clusters;
+
+	int timeStamp = kCacheSize + 1;
+	size_t cursor = 0;
+	int fanning = indices.empty() ? -1 : static_cast<int>(indices[0]);
+	bool bClusterStart = true;
+
+	while (fanning >= 0) {
+		if (bClusterStart) {
+			clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+			bClusterStart = false;
+		}
+
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+			const uint32_t kTriangle = adjacency[a];
+			if (emitted[kTriangle]) {
+				continue;
+			}
+			emitted[kTriangle] = true;
+
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t kVertex = indices[kTriangle * 3 + corner];
+				output.push_back(kVertex);
+				deadEnds.push_back(kVertex);
+				candidates.push_back(kVertex);
+				liveTriangles[kVertex]--;
+
+				if (timeStamp - cacheTime[kVertex] > kCacheSize) {
+					cacheTime[kVertex] = timeStamp++;
+				}
+			}
+		}
+
+		// Next fan is the candidate that will still be in the cache once its triangles are emitted
+		int next = -1;
+		int bestPriority = -1;
+		for (uint32_t candidate : candidates) {
+			if (liveTriangles[candidate] == 0) {
+				continue;
+			}
+
+			int priority = 0;
+			if (timeStamp - cacheTime[candidate] + 2 * (int)liveTriangles[candidate] <= kCacheSize) {
+				priority = timeStamp - cacheTime[candidate];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = candidate;
+			}
+		}
+
+		// Dead end, fall back to recently used vertices and then to input order
+		if (next < 0) {
+			while (!deadEnds.empty() && next < 0) {
+				const uint32_t kVertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[kVertex] > 0) {
+					next = kVertex;
+				}
+			}
+			while (cursor < indices.size() && next < 0) {
+				const uint32_t kVertex = indices[cursor++];
+				if (liveTriangles[kVertex] > 0) {
+					next = kVertex;
+					// Jumping back to input order breaks locality, so a new cluster starts here
+					bClusterStart = true;
+				}
+			}
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(output);
+
+	return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& _clusters, float _threshold)
+{
+	if (_clusters.size() < 2) {
+		return;
+	}
+
+	const size_t kTriangleCount = indices.size() / 3;
+
+	struct Cluster
+	{
+		uint32_t	First;		// first triangle
+		uint32_t	Count;		// triangle count
+		float		Sort;		// how far the cluster faces away from the mesh center
+	};
+
+	// Area weighted centroid of the whole mesh
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t t = 0; t < kTriangleCount; t++) {
+		const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+		const float kArea = glm::length(glm::cross(p1 - p0, p2 - p0));
+
+		meshCentroid += (p0 + p1 + p2) * (kArea / 3.0f);
+		meshArea += kArea;
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+	std::vector<Cluster> clusters;
+	for (size_t c = 0; c < _clusters.size(); c++) {
+		Cluster cluster;
+		cluster.First = _clusters[c];
+		cluster.Count = static_cast<uint32_t>((c + 1 < _clusters.size() ? _clusters[c + 1] : kTriangleCount) - _clusters[c]);
+
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = cluster.First; t < cluster.First + cluster.Count; t++) {
+			const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+			const glm::vec3 kNormal = glm::cross(p1 - p0, p2 - p0);
+			const float kArea = glm::length(kNormal);
+
+			centroid += (p0 + p1 + p2) * (kArea / 3.0f);
+			normal += kNormal;
+			area += kArea;
+		}
+
+		// Clusters on the outside facing out are drawn first, they are the likeliest occluders
+		cluster.Sort = 0.0f;
+		if (area > 0.0f && glm::length(normal) > 0.0f) {
+			cluster.Sort = glm::dot(centroid / area - meshCentroid, glm::normalize(normal));
+		}
+
+		clusters.push_back(cluster);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& _a, const Cluster& _b) {
+		return _a.Sort > _b.Sort;
+	});
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (const Cluster& cluster : clusters) {
+		sorted.insert(sorted.end(), indices.begin() + cluster.First * 3, indices.begin() + (cluster.First + cluster.Count) * 3);
+	}
+
+	// Keep the cache friendly order when the sort costs too many cache misses
+	const size_t kVertexCount = vertices.size();
+	if (AnalyzeVertexCache(sorted, kVertexCount).ACMR <= AnalyzeVertexCache(indices, kVertexCount).ACMR * _threshold) {
+		indices.swap(sorted);
+	}
+
+	return;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t kUnused = 0xFFFFFFFF;
+
+	std::vector<uint32_t> remap(vertices.size(), kUnused);
+	std::vector<Vertex> fetchOrdered;
+	fetchOrdered.reserve(vertices.size());
+
+	for (uint32_t& index : indices) {
+		if (remap[index] == kUnused) {
+			remap[index] = static_cast<uint32_t>(fetchOrdered.size());
+			fetchOrdered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(fetchOrdered);
+
+	return;
+}
+
+MeshCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _vertexCount)
+{
+	MeshCacheStats stats = { 0.0f, 0.0f };
+	if (_indices.empty()) {
+		return stats;
+	}
+
+	// FIFO cache, a vertex is resident while fewer than kCacheSize misses happened since it was loaded
+	std::vector<int> loadedAt(_vertexCount, -kCacheSize - 1);
+	std::vector<bool> used(_vertexCount, false);
+	int misses = 0;
+	int uniqueVertices = 0;
+
+	for (uint32_t index : _indices) {
+		if (misses - loadedAt[index] > kCacheSize) {
+			loadedAt[index] = misses++;
+		}
+		if (!used[index]) {
+			used[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.ACMR = static_cast<float>(misses) / (_indices.size() / 3);
+	stats.ATVR = static_cast<float>(misses) / uniqueVertices;
+
+	return stats;
+}
+
+void MeshOptimizer::PrintBuiltinStats()
+{
+	const MeshType kTypes[4] = { kTriangle, kQuad, kCube, kSphere };
+	const char* kNames[4] = { "triangle", "quad", "cube", "sphere" };
+
+	for (int i = 0; i < 4; i++) {
+		const MeshData kData = Mesh::GetBuiltinData(kTypes[i]);
+		const std::vector<uint32_t> kIndices(kData.Indices, kData.Indices + kData.IndexCount);
+		const MeshCacheStats kStats = AnalyzeVertexCache(kIndices, kData.VertexCount);
+
+		std::cout << "Mesh Optimizer : built-in " << kNames[i] << " ACMR " << kStats.ACMR << ", ATVR " << kStats.ATVR << std::endl;
+	}
+
+	return;
+}
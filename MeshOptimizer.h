@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+struct MeshCacheStats
+{
+	float	ACMR;	// post transform cache misses per triangle, 0.5 is ideal for a regular grid
+	float	ATVR;	// post transform cache misses per unique vertex, 1.0 is ideal
+};
+
+// Reorders index and vertex data so meshes make better use of the post transform cache,
+// vertex fetch and early depth rejection. Vertices are never added or changed, only reordered.
+class MeshOptimizer
+{
+public:
+	// Runs every pass and prints the cache stats before and after
+	static void Optimize(std::string _name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool _bOverdraw);
+
+	// Tipsify, returns the first triangle of each cluster it emitted
+	static std::vector<uint32_t> OptimizeVertexCache(std::vector<uint32_t>& indices, size_t _vertexCount);
+	// Sorts the clusters front to back from the outside in, kept only if ACMR stays within _threshold of the input
+	static void OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& _clusters, float _threshold);
+	// Renumbers vertices in the order the indices first use them, unused vertices are dropped
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static MeshCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _vertexCount);
+	// Built-in meshes are tables already in cache order and skip Optimize, this prints their stats instead
+	static void PrintBuiltinStats();
+};
@@ -1,5 +1,28 @@
 #include "MeshRenderer.h"
 
+#include <iostream>
+#include <cstring>
+
+#include "Profiler.h"
+
+#include "GLCallStats.h"
+
+// Coarsest level whose surface error stays under this many pixels on screen is drawn
+static const float kLodPixelError = 1.0f;
+
+static const GLuint kModelUniform = CommandBuffer::getUniformId("model");
+static const GLuint kViewProjectionUniform = CommandBuffer::getUniformId("vp");
+static const GLuint kBoundsMinUniform = CommandBuffer::getUniformId("boundsMin");
+static const GLuint kBoundsExtentUniform = CommandBuffer::getUniformId("boundsExtent");
+static const GLuint kCameraPosUniform = CommandBuffer::getUniformId("cameraPos");
+static const GLuint kLightPosUniform = CommandBuffer::getUniformId("lightPos");
+static const GLuint kLightColorUniform = CommandBuffer::getUniformId("lightColor");
+static const GLuint kSpecularStrengthUniform = CommandBuffer::getUniformId("specularStrength");
+static const GLuint kAmbientStrengthUniform = CommandBuffer::getUniformId("ambientStrength");
+
+float MeshRenderer::viewportHeight = 600.0f;
+const ClusteredLighting* MeshRenderer::clusteredLighting = nullptr;
+
 MeshRenderer::MeshRenderer(MeshType _meshType, Camera* _camera, btRigidBody* _rigidBody, std::string _name, LightRenderer* _light, float _specularStrength, float _ambientStrength)
 {
 	this->ambientStrength = _ambientStrength;
@@ -10,9 +33,12 @@ MeshRenderer::MeshRenderer(MeshType _meshType, Camera* _camera, btRigidBody* _ri
 
 	this->ebo = 0;
 	this->vbo = 0;
-	this->vao = 0;
+	this->vertexLayout = &kLitVertexLayout;
 	this->program = 0;
 	this->texture = 0;
+	this->bPacked = false;
+	this->currentLod = 0;
+	this->meshletStats = { 0, 0, 0, 0, 0, 0 };
 
 	this->camera = _camera;
 	this->rigidBody = _rigidBody;
@@ -21,6 +47,39 @@ MeshRenderer::MeshRenderer(MeshType _meshType, Camera* _camera, btRigidBody* _ri
 	HandleMeshType(_meshType);
 	HandleGLSetup();
 
+	this->boundingRadius = builtinData.BoundingRadius;
+
+	return;
+}
+
+MeshRenderer::MeshRenderer(std::string _cookedMeshFile, Camera* _camera, btRigidBody* _rigidBody, std::string _name, LightRenderer* _light, float _specularStrength, float _ambientStrength)
+{
+	this->ambientStrength = _ambientStrength;
+	this->specularStrength = _specularStrength;
+	this->name = _name;
+	this->scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	this->position = glm::vec3(0.0, 0.0, 0.0);
+	this->boundingRadius = 0.0f;
+	this->indexCount = 0;
+	this->indexType = GL_UNSIGNED_INT;
+	this->builtinData = { nullptr, 0, nullptr, 0, 0.0f };
+
+	this->ebo = 0;
+	this->vbo = 0;
+	this->vertexLayout = &kLitVertexLayout;
+	this->program = 0;
+	this->texture = 0;
+	this->bPacked = false;
+	this->currentLod = 0;
+	this->meshletStats = { 0, 0, 0, 0, 0, 0 };
+
+	this->camera = _camera;
+	this->rigidBody = _rigidBody;
+	this->light = _light;
+
+	// Vertices never pass through the vectors, they go from the mapping to the GPU
+	HandleCookedMesh(_cookedMeshFile);
+
 	return;
 }
 
@@ -31,43 +90,138 @@ MeshRenderer::~MeshRenderer()
 
 void MeshRenderer::Draw()
 {
-	glUseProgram(program);
+	Profiler::Zone zone("MeshRenderer::Draw");
+
+	drawCommands.Clear();
+	Record(drawCommands);
+
+	drawExecutor.ResetStats();
+	drawExecutor.Execute(drawCommands);
+
+	return;
+}
+
+void MeshRenderer::Record(CommandBuffer& commands)
+{
+	Profiler::Zone zone("MeshRenderer::Record");
+
+	commands.BindProgram(program);
 
-	SetupModelViewProjectionMatrix();
+	RecordModelViewProjectionMatrix(commands);
+
+	if (bPacked) {
+		commands.SetConstant(kBoundsMinUniform, packedBounds.Min);
+		commands.SetConstant(kBoundsExtentUniform, packedBounds.Extent);
+	}
 
 	// Set Texture
-	glBindTexture(GL_TEXTURE_2D, texture);
+	commands.BindTexture(0, texture);
 
-	SetupLighting();
+	RecordLighting(commands);
 
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	// Every mesh with the same layout shares one vao, only the buffers are rebound
+	commands.BindVertexBuffers(*vertexLayout, vbo, ebo);
+	if (!lods.empty()) {
+		currentLod = SelectLod();
+	}
+
+	// Lower levels draw whole, their frames report no meshlets
+	meshletStats = { 0, 0, 0, 0, 0, 0 };
+	if (!meshlets.empty() && currentLod == 0) {
+		const glm::mat4 kVP = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+		meshletStats = MeshletBuilder::Cull(meshlets, GetModelMatrix(), kVP, camera->GetCameraPosition(), IndexBuffer::getTypeSize(indexType), meshletCounts, meshletOffsets);
 
-	// Unbinds
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
-	glUseProgram(0);
+		if (!meshletCounts.empty()) {
+			commands.MultiDraw(indexType, &meshletCounts[0], &meshletOffsets[0], static_cast<GLsizei>(meshletCounts.size()));
+		}
+	}
+	else if (!chunks.empty()) {
+		for (size_t i = 0; i < chunks.size(); i++) {
+			commands.Draw(indexType, chunks[i].IndexCount, chunks[i].FirstIndex, chunks[i].BaseVertex);
+		}
+	}
+	else if (lods.empty()) {
+		commands.Draw(indexType, indexCount, 0, 0);
+	}
+	else {
+		commands.Draw(indexType, lods[currentLod].IndexCount, lods[currentLod].FirstIndex, 0);
+	}
 
 	return;
 }
 
-void MeshRenderer::SetupLighting()
+void MeshRenderer::RecordLighting(CommandBuffer& commands) const
 {
 	// Set Lighting
-	GLuint cameraPosLoc = glGetUniformLocation(program, "cameraPos");
-	glUniform3f(cameraPosLoc, camera->GetCameraPosition().x, camera->GetCameraPosition().y, camera->GetCameraPosition().z);
+	commands.SetConstant(kCameraPosUniform, camera->GetCameraPosition());
+	commands.SetConstant(kLightPosUniform, this->light->getPosition());
+	commands.SetConstant(kLightColorUniform, this->light->getColor());
+	commands.SetConstant(kSpecularStrengthUniform, specularStrength);
+	commands.SetConstant(kAmbientStrengthUniform, ambientStrength);
+
+	if (clusteredLighting) {
+		clusteredLighting->Record(commands);
+	}
 
-	GLuint lightPosLoc = glGetUniformLocation(program, "lightPos");
-	glUniform3f(lightPosLoc, this->light->getPosition().x, this->light->getPosition().y, this->light->getPosition().z);
+	return;
+}
 
-	GLuint lightColorLoc = glGetUniformLocation(program, "lightColor");
-	glUniform3f(lightColorLoc, this->light->getColor().x, this->light->getColor().y, this->light->getColor().z);
+void MeshRenderer::PackVertices()
+{
+	// Cooked meshes never keep their vertices on the CPU
+	LoadMeshData();
+	if (bPacked || vertices.empty()) {
+		return;
+	}
 
-	GLuint specularStrengthLoc = glGetUniformLocation(program, "specularStrength");
-	glUniform1f(specularStrengthLoc, specularStrength);
+	std::vector<PackedVertex> packed;
+	VertexPacking::Encode(vertices, packed, packedBounds);
 
-	GLuint ambientStrengthLoc = glGetUniformLocation(program, "ambientStrength");
-	glUniform1f(ambientStrengthLoc, ambientStrength);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * packed.size(), &packed[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	vertexLayout = &kPackedVertexLayout;
+	bPacked = true;
+
+	return;
+}
+
+void MeshRenderer::BuildLods()
+{
+	LoadMeshData();
+	if (!lods.empty() || indices.empty()) {
+		return;
+	}
+
+	std::vector<GLuint> lodIndices;
+	MeshSimplifier::BuildLodChain(vertices, indices, { 0.5f, 0.25f, 0.1f }, lods, lodIndices);
+
+	for (size_t lod = 0; lod < lods.size(); lod++) {
+		std::cout << "Mesh LOD : " << name << " " << lod << " " << lods[lod].IndexCount / 3 << " triangles, error " << lods[lod].Error << std::endl;
+	}
+
+	// Every level shares the vertex buffer, they are ranges of one index buffer
+	VertexArrayCache::Bind(*vertexLayout, vbo, ebo);
+	IndexBuffer::Upload(indexType, &lodIndices[0], lodIndices.size(), GL_STATIC_DRAW);
+
+	return;
+}
+
+void MeshRenderer::BuildMeshlets()
+{
+	LoadMeshData();
+	if (!meshlets.empty() || indices.empty()) {
+		return;
+	}
+
+	MeshletBuilder::Build(vertices, indices, meshlets);
+
+	std::cout << "Meshlets : " << name << " " << meshlets.size() << " meshlets for " << indices.size() / 3 << " triangles" << std::endl;
+
+	// Only the order of the full detail range changes, any LOD ranges after it are untouched
+	VertexArrayCache::Bind(*vertexLayout, vbo, ebo);
+	IndexBuffer::UploadRange(indexType, 0, &indices[0], indices.size());
 
 	return;
 }
@@ -105,6 +259,60 @@ std::string MeshRenderer::getName() const
 	return name;
 }
 
+GLuint MeshRenderer::getTexture() const
+{
+	return texture;
+}
+
+glm::vec3 MeshRenderer::getWorldPosition() const
+{
+	btTransform t;
+	rigidBody->getMotionState()->getWorldTransform(t);
+	return glm::vec3(t.getOrigin().getX(), t.getOrigin().getY(), t.getOrigin().getZ());
+}
+
+float MeshRenderer::getBoundingRadius() const
+{
+	return boundingRadius * glm::max(scale.x, glm::max(scale.y, scale.z));
+}
+
+size_t MeshRenderer::getLodCount() const
+{
+	return lods.empty() ? 1 : lods.size();
+}
+
+size_t MeshRenderer::getCurrentLod() const
+{
+	return currentLod;
+}
+
+const MeshletCullStats& MeshRenderer::getMeshletStats() const
+{
+	return meshletStats;
+}
+
+bool MeshRenderer::isLoaded() const
+{
+	return indexCount > 0;
+}
+
+bool MeshRenderer::isPacked() const
+{
+	return bPacked;
+}
+
+void MeshRenderer::setViewportHeight(float _viewportHeight)
+{
+	viewportHeight = _viewportHeight;
+	return;
+}
+
+void MeshRenderer::setClusteredLighting(const ClusteredLighting* _clusteredLighting)
+{
+	clusteredLighting = _clusteredLighting;
+	return;
+}
+
 btRigidBody* MeshRenderer::getRigidBody() const
 {
 	return rigidBody;
@@ -112,11 +320,27 @@ btRigidBody* MeshRenderer::getRigidBody() const
 
 // Private //
 
-void MeshRenderer::SetupModelViewProjectionMatrix()
+void MeshRenderer::RecordModelViewProjectionMatrix(CommandBuffer& commands) const
+{
+	// Transform Matrix
+	commands.SetConstant(kModelUniform, GetModelMatrix());
+
+	const glm::mat4 kVP = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+	commands.SetConstant(kViewProjectionUniform, kVP);
+
+	return;
+}
+
+glm::mat4 MeshRenderer::GetModelMatrix() const
+{
+	return GetModelMatrix(rigidBody, scale);
+}
+
+glm::mat4 MeshRenderer::GetModelMatrix(const btRigidBody* _rigidBody, glm::vec3 _scale)
 {
 	// Rigid Body Transform
 	btTransform t;
-	rigidBody->getMotionState()->getWorldTransform(t);
+	_rigidBody->getMotionState()->getWorldTransform(t);
 	const btQuaternion kRotation = t.getRotation();
 	const btVector3 kTranslate = t.getOrigin();
 
@@ -139,61 +363,95 @@ void MeshRenderer::SetupModelViewProjectionMatrix()
 		)
 	);
 
-	const glm::mat4 kScaleMatrix = glm::scale(glm::mat4(1.0f), scale);
+	const glm::mat4 kScaleMatrix = glm::scale(glm::mat4(1.0f), _scale);
 
-
-	// Transform Matrix
 	//const glm::mat4 kModel = glm::translate(glm::mat4(1.0), position);
-	const glm::mat4 kModel = kTranslationMatrix * kRotationMatrix * kScaleMatrix;
-	GLint modelLoc = glGetUniformLocation(program, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(kModel));
+	return kTranslationMatrix * kRotationMatrix * kScaleMatrix;
+}
 
-	const glm::mat4 kVP = camera->GetProjectionMatrix() * camera->GetViewMatrix();
-	GLint vpLoc = glGetUniformLocation(program, "vp");
-	glUniformMatrix4fv(vpLoc, 1, GL_FALSE, glm::value_ptr(kVP));
+size_t MeshRenderer::SelectLod() const
+{
+	const float kMaxScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+	const float kDistance = glm::length(getWorldPosition() - camera->GetCameraPosition());
+	if (kDistance <= getBoundingRadius()) {
+		return 0;
+	}
 
-	return;
+	// projection[1][1] is 1 / tan(fov / 2), so this turns a world size at a distance into pixels
+	const float kPixelsPerUnit = camera->GetProjectionMatrix()[1][1] * viewportHeight * 0.5f / kDistance;
+
+	size_t lod = 0;
+	while (lod + 1 < lods.size() && lods[lod + 1].Error * kMaxScale * kPixelsPerUnit <= kLodPixelError) {
+		lod++;
+	}
+
+	return lod;
 }
 
 void MeshRenderer::HandleMeshType(MeshType _meshType)
 {
-	switch (_meshType) {
-	case kTriangle:
-		Mesh::SetTriangleData(vertices, indices);
-		break;
-	case kQuad:
-		Mesh::SetQuadData(vertices, indices);
-		break;
-	case kCube:
-		Mesh::SetCubeData(vertices, indices);
-		break;
-	case kSphere:
-		Mesh::SetSphereData(vertices, indices);
-		break;
-	}
+	// Built-in tables are static and already in vertex cache order, nothing is copied until a CPU copy is needed
+	builtinData = Mesh::GetBuiltinData(_meshType);
 }
 
-void MeshRenderer::HandleGLSetup()
+void MeshRenderer::LoadMeshData()
 {
+	if (!vertices.empty() || !builtinData.Vertices) {
+		return;
+	}
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// Same layout as Vertex, see the asserts in Mesh.h
+	vertices.resize(builtinData.VertexCount);
+	std::memcpy(static_cast<void*>(&vertices[0]), builtinData.Vertices, sizeof(Vertex) * builtinData.VertexCount);
+	indices.assign(builtinData.Indices, builtinData.Indices + builtinData.IndexCount);
 
+	return;
+}
+
+void MeshRenderer::HandleGLSetup()
+{
 	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	VertexArrayCache::Bind(*vertexLayout, vbo, ebo);
+
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * builtinData.VertexCount, builtinData.Vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * builtinData.IndexCount, builtinData.Indices, GL_STATIC_DRAW);
+
+	indexCount = static_cast<GLsizei>(builtinData.IndexCount);
+	indexType = GL_UNSIGNED_SHORT;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshRenderer::HandleCookedMesh(std::string _cookedMeshFile)
+{
+	CookedMesh cookedMesh;
+	if (!cookedMesh.Open(_cookedMeshFile)) {
+		return;
+	}
 
+	glGenBuffers(1, &vbo);
 	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+	VertexArrayCache::Bind(*vertexLayout, vbo, ebo);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	cookedMesh.Upload();
+
+	indexCount = static_cast<GLsizei>(cookedMesh.getIndexCount());
+	indexType = cookedMesh.getIndexType();
+
+	// A single chunk starting at vertex 0 is an ordinary draw
+	const CookedSubmesh* kSubmeshes = cookedMesh.getSubmeshes();
+	if (cookedMesh.getSubmeshCount() > 1) {
+		for (uint32_t i = 0; i < cookedMesh.getSubmeshCount(); i++) {
+			MeshChunk chunk = { kSubmeshes[i].FirstIndex, kSubmeshes[i].IndexCount, kSubmeshes[i].BaseVertex, kSubmeshes[i].VertexCount };
+			chunks.push_back(chunk);
+		}
+	}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, Vertex::texture_coordinate)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, Vertex::normal)));
+	// The farthest corner of the cooked bounds stands in for the per vertex scan
+	boundingRadius = glm::length(glm::max(glm::abs(cookedMesh.getBoundsMin()), glm::abs(cookedMesh.getBoundsMax())));
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
 }
@@ -12,42 +12,101 @@
 
 #include "Camera.h"
 #include "LightRenderer.h"
+#include "CookedMesh.h"
+#include "VertexPacking.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "IndexBuffer.h"
+#include "ClusteredLighting.h"
+#include "CommandBuffer.h"
 
 class MeshRenderer
 {
 public:
 	MeshRenderer(MeshType _meshType, Camera* _camera, btRigidBody* _rigidBody, std::string _name, LightRenderer* _light, float _specularStrength, float _ambientStrength);
+	MeshRenderer(std::string _cookedMeshFile, Camera* _camera, btRigidBody* _rigidBody, std::string _name, LightRenderer* _light, float _specularStrength, float _ambientStrength);
 	~MeshRenderer();
 	
-	void Draw() ;
+	// Records the draw and replays it straight away
+	void Draw();
+	// Appends the draw without touching GL, renderers can be recorded on separate worker threads
+	void Record(CommandBuffer& commands);
 
-	void SetupLighting();
+	void RecordLighting(CommandBuffer& commands) const;
+
+	// Re-uploads the mesh as 16 byte PackedVertex, the program must decode it like LitTexturedModelPacked.vs
+	void PackVertices();
+	// Builds 50%, 25% and 10% triangle levels into the index buffer, Draw picks one from the projected size
+	void BuildLods();
+	// Splits the full detail level into meshlets, Draw then culls them against the frustum and by facing
+	void BuildMeshlets();
 
 	void setPosition(glm::vec3 _position);
 	void setScale(glm::vec3 _scale);
 	void setProgram(GLuint _program);
 	void setTexture(GLuint _textureID);
 
+	// Rigid body transform with the scale applied, also places occluder boxes
+	glm::mat4 GetModelMatrix() const;
+	// Same for a body drawn without a MeshRenderer, like the headless software path does
+	static glm::mat4 GetModelMatrix(const btRigidBody* _rigidBody, glm::vec3 _scale);
+
 	std::string getName() const;
+	GLuint getTexture() const;
+	glm::vec3 getWorldPosition() const;
+	float getBoundingRadius() const;
+	size_t getLodCount() const;
+	size_t getCurrentLod() const;
+	const MeshletCullStats& getMeshletStats() const;
+	// False when a cooked file could not be mapped, nothing was uploaded
+	bool isLoaded() const;
+	// Only true once PackVertices re-uploaded the mesh, cooked meshes stay unpacked
+	bool isPacked() const;
+
+	static void setViewportHeight(float _viewportHeight);
+	// Point lights every lit program built with FEATURE_CLUSTERED reads, null to leave them out
+	static void setClusteredLighting(const ClusteredLighting* _clusteredLighting);
 
 	btRigidBody* getRigidBody() const;
 
 private:
 	float ambientStrength;
 	float specularStrength;
+	float boundingRadius;
 
 	std::string name;
 
 	glm::vec3 scale;
 
+	// Only filled for built-in meshes when packing or simplifying needs them
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
+	MeshData builtinData;
+	GLsizei indexCount;
+	GLenum indexType;		// GL_UNSIGNED_SHORT unless the mesh needs 32 bit indices
+
+	// Cooked meshes split for 16 bit indices draw each chunk from its own base vertex
+	std::vector<MeshChunk> chunks;
+
+	bool bPacked;
+	PackedVertexBounds packedBounds;
+
+	std::vector<MeshLod> lods;
+	size_t currentLod;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<GLsizei> meshletCounts;
+	std::vector<const void*> meshletOffsets;
+	MeshletCullStats meshletStats;
+
+	static float viewportHeight;
+	static const ClusteredLighting* clusteredLighting;
 
 	glm::vec3 position;
 
 	GLuint vbo; // Vertex Buffer Object
 	GLuint ebo; // Element Buffer Object;
-	GLuint vao; // Vertex Array Object
+	const VertexLayout* vertexLayout;	// kPackedVertexLayout once packed
 	GLuint program;
 	GLuint texture;
 
@@ -57,8 +116,14 @@ private:
 
 	LightRenderer* light;
 
+	CommandBuffer drawCommands;	// reused by Draw
+	GLCommandExecutor drawExecutor;
+
 	void HandleMeshType(MeshType _meshType);
+	void LoadMeshData();
 	void HandleGLSetup();
-	void SetupModelViewProjectionMatrix();
+	void HandleCookedMesh(std::string _cookedMeshFile);
+	size_t SelectLod() const;
+	void RecordModelViewProjectionMatrix(CommandBuffer& commands) const;
 };
 
@@ -0,0 +1,470 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+// Border and seam edges weigh this much more than the surface so outlines hold their shape
+static const float kBoundaryWeight = 10.0f;
+// A level must drop at least this fraction of the previous level's triangles to be kept
+static const float kMinLodReduction = 0.1f;
+
+static const uint32_t kNoVertex = 0xFFFFFFFF;
+static const uint32_t kManyVertices = 0xFFFFFFFE;
+
+enum SimplifierVertexKind
+{
+	kManifold = 0,	// one attribute set, fully surrounded
+	kBorder,		// one attribute set on an open border
+	kSeam,			// two attribute sets split along a seam
+	kLocked,		// anything else, never moved
+};
+
+struct Quadric
+{
+	float	A00, A11, A22;
+	float	A01, A02, A12;
+	float	B0, B1, B2;
+	float	C;
+	float	Weight;
+};
+
+struct Collapse
+{
+	uint32_t	From;
+	uint32_t	To;
+	float		Cost;
+};
+
+static Quadric MakePlaneQuadric(glm::vec3 _normal, float _distance, float _weight)
+{
+	Quadric q;
+	q.A00 = _normal.x * _normal.x * _weight;
+	q.A11 = _normal.y * _normal.y * _weight;
+	q.A22 = _normal.z * _normal.z * _weight;
+	q.A01 = _normal.x * _normal.y * _weight;
+	q.A02 = _normal.x * _normal.z * _weight;
+	q.A12 = _normal.y * _normal.z * _weight;
+	q.B0 = _normal.x * _distance * _weight;
+	q.B1 = _normal.y * _distance * _weight;
+	q.B2 = _normal.z * _distance * _weight;
+	q.C = _distance * _distance * _weight;
+	q.Weight = _weight;
+
+	return q;
+}
+
+static void AddQuadric(Quadric& _q, const Quadric& _r)
+{
+	_q.A00 += _r.A00; _q.A11 += _r.A11; _q.A22 += _r.A22;
+	_q.A01 += _r.A01; _q.A02 += _r.A02; _q.A12 += _r.A12;
+	_q.B0 += _r.B0; _q.B1 += _r.B1; _q.B2 += _r.B2;
+	_q.C += _r.C;
+	_q.Weight += _r.Weight;
+
+	return;
+}
+
+// Weighted mean squared distance from p to the planes accumulated in q
+static float QuadricError(const Quadric& _q, glm::vec3 _p)
+{
+	const float kRx = _q.A00 * _p.x + _q.A01 * _p.y + _q.A02 * _p.z + _q.B0 * 2.0f;
+	const float kRy = _q.A01 * _p.x + _q.A11 * _p.y + _q.A12 * _p.z + _q.B1 * 2.0f;
+	const float kRz = _q.A02 * _p.x + _q.A12 * _p.y + _q.A22 * _p.z + _q.B2 * 2.0f;
+	const float kError = kRx * _p.x + kRy * _p.y + kRz * _p.z + _q.C;
+
+	return std::fabs(kError) / (_q.Weight > 0.0f ? _q.Weight : 1.0f);
+}
+
+// Directed edges of the triangle list packed per start vertex
+struct EdgeAdjacency
+{
+	std::vector<uint32_t>	Offsets;
+	std::vector<uint32_t>	Targets;
+};
+
+static void BuildEdgeAdjacency(EdgeAdjacency& _adjacency, const std::vector<uint32_t>& _indices, size_t _vertexCount)
+{
+	_adjacency.Offsets.assign(_vertexCount + 1, 0);
+	_adjacency.Targets.resize(_indices.size());
+
+	for (uint32_t index : _indices) {
+		_adjacency.Offsets[index + 1]++;
+	}
+	for (size_t v = 0; v < _vertexCount; v++) {
+		_adjacency.Offsets[v + 1] += _adjacency.Offsets[v];
+	}
+
+	std::vector<uint32_t> fill(_adjacency.Offsets.begin(), _adjacency.Offsets.end() - 1);
+	for (size_t i = 0; i < _indices.size(); i += 3) {
+		for (int e = 0; e < 3; e++) {
+			const uint32_t kA = _indices[i + e];
+			const uint32_t kB = _indices[i + (e + 1) % 3];
+			_adjacency.Targets[fill[kA]++] = kB;
+		}
+	}
+
+	return;
+}
+
+static bool HasEdge(const EdgeAdjacency& _adjacency, uint32_t _a, uint32_t _b)
+{
+	for (uint32_t e = _adjacency.Offsets[_a]; e < _adjacency.Offsets[_a + 1]; e++) {
+		if (_adjacency.Targets[e] == _b) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// An edge is open when no triangle walks it the other way
+static bool IsOpenEdge(const EdgeAdjacency& _adjacency, uint32_t _a, uint32_t _b)
+{
+	return (HasEdge(_adjacency, _a, _b) && !HasEdge(_adjacency, _b, _a)) ||
+		(HasEdge(_adjacency, _b, _a) && !HasEdge(_adjacency, _a, _b));
+}
+
+static void ClassifyVertices(std::vector<unsigned char>& _kinds, const std::vector<uint32_t>& _indices, const std::vector<uint32_t>& _remap, const std::vector<uint32_t>& _wedge, size_t _vertexCount)
+{
+	EdgeAdjacency adjacency;
+	BuildEdgeAdjacency(adjacency, _indices, _vertexCount);
+
+	// The single open edge leaving and entering each vertex
+	std::vector<uint32_t> openOut(_vertexCount, kNoVertex);
+	std::vector<uint32_t> openIn(_vertexCount, kNoVertex);
+
+	for (uint32_t a = 0; a < _vertexCount; a++) {
+		for (uint32_t e = adjacency.Offsets[a]; e < adjacency.Offsets[a + 1]; e++) {
+			const uint32_t kB = adjacency.Targets[e];
+			if (HasEdge(adjacency, kB, a)) {
+				continue;
+			}
+			openOut[a] = (openOut[a] == kNoVertex) ? kB : kManyVertices;
+			openIn[kB] = (openIn[kB] == kNoVertex) ? a : kManyVertices;
+		}
+	}
+
+	_kinds.assign(_vertexCount, kLocked);
+	for (uint32_t v = 0; v < _vertexCount; v++) {
+		const uint32_t kPartner = _wedge[v];
+
+		if (kPartner == v) {
+			if (openOut[v] == kNoVertex && openIn[v] == kNoVertex) {
+				_kinds[v] = kManifold;
+			}
+			else if (openOut[v] < kManyVertices && openIn[v] < kManyVertices && openOut[v] != v) {
+				_kinds[v] = kBorder;
+			}
+		}
+		else if (_wedge[kPartner] == v) {
+			// Both sides of a seam must run along the same positions in opposite directions
+			const bool kSingle =
+				openOut[v] < kManyVertices && openIn[v] < kManyVertices &&
+				openOut[kPartner] < kManyVertices && openIn[kPartner] < kManyVertices;
+
+			if (kSingle &&
+				_remap[openOut[v]] == _remap[openIn[kPartner]] &&
+				_remap[openIn[v]] == _remap[openOut[kPartner]]) {
+				_kinds[v] = kSeam;
+			}
+		}
+	}
+
+	return;
+}
+
+// Public //
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, size_t _targetIndexCount, std::vector<uint32_t>& result)
+{
+	const size_t kVertexCount = _vertices.size();
+	result = _indices;
+
+	if (result.size() <= _targetIndexCount) {
+		return 0.0f;
+	}
+
+	// Vertices sharing a position are welded, wedge links them in a ring
+	std::vector<uint32_t> remap(kVertexCount);
+	std::vector<uint32_t> wedge(kVertexCount);
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& _p) const
+			{
+				uint32_t bits[3];
+				std::memcpy(bits, &_p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> positions;
+		positions.reserve(kVertexCount);
+
+		for (uint32_t v = 0; v < kVertexCount; v++) {
+			const uint32_t kFirst = positions.insert(std::make_pair(_vertices[v].position, v)).first->second;
+			remap[v] = kFirst;
+			wedge[v] = v;
+
+			if (kFirst != v) {
+				wedge[v] = wedge[kFirst];
+				wedge[kFirst] = v;
+			}
+		}
+	}
+
+	std::vector<unsigned char> kinds;
+	ClassifyVertices(kinds, result, remap, wedge, kVertexCount);
+
+	// Quadrics live on the welded vertex so every wedge sees the same surface
+	const Quadric kZero = {};
+	std::vector<Quadric> quadrics(kVertexCount, kZero);
+	{
+		EdgeAdjacency adjacency;
+		BuildEdgeAdjacency(adjacency, result, kVertexCount);
+
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const glm::vec3& p0 = _vertices[result[i + 0]].position;
+			const glm::vec3& p1 = _vertices[result[i + 1]].position;
+			const glm::vec3& p2 = _vertices[result[i + 2]].position;
+
+			const glm::vec3 kCross = glm::cross(p1 - p0, p2 - p0);
+			const float kArea = glm::length(kCross);
+			if (kArea <= 0.0f) {
+				continue;
+			}
+
+			const glm::vec3 kNormal = kCross / kArea;
+			const Quadric kPlane = MakePlaneQuadric(kNormal, -glm::dot(kNormal, p0), kArea);
+			for (int c = 0; c < 3; c++) {
+				AddQuadric(quadrics[remap[result[i + c]]], kPlane);
+			}
+
+			// Open edges get a plane at right angles to the triangle so they resist moving sideways
+			for (int e = 0; e < 3; e++) {
+				const uint32_t kA = result[i + e];
+				const uint32_t kB = result[i + (e + 1) % 3];
+				if (HasEdge(adjacency, kB, kA)) {
+					continue;
+				}
+
+				const glm::vec3 kEdge = _vertices[kB].position - _vertices[kA].position;
+				const float kLength = glm::length(kEdge);
+				if (kLength <= 0.0f) {
+					continue;
+				}
+
+				const glm::vec3 kEdgeNormal = glm::normalize(glm::cross(kEdge, kNormal));
+				const Quadric kEdgePlane = MakePlaneQuadric(kEdgeNormal, -glm::dot(kEdgeNormal, _vertices[kA].position), kLength * kLength * kBoundaryWeight);
+				AddQuadric(quadrics[remap[kA]], kEdgePlane);
+				AddQuadric(quadrics[remap[kB]], kEdgePlane);
+			}
+		}
+	}
+
+	float worstCost = 0.0f;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(kVertexCount);
+	std::vector<bool> lockedThisPass(kVertexCount);
+	std::vector<uint32_t> triangleOffsets;
+	std::vector<uint32_t> triangles;
+
+	while (result.size() > _targetIndexCount) {
+		EdgeAdjacency adjacency;
+		BuildEdgeAdjacency(adjacency, result, kVertexCount);
+
+		// Triangles around every welded vertex, for the flip test
+		triangleOffsets.assign(kVertexCount + 1, 0);
+		triangles.resize(result.size());
+		for (uint32_t index : result) {
+			triangleOffsets[remap[index] + 1]++;
+		}
+		for (size_t v = 0; v < kVertexCount; v++) {
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				triangles[fill[remap[result[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// Every legal directed collapse along an edge, cheapest first
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				const uint32_t kEnds[2] = { result[i + e], result[i + (e + 1) % 3] };
+
+				for (int d = 0; d < 2; d++) {
+					const uint32_t kFrom = kEnds[d];
+					const uint32_t kTo = kEnds[1 - d];
+					const unsigned char kKind = kinds[kFrom];
+
+					if (kKind == kLocked) {
+						continue;
+					}
+					if (kKind == kBorder && !(IsOpenEdge(adjacency, kFrom, kTo) && (kinds[kTo] == kBorder || kinds[kTo] == kLocked))) {
+						continue;
+					}
+					if (kKind == kSeam && !(IsOpenEdge(adjacency, kFrom, kTo) && (kinds[kTo] == kSeam || kinds[kTo] == kLocked))) {
+						continue;
+					}
+
+					Quadric q = quadrics[remap[kFrom]];
+					AddQuadric(q, quadrics[remap[kTo]]);
+
+					Collapse collapse = { kFrom, kTo, QuadricError(q, _vertices[kTo].position) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) {
+			return _a.Cost < _b.Cost;
+		});
+
+		for (uint32_t v = 0; v < kVertexCount; v++) {
+			collapseRemap[v] = v;
+		}
+		lockedThisPass.assign(kVertexCount, false);
+
+		// Borders and seams remove one triangle per side, the interior two
+		const size_t kTriangleGoal = (result.size() - _targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses) {
+			if (trianglesRemoved >= kTriangleGoal) {
+				break;
+			}
+
+			const uint32_t kFrom = remap[collapse.From];
+			const uint32_t kTo = remap[collapse.To];
+			if (lockedThisPass[kFrom] || lockedThisPass[kTo]) {
+				continue;
+			}
+
+			// The other side of a seam moves to the matching wedge across the seam
+			uint32_t partnerFrom = kNoVertex;
+			uint32_t partnerTo = kNoVertex;
+			if (kinds[collapse.From] == kSeam) {
+				partnerFrom = wedge[collapse.From];
+				for (uint32_t w = wedge[collapse.To]; w != collapse.To; w = wedge[w]) {
+					if (IsOpenEdge(adjacency, partnerFrom, w)) {
+						partnerTo = w;
+						break;
+					}
+				}
+				if (partnerTo == kNoVertex) {
+					continue;
+				}
+			}
+
+			// Reject collapses that would flip or squash a surrounding triangle
+			const glm::vec3& kTarget = _vertices[collapse.To].position;
+			bool bFlips = false;
+			for (uint32_t t = triangleOffsets[kFrom]; t < triangleOffsets[kFrom + 1] && !bFlips; t++) {
+				const uint32_t kTriangle = triangles[t];
+				uint32_t corners[3];
+				bool bCollapses = false;
+				for (int c = 0; c < 3; c++) {
+					corners[c] = remap[result[kTriangle * 3 + c]];
+					bCollapses = bCollapses || (corners[c] == kTo);
+				}
+				if (bCollapses) {
+					continue;
+				}
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (int c = 0; c < 3; c++) {
+					before[c] = _vertices[corners[c]].position;
+					after[c] = (corners[c] == kFrom) ? kTarget : before[c];
+				}
+
+				const glm::vec3 kBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 kAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				bFlips = glm::dot(kBefore, kAfter) <= 0.25f * glm::length(kBefore) * glm::length(kAfter);
+			}
+			if (bFlips) {
+				continue;
+			}
+
+			collapseRemap[collapse.From] = collapse.To;
+			if (partnerFrom != kNoVertex) {
+				collapseRemap[partnerFrom] = partnerTo;
+			}
+			AddQuadric(quadrics[kTo], quadrics[kFrom]);
+
+			// The one ring of the collapsed vertex changed shape, nothing else may touch it this pass
+			for (uint32_t t = triangleOffsets[kFrom]; t < triangleOffsets[kFrom + 1]; t++) {
+				for (int c = 0; c < 3; c++) {
+					lockedThisPass[remap[result[triangles[t] * 3 + c]]] = true;
+				}
+			}
+			lockedThisPass[kTo] = true;
+
+			trianglesRemoved += (kinds[collapse.From] == kManifold || kinds[collapse.From] == kSeam) ? 2 : 1;
+			worstCost = std::max(worstCost, collapse.Cost);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const uint32_t kA = collapseRemap[result[i + 0]];
+			const uint32_t kB = collapseRemap[result[i + 1]];
+			const uint32_t kC = collapseRemap[result[i + 2]];
+
+			if (remap[kA] == remap[kB] || remap[kB] == remap[kC] || remap[kC] == remap[kA]) {
+				continue;
+			}
+
+			result[write++] = kA;
+			result[write++] = kB;
+			result[write++] = kC;
+		}
+		result.resize(write);
+	}
+
+	return std::sqrt(worstCost);
+}
+
+void MeshSimplifier::BuildLodChain(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const std::vector<float>& _ratios, std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices)
+{
+	lods.clear();
+	lodIndices = _indices;
+
+	MeshLod base = { 0, static_cast<uint32_t>(_indices.size()), 0.0f };
+	lods.push_back(base);
+
+	std::vector<uint32_t> simplified;
+	for (float ratio : _ratios) {
+		const size_t kTarget = static_cast<size_t>(_indices.size() / 3 * ratio) * 3;
+		const float kError = Simplify(_vertices, _indices, kTarget, simplified);
+
+		// Stop once the simplifier is stuck on locked vertices
+		const uint32_t kPrevious = lods.back().IndexCount;
+		if (simplified.size() > kPrevious * (1.0f - kMinLodReduction)) {
+			break;
+		}
+
+		// Each level gets its own vertex cache order over the shared vertices
+		MeshOptimizer::OptimizeVertexCache(simplified, _vertices.size());
+
+		MeshLod lod = { static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(simplified.size()), std::max(kError, lods.back().Error) };
+		lods.push_back(lod);
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+	}
+
+	return;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+#include "Mesh.h"
+
+// One level of detail, an index range into a shared index buffer over the unchanged vertex buffer
+struct MeshLod
+{
+	uint32_t	FirstIndex;
+	uint32_t	IndexCount;
+	float		Error;		// largest distance the surface moved, in mesh units
+};
+
+// Quadric error metric edge collapse. Collapses only ever move a vertex onto one of its neighbours,
+// so every level draws from the original vertex buffer. Open borders and UV / normal seams can only
+// collapse along themselves, vertices where more than two attribute sets meet never move.
+class MeshSimplifier
+{
+public:
+	// Simplifies towards _targetIndexCount, returns the error of the worst collapse
+	static float Simplify(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, size_t _targetIndexCount, std::vector<uint32_t>& result);
+
+	// Level 0 is _indices itself, further levels target the given triangle ratios until one stops reducing
+	static void BuildLodChain(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const std::vector<float>& _ratios, std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices);
+};
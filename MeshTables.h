@@ -0,0 +1,163 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Plain float mirror of Vertex so tables can be built at compile time, the layout matches so they upload as is
+struct MeshVertexData
+{
+	float	Position[3];
+	float	Normal[3];
+	float	Color[3];
+	float	TexCoord[2];
+};
+
+// Built-in geometry evaluated by the compiler, the sphere included. Nothing here allocates or runs at startup.
+class MeshTables
+{
+public:
+	static constexpr double kPi = 3.14159265358979323846;
+	// Columns per vertical strip of sphere triangles, two rows of a strip fit a 16 entry vertex cache
+	static constexpr uint32_t kSphereStripColumns = 7;
+
+	static constexpr double Sin(double _x)
+	{
+		// Reduce to [-pi, pi] then sum the Taylor series, accurate to a double ulp there
+		const double kTurns = (_x + kPi) / (2.0 * kPi);
+		long long whole = static_cast<long long>(kTurns);
+		if (kTurns < 0.0 && static_cast<double>(whole) != kTurns) {
+			whole--;
+		}
+		const double kX = _x - static_cast<double>(whole) * 2.0 * kPi;
+
+		double term = kX;
+		double sum = kX;
+		for (int n = 1; n < 20; n++) {
+			term *= -kX * kX / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	static constexpr double Cos(double _x)
+	{
+		return Sin(_x + kPi * 0.5);
+	}
+
+	static constexpr double Sqrt(double _x)
+	{
+		if (_x <= 0.0) {
+			return 0.0;
+		}
+
+		double root = _x > 1.0 ? _x : 1.0;
+		for (int i = 0; i < 64; i++) {
+			root = 0.5 * (root + _x / root);
+		}
+
+		return root;
+	}
+
+	template<size_t N>
+	static constexpr float BoundingRadius(const std::array<MeshVertexData, N>& _vertices)
+	{
+		double radiusSquared = 0.0;
+		for (size_t i = 0; i < N; i++) {
+			const double kLengthSquared =
+				(double)_vertices[i].Position[0] * _vertices[i].Position[0] +
+				(double)_vertices[i].Position[1] * _vertices[i].Position[1] +
+				(double)_vertices[i].Position[2] * _vertices[i].Position[2];
+			radiusSquared = kLengthSquared > radiusSquared ? kLengthSquared : radiusSquared;
+		}
+
+		return static_cast<float>(Sqrt(radiusSquared));
+	}
+};
+
+// Unit sphere with the band count fixed at compile time, vertices match ProceduralMesh::GenerateSphere.
+// Only four sines and cosines are summed as series, the rest follow by recurrence, which keeps 20 bands
+// inside the default constexpr step limits of MSVC and g++.
+template<uint32_t Bands>
+struct SphereTable
+{
+	static constexpr size_t kVertexCount = (size_t)(Bands + 1) * (Bands + 1);
+	static constexpr size_t kIndexCount = (size_t)(Bands * 2 - 2) * Bands * 3;
+
+	static_assert(Bands >= 2, "A sphere needs at least two bands");
+	static_assert(kVertexCount <= 65536, "Built-in tables store 16 bit indices");
+
+	MeshVertexData	Vertices[kVertexCount];
+	uint16_t		Indices[kIndexCount];
+
+	static constexpr SphereTable Build()
+	{
+		SphereTable table{};
+
+		// Ring and column angles are multiples of one step, so they come from the angle addition formulas
+		// instead of a series per angle: sin(a + d) = sin(a) cos(d) + cos(a) sin(d)
+		const double kRingSin = MeshTables::Sin(MeshTables::kPi / Bands);
+		const double kRingCos = MeshTables::Cos(MeshTables::kPi / Bands);
+		const double kColumnSin = MeshTables::Sin(2.0 * MeshTables::kPi / Bands);
+		const double kColumnCos = MeshTables::Cos(2.0 * MeshTables::kPi / Bands);
+
+		double sinTheta[Bands + 1] = {};
+		double cosTheta[Bands + 1] = {};
+		double sinPhi[Bands + 1] = {};
+		double cosPhi[Bands + 1] = {};
+		cosTheta[0] = 1.0;
+		cosPhi[0] = 1.0;
+		for (uint32_t i = 1; i <= Bands; i++) {
+			sinTheta[i] = sinTheta[i - 1] * kRingCos + cosTheta[i - 1] * kRingSin;
+			cosTheta[i] = cosTheta[i - 1] * kRingCos - sinTheta[i - 1] * kRingSin;
+			sinPhi[i] = sinPhi[i - 1] * kColumnCos + cosPhi[i - 1] * kColumnSin;
+			cosPhi[i] = cosPhi[i - 1] * kColumnCos - sinPhi[i - 1] * kColumnSin;
+		}
+
+		// Poles are exact so their rings collapse to a single point, the last column repeats the first so the seam closes exactly
+		sinTheta[Bands] = 0.0;
+		cosTheta[Bands] = -1.0;
+		sinPhi[Bands] = 0.0;
+		cosPhi[Bands] = 1.0;
+
+		for (uint32_t ring = 0; ring <= Bands; ring++) {
+			for (uint32_t column = 0; column <= Bands; column++) {
+				const float kX = static_cast<float>(cosPhi[column] * sinTheta[ring]);
+				const float kY = static_cast<float>(cosTheta[ring]);
+				const float kZ = static_cast<float>(sinPhi[column] * sinTheta[ring]);
+				table.Vertices[ring * (Bands + 1) + column] = {
+					{ kX, kY, kZ },
+					{ kX, kY, kZ },
+					{ kX, kY, kZ },
+					{ static_cast<float>(column) / Bands, static_cast<float>(ring) / Bands }
+				};
+			}
+		}
+
+		// Triangles go in vertical strips instead of whole rows so they reuse the vertex cache
+		size_t index = 0;
+		for (uint32_t strip = 0; strip < Bands; strip += MeshTables::kSphereStripColumns) {
+			const uint32_t kStripEnd = (strip + MeshTables::kSphereStripColumns < Bands) ? strip + MeshTables::kSphereStripColumns : Bands;
+
+			for (uint32_t ring = 0; ring < Bands; ring++) {
+				for (uint32_t column = strip; column < kStripEnd; column++) {
+					const uint32_t kFirst = ring * (Bands + 1) + column;
+					const uint32_t kSecond = kFirst + Bands + 1;
+
+					if (ring != 0) {
+						table.Indices[index++] = static_cast<uint16_t>(kFirst);
+						table.Indices[index++] = static_cast<uint16_t>(kSecond);
+						table.Indices[index++] = static_cast<uint16_t>(kFirst + 1);
+					}
+					if (ring != Bands - 1) {
+						table.Indices[index++] = static_cast<uint16_t>(kSecond);
+						table.Indices[index++] = static_cast<uint16_t>(kSecond + 1);
+						table.Indices[index++] = static_cast<uint16_t>(kFirst + 1);
+					}
+				}
+			}
+		}
+
+		return table;
+	}
+};
@@ -0,0 +1,263 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Most recent candidate triangles looked at when growing a meshlet, bounds build time on big meshes
+static const size_t kMaxCandidates = 128;
+
+static void ComputeBounds(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, Meshlet& meshlet)
+{
+	const uint32_t kFirst = meshlet.FirstIndex;
+	const uint32_t kCount = meshlet.TriangleCount * 3;
+
+	glm::vec3 center = glm::vec3(0.0f);
+	for (uint32_t i = kFirst; i < kFirst + kCount; i++) {
+		center += _vertices[_indices[i]].position;
+	}
+	center /= static_cast<float>(kCount);
+
+	float radius = 0.0f;
+	for (uint32_t i = kFirst; i < kFirst + kCount; i++) {
+		radius = std::max(radius, glm::length(_vertices[_indices[i]].position - center));
+	}
+
+	// Facing comes from the geometry, flipped to agree with the authored normals whatever the winding
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.TriangleCount);
+	glm::vec3 axis = glm::vec3(0.0f);
+
+	for (uint32_t i = kFirst; i < kFirst + kCount; i += 3) {
+		const Vertex& a = _vertices[_indices[i + 0]];
+		const Vertex& b = _vertices[_indices[i + 1]];
+		const Vertex& c = _vertices[_indices[i + 2]];
+
+		glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+		const float kLength = glm::length(normal);
+		if (kLength <= 0.0f) {
+			continue;
+		}
+		normal /= kLength;
+		if (glm::dot(normal, a.normal + b.normal + c.normal) < 0.0f) {
+			normal = -normal;
+		}
+
+		normals.push_back(normal);
+		axis += normal;
+	}
+
+	meshlet.Center = center;
+	meshlet.Radius = radius;
+	meshlet.ConeAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+	meshlet.ConeCutoff = 1.0f;
+
+	const float kAxisLength = glm::length(axis);
+	if (kAxisLength <= 0.0f) {
+		return;
+	}
+	axis /= kAxisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals) {
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+
+	// Normals spread over a hemisphere or more always have a triangle facing the camera
+	meshlet.ConeAxis = axis;
+	if (minDot > 0.0f) {
+		meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+
+	return;
+}
+
+// Public //
+
+void MeshletBuilder::Build(const std::vector<Vertex>& _vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+
+	const size_t kVertexCount = _vertices.size();
+	const uint32_t kTriangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	// Triangles around each vertex
+	std::vector<uint32_t> adjacencyOffsets(kVertexCount + 1, 0);
+	for (uint32_t index : indices) {
+		adjacencyOffsets[index + 1]++;
+	}
+	for (size_t v = 0; v < kVertexCount; v++) {
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<bool> emitted(kTriangleCount, false);
+	// Meshlet id + 1 that last used each vertex, so membership needs no clearing
+	std::vector<uint32_t> vertexOwner(kVertexCount, 0);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> ordered;
+	ordered.reserve(indices.size());
+
+	uint32_t scan = 0;
+	uint32_t seed = kTriangleCount;
+
+	while (true) {
+		// Seed from the last rejected neighbour if there is one, so meshlets stay next to each other
+		if (seed >= kTriangleCount || emitted[seed]) {
+			while (scan < kTriangleCount && emitted[scan]) {
+				scan++;
+			}
+			if (scan == kTriangleCount) {
+				break;
+			}
+			seed = scan;
+		}
+
+		Meshlet meshlet;
+		meshlet.FirstIndex = static_cast<uint32_t>(ordered.size());
+		meshlet.TriangleCount = 0;
+		meshlet.VertexCount = 0;
+		const uint32_t kOwner = static_cast<uint32_t>(meshlets.size()) + 1;
+
+		candidates.clear();
+		glm::vec3 positionSum = glm::vec3(0.0f);
+		uint32_t next = seed;
+		seed = kTriangleCount;
+
+		while (next < kTriangleCount) {
+			// Add the triangle and queue its neighbours
+			emitted[next] = true;
+			meshlet.TriangleCount++;
+			for (int c = 0; c < 3; c++) {
+				const uint32_t kVertex = indices[next * 3 + c];
+				ordered.push_back(kVertex);
+
+				if (vertexOwner[kVertex] != kOwner) {
+					vertexOwner[kVertex] = kOwner;
+					meshlet.VertexCount++;
+					positionSum += _vertices[kVertex].position;
+				}
+				for (uint32_t a = adjacencyOffsets[kVertex]; a < adjacencyOffsets[kVertex + 1]; a++) {
+					if (!emitted[adjacency[a]]) {
+						candidates.push_back(adjacency[a]);
+					}
+				}
+			}
+
+			if (meshlet.TriangleCount == kMaxTriangles) {
+				break;
+			}
+
+			// Best neighbour adds the fewest new vertices, then keeps the meshlet round so its bounds stay tight
+			const glm::vec3 kCenter = positionSum / static_cast<float>(meshlet.VertexCount);
+			next = kTriangleCount;
+			int bestNew = 4;
+			float bestDistance = 0.0f;
+			const size_t kStart = candidates.size() > kMaxCandidates ? candidates.size() - kMaxCandidates : 0;
+			for (size_t i = candidates.size(); i-- > kStart;) {
+				const uint32_t kCandidate = candidates[i];
+				if (emitted[kCandidate]) {
+					continue;
+				}
+
+				int newVertices = 0;
+				glm::vec3 centroid = glm::vec3(0.0f);
+				for (int c = 0; c < 3; c++) {
+					newVertices += (vertexOwner[indices[kCandidate * 3 + c]] != kOwner) ? 1 : 0;
+					centroid += _vertices[indices[kCandidate * 3 + c]].position;
+				}
+				const float kDistance = glm::length(centroid / 3.0f - kCenter);
+
+				if (newVertices < bestNew || (newVertices == bestNew && kDistance < bestDistance)) {
+					bestNew = newVertices;
+					bestDistance = kDistance;
+					next = kCandidate;
+				}
+			}
+
+			if (next < kTriangleCount && meshlet.VertexCount + bestNew > kMaxVertices) {
+				seed = next;
+				break;
+			}
+		}
+
+		ComputeBounds(_vertices, ordered, meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	indices.swap(ordered);
+
+	return;
+}
+
+MeshletCullStats MeshletBuilder::Cull(const std::vector<Meshlet>& _meshlets, const glm::mat4& _model, const glm::mat4& _viewProjection, glm::vec3 _cameraPosition, GLsizei _indexSize, std::vector<GLsizei>& counts, std::vector<const void*>& offsets)
+{
+	MeshletCullStats stats = { static_cast<uint32_t>(_meshlets.size()), 0, 0, 0, 0, 0 };
+
+	counts.clear();
+	offsets.clear();
+
+	// Frustum planes and the camera in mesh space, which is exact under any affine model matrix
+	const glm::mat4 kMvp = _viewProjection * _model;
+	glm::vec4 planes[6];
+	for (int axis = 0; axis < 3; axis++) {
+		const glm::vec4 kRow = glm::vec4(kMvp[0][axis], kMvp[1][axis], kMvp[2][axis], kMvp[3][axis]);
+		const glm::vec4 kW = glm::vec4(kMvp[0][3], kMvp[1][3], kMvp[2][3], kMvp[3][3]);
+		planes[axis * 2 + 0] = kW + kRow;
+		planes[axis * 2 + 1] = kW - kRow;
+	}
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	const glm::vec3 kEye = glm::vec3(glm::inverse(_model) * glm::vec4(_cameraPosition, 1.0f));
+
+	GLsizei runCount = 0;
+	uint32_t runEnd = 0;
+
+	for (const Meshlet& meshlet : _meshlets) {
+		bool bVisible = true;
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), meshlet.Center) + plane.w < -meshlet.Radius) {
+				bVisible = false;
+				stats.FrustumCulled++;
+				break;
+			}
+		}
+
+		// The camera is behind every triangle's plane when it sits inside the cone's back side
+		if (bVisible) {
+			const glm::vec3 kToCenter = meshlet.Center - kEye;
+			if (glm::dot(kToCenter, meshlet.ConeAxis) >= meshlet.ConeCutoff * glm::length(kToCenter) + meshlet.Radius) {
+				bVisible = false;
+				stats.BackfaceCulled++;
+			}
+		}
+
+		if (!bVisible) {
+			stats.TrianglesCulled += meshlet.TriangleCount;
+			continue;
+		}
+		stats.TrianglesDrawn += meshlet.TriangleCount;
+
+		// Survivors that follow each other in the index buffer share one command
+		if (runCount > 0 && runEnd == meshlet.FirstIndex) {
+			counts.back() += meshlet.TriangleCount * 3;
+		}
+		else {
+			counts.push_back(meshlet.TriangleCount * 3);
+			offsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(meshlet.FirstIndex) * _indexSize));
+			runCount++;
+		}
+		runEnd = meshlet.FirstIndex + meshlet.TriangleCount * 3;
+	}
+
+	stats.DrawCommands = static_cast<uint32_t>(counts.size());
+
+	return stats;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+// A run of triangles that is contiguous in the mesh's index buffer, so any subset can go out in one multi-draw
+struct Meshlet
+{
+	uint32_t	FirstIndex;
+	uint32_t	TriangleCount;
+	uint32_t	VertexCount;	// unique vertices referenced
+	glm::vec3	Center;			// bounding sphere in mesh space
+	float		Radius;
+	glm::vec3	ConeAxis;		// average facing of the triangles
+	float		ConeCutoff;		// sine of the cone half angle, 1 when the cone can never be culled
+};
+
+struct MeshletCullStats
+{
+	uint32_t	Meshlets;
+	uint32_t	FrustumCulled;
+	uint32_t	BackfaceCulled;
+	uint32_t	TrianglesDrawn;
+	uint32_t	TrianglesCulled;
+	uint32_t	DrawCommands;	// after merging neighbouring survivors
+};
+
+class MeshletBuilder
+{
+public:
+	static const uint32_t kMaxVertices = 64;
+	static const uint32_t kMaxTriangles = 124;
+
+	// Groups connected triangles into meshlets and reorders indices so each meshlet is one range
+	static void Build(const std::vector<Vertex>& _vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets);
+
+	// Fills glMultiDrawElements counts and byte offsets with the meshlets that may be visible, _indexSize is the bytes per index
+	static MeshletCullStats Cull(const std::vector<Meshlet>& _meshlets, const glm::mat4& _model, const glm::mat4& _viewProjection, glm::vec3 _cameraPosition, GLsizei _indexSize, std::vector<GLsizei>& counts, std::vector<const void*>& offsets);
+};
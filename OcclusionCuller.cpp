@@ -0,0 +1,398 @@
+#include "OcclusionCuller.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+#include <emmintrin.h>
+
+// Corners of the -1..1 cube, bit 0 is x, bit 1 is y, bit 2 is z
+static const int kBoxCorners = 8;
+// Counter clockwise seen from outside, GL's default front face
+static const int kBoxIndices[36] = {
+	0, 4, 6, 0, 6, 2,	// -x
+	1, 3, 7, 1, 7, 5,	// +x
+	0, 1, 5, 0, 5, 4,	// -y
+	2, 6, 7, 2, 7, 3,	// +y
+	0, 2, 3, 0, 3, 1,	// -z
+	4, 5, 7, 4, 7, 6,	// +z
+};
+
+// Anything this close to the eye plane can't be projected, occluders drop the triangle and occludees count as visible
+static const float kMinClipW = 1e-4f;
+
+// Below this testing costs less than starting the workers
+static const size_t kMinThreadedTests = 64;
+
+const int OcclusionCuller::kDepthWidth;
+const int OcclusionCuller::kDepthHeight;
+const int OcclusionCuller::kTileSize;
+const int OcclusionCuller::kTilesX;
+const int OcclusionCuller::kTilesY;
+
+static glm::vec4 GetBoxCorner(int _corner)
+{
+	return glm::vec4((_corner & 1) ? 1.0f : -1.0f, (_corner & 2) ? 1.0f : -1.0f, (_corner & 4) ? 1.0f : -1.0f, 1.0f);
+}
+
+// Public //
+
+OcclusionCuller::OcclusionCuller()
+{
+	this->viewProjection = glm::mat4(1.0f);
+	this->depthBuffer.assign(kDepthWidth * kDepthHeight, 1.0f);
+	this->tileDepths.assign(kTilesX * kTilesY, 1.0f);
+	this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+	this->stats = { 0, 0, 0, 0, 0.0f, 0.0f };
+
+	return;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	return;
+}
+
+void OcclusionCuller::Begin(const glm::mat4& _viewProjection)
+{
+	this->viewProjection = _viewProjection;
+	occluders.clear();
+	stats = { 0, 0, 0, 0, 0.0f, 0.0f };
+
+	return;
+}
+
+void OcclusionCuller::AddOccluder(const glm::mat4& _model)
+{
+	occluders.push_back(_model);
+	return;
+}
+
+void OcclusionCuller::Rasterize()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	SetupTriangles();
+
+	// Bands of whole tile rows, no two workers ever write the same pixel or tile
+	const int kWorkerCount = static_cast<int>(std::min<unsigned int>(threadCount, kTilesY));
+	std::vector<std::thread> threads;
+	for (int i = 1; i < kWorkerCount; i++) {
+		threads.push_back(std::thread(&OcclusionCuller::RasterizeBand, this, kTilesY * i / kWorkerCount, kTilesY * (i + 1) / kWorkerCount));
+	}
+	RasterizeBand(0, kTilesY / kWorkerCount);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	stats.Occluders = static_cast<uint32_t>(occluders.size());
+	stats.OccluderTriangles = static_cast<uint32_t>(triangles.size());
+	stats.RasterMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	return;
+}
+
+bool OcclusionCuller::IsVisible(const OcclusionBounds& _bounds) const
+{
+	glm::vec2 minScreen(static_cast<float>(kDepthWidth), static_cast<float>(kDepthHeight));
+	glm::vec2 maxScreen(0.0f, 0.0f);
+	float minDepth = 1.0f;
+
+	for (int i = 0; i < kBoxCorners; i++) {
+		const glm::vec4 kCorner((i & 1) ? _bounds.Max.x : _bounds.Min.x, (i & 2) ? _bounds.Max.y : _bounds.Min.y, (i & 4) ? _bounds.Max.z : _bounds.Min.z, 1.0f);
+		const glm::vec4 kClip = viewProjection * kCorner;
+		if (kClip.w <= kMinClipW) {
+			return true;
+		}
+
+		const glm::vec3 kNdc = glm::vec3(kClip) / kClip.w;
+		const glm::vec2 kScreen((kNdc.x * 0.5f + 0.5f) * kDepthWidth, (kNdc.y * 0.5f + 0.5f) * kDepthHeight);
+		minScreen = glm::min(minScreen, kScreen);
+		maxScreen = glm::max(maxScreen, kScreen);
+		minDepth = std::min(minDepth, kNdc.z * 0.5f + 0.5f);
+	}
+
+	// Every pixel the box touches, off screen is left to frustum culling
+	const int kMinX = std::max(static_cast<int>(std::floor(minScreen.x)), 0);
+	const int kMaxX = std::min(static_cast<int>(std::floor(maxScreen.x)), kDepthWidth - 1);
+	const int kMinY = std::max(static_cast<int>(std::floor(minScreen.y)), 0);
+	const int kMaxY = std::min(static_cast<int>(std::floor(maxScreen.y)), kDepthHeight - 1);
+	if (kMinX > kMaxX || kMinY > kMaxY) {
+		return true;
+	}
+
+	const __m128 kMinDepth = _mm_set1_ps(minDepth);
+
+	for (int tileY = kMinY / kTileSize; tileY <= kMaxY / kTileSize; tileY++) {
+		for (int tileX = kMinX / kTileSize; tileX <= kMaxX / kTileSize; tileX++) {
+			// Hidden in the whole tile when it is behind the farthest occluder pixel
+			if (minDepth > tileDepths[tileY * kTilesX + tileX]) {
+				continue;
+			}
+
+			// Otherwise only the pixels it covers count, four at a time from an aligned column
+			const int kX0 = std::max(kMinX, tileX * kTileSize) & ~3;
+			const int kX1 = std::min(kMaxX, tileX * kTileSize + kTileSize - 1);
+			const int kY0 = std::max(kMinY, tileY * kTileSize);
+			const int kY1 = std::min(kMaxY, tileY * kTileSize + kTileSize - 1);
+
+			for (int y = kY0; y <= kY1; y++) {
+				const float* kRow = &depthBuffer[y * kDepthWidth];
+				for (int x = kX0; x <= kX1; x += 4) {
+					if (_mm_movemask_ps(_mm_cmple_ps(kMinDepth, _mm_loadu_ps(kRow + x))) != 0) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionCuller::Test(const std::vector<OcclusionBounds>& _bounds, std::vector<uint8_t>& visible)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	visible.resize(_bounds.size());
+
+	const size_t kWorkerCount = (_bounds.size() < kMinThreadedTests) ? 1 : std::min<size_t>(threadCount, _bounds.size() / kMinThreadedTests);
+	std::vector<uint32_t> culled(kWorkerCount, 0);
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < kWorkerCount; i++) {
+		threads.push_back(std::thread(&OcclusionCuller::TestRange, this, std::cref(_bounds), _bounds.size() * i / kWorkerCount, _bounds.size() * (i + 1) / kWorkerCount, std::ref(visible), std::ref(culled[i])));
+	}
+	TestRange(_bounds, 0, _bounds.size() / kWorkerCount, visible, culled[0]);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	stats.Tested += static_cast<uint32_t>(_bounds.size());
+	for (size_t i = 0; i < kWorkerCount; i++) {
+		stats.Culled += culled[i];
+	}
+
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	stats.TestMs += std::chrono::duration<float, std::milli>(end - start).count();
+
+	return;
+}
+
+void OcclusionCuller::setThreadCount(unsigned int _threadCount)
+{
+	this->threadCount = std::max(1u, _threadCount);
+	return;
+}
+
+const std::vector<float>& OcclusionCuller::getDepthBuffer() const
+{
+	return depthBuffer;
+}
+
+const std::vector<float>& OcclusionCuller::getTileDepths() const
+{
+	return tileDepths;
+}
+
+const OcclusionStats& OcclusionCuller::getStats() const
+{
+	return stats;
+}
+
+bool OcclusionCuller::WriteDepthImage(const std::string& _fileName) const
+{
+	std::ofstream file(_fileName, std::ios::out | std::ios::binary);
+	if (!file.good()) {
+		std::cout << "Occlusion Culler : Can't write " << _fileName << std::endl;
+		return false;
+	}
+
+	// Perspective depth crowds next to 1, stretch whatever was drawn over the full range
+	float nearest = 1.0f;
+	for (size_t i = 0; i < depthBuffer.size(); i++) {
+		nearest = std::min(nearest, depthBuffer[i]);
+	}
+	const float kRange = std::max(1.0f - nearest, 1e-6f);
+
+	std::vector<unsigned char> pixels(kDepthWidth * kDepthHeight);
+	for (int y = 0; y < kDepthHeight; y++) {
+		for (int x = 0; x < kDepthWidth; x++) {
+			const float kDepth = depthBuffer[(kDepthHeight - 1 - y) * kDepthWidth + x];
+			pixels[y * kDepthWidth + x] = static_cast<unsigned char>(255.0f * glm::clamp((kDepth - nearest) / kRange, 0.0f, 1.0f));
+		}
+	}
+
+	file << "P5\n" << kDepthWidth << " " << kDepthHeight << "\n255\n";
+	file.write(reinterpret_cast<const char*>(&pixels[0]), pixels.size());
+
+	return file.good();
+}
+
+// Private //
+
+void OcclusionCuller::SetupTriangles()
+{
+	triangles.clear();
+
+	for (size_t i = 0; i < occluders.size(); i++) {
+		const glm::mat4 kMVP = viewProjection * occluders[i];
+
+		glm::vec4 clip[kBoxCorners];
+		for (int corner = 0; corner < kBoxCorners; corner++) {
+			clip[corner] = kMVP * GetBoxCorner(corner);
+		}
+
+		for (int index = 0; index < 36; index += 3) {
+			const glm::vec4& kA = clip[kBoxIndices[index]];
+			const glm::vec4& kB = clip[kBoxIndices[index + 1]];
+			const glm::vec4& kC = clip[kBoxIndices[index + 2]];
+
+			// Dropping an occluder triangle only ever hides less, never too much
+			if (kA.w <= kMinClipW || kB.w <= kMinClipW || kC.w <= kMinClipW) {
+				continue;
+			}
+
+			ScreenTriangle triangle;
+			const glm::vec4* kVertices[3] = { &kA, &kB, &kC };
+			for (int v = 0; v < 3; v++) {
+				const glm::vec4& kClip = *kVertices[v];
+				triangle.X[v] = (kClip.x / kClip.w * 0.5f + 0.5f) * kDepthWidth;
+				triangle.Y[v] = (kClip.y / kClip.w * 0.5f + 0.5f) * kDepthHeight;
+				triangle.Z[v] = kClip.z / kClip.w * 0.5f + 0.5f;
+			}
+
+			// Back faces sit behind the front ones of the same closed box
+			const float kArea = (triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) - (triangle.X[2] - triangle.X[0]) * (triangle.Y[1] - triangle.Y[0]);
+			if (kArea <= 0.0f) {
+				continue;
+			}
+
+			// Pixels whose centers can be inside
+			const float kMinX = std::min(triangle.X[0], std::min(triangle.X[1], triangle.X[2]));
+			const float kMaxX = std::max(triangle.X[0], std::max(triangle.X[1], triangle.X[2]));
+			const float kMinY = std::min(triangle.Y[0], std::min(triangle.Y[1], triangle.Y[2]));
+			const float kMaxY = std::max(triangle.Y[0], std::max(triangle.Y[1], triangle.Y[2]));
+			triangle.MinX = std::max(static_cast<int>(std::ceil(kMinX - 0.5f)), 0);
+			triangle.MaxX = std::min(static_cast<int>(std::floor(kMaxX - 0.5f)), kDepthWidth - 1);
+			triangle.MinY = std::max(static_cast<int>(std::ceil(kMinY - 0.5f)), 0);
+			triangle.MaxY = std::min(static_cast<int>(std::floor(kMaxY - 0.5f)), kDepthHeight - 1);
+
+			if (triangle.MinX <= triangle.MaxX && triangle.MinY <= triangle.MaxY) {
+				triangles.push_back(triangle);
+			}
+		}
+	}
+
+	return;
+}
+
+void OcclusionCuller::RasterizeBand(int _firstTileRow, int _lastTileRow)
+{
+	const int kMinY = _firstTileRow * kTileSize;
+	const int kMaxY = _lastTileRow * kTileSize - 1;
+
+	std::fill(depthBuffer.begin() + kMinY * kDepthWidth, depthBuffer.begin() + (kMaxY + 1) * kDepthWidth, 1.0f);
+
+	for (size_t i = 0; i < triangles.size(); i++) {
+		if (triangles[i].MaxY >= kMinY && triangles[i].MinY <= kMaxY) {
+			RasterizeTriangle(triangles[i], kMinY, kMaxY);
+		}
+	}
+
+	// Farthest depth of each tile, an occludee behind it is hidden in the whole tile
+	for (int tileY = _firstTileRow; tileY < _lastTileRow; tileY++) {
+		for (int tileX = 0; tileX < kTilesX; tileX++) {
+			__m128 farthest = _mm_setzero_ps();
+			for (int y = tileY * kTileSize; y < (tileY + 1) * kTileSize; y++) {
+				const float* kRow = &depthBuffer[y * kDepthWidth + tileX * kTileSize];
+				for (int x = 0; x < kTileSize; x += 4) {
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(kRow + x));
+				}
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, farthest);
+			tileDepths[tileY * kTilesX + tileX] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+		}
+	}
+
+	return;
+}
+
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& _triangle, int _minY, int _maxY)
+{
+	const float* kX = _triangle.X;
+	const float* kY = _triangle.Y;
+	const float* kZ = _triangle.Z;
+
+	// Edge i runs from vertex i to the next, E = A * x + B * y + C is >= 0 inside a counter clockwise triangle
+	float edgeA[3];
+	float edgeB[3];
+	float edgeC[3];
+	for (int i = 0; i < 3; i++) {
+		const int kNext = (i + 1) % 3;
+		edgeA[i] = kY[i] - kY[kNext];
+		edgeB[i] = kX[kNext] - kX[i];
+		edgeC[i] = (kY[kNext] - kY[i]) * kX[i] - (kX[kNext] - kX[i]) * kY[i];
+	}
+
+	// Depth is linear in screen space after the divide, a plane through the three vertices
+	const float kArea = (kX[1] - kX[0]) * (kY[2] - kY[0]) - (kX[2] - kX[0]) * (kY[1] - kY[0]);
+	const float kDepthDx = ((kZ[1] - kZ[0]) * (kY[2] - kY[0]) - (kZ[2] - kZ[0]) * (kY[1] - kY[0])) / kArea;
+	const float kDepthDy = ((kZ[2] - kZ[0]) * (kX[1] - kX[0]) - (kZ[1] - kZ[0]) * (kX[2] - kX[0])) / kArea;
+	const float kDepthC = kZ[0] - kDepthDx * kX[0] - kDepthDy * kY[0];
+
+	const __m128 kA0 = _mm_set1_ps(edgeA[0]);
+	const __m128 kA1 = _mm_set1_ps(edgeA[1]);
+	const __m128 kA2 = _mm_set1_ps(edgeA[2]);
+	const __m128 kDx = _mm_set1_ps(kDepthDx);
+	const __m128 kZero = _mm_setzero_ps();
+	const __m128 kLaneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+	const int kFirstX = _triangle.MinX & ~3;
+	const int kFirstY = std::max(_triangle.MinY, _minY);
+	const int kLastY = std::min(_triangle.MaxY, _maxY);
+
+	for (int y = kFirstY; y <= kLastY; y++) {
+		const float kPixelY = y + 0.5f;
+		const __m128 kRow0 = _mm_set1_ps(edgeB[0] * kPixelY + edgeC[0]);
+		const __m128 kRow1 = _mm_set1_ps(edgeB[1] * kPixelY + edgeC[1]);
+		const __m128 kRow2 = _mm_set1_ps(edgeB[2] * kPixelY + edgeC[2]);
+		const __m128 kRowDepth = _mm_set1_ps(kDepthDy * kPixelY + kDepthC);
+		float* row = &depthBuffer[y * kDepthWidth];
+
+		for (int x = kFirstX; x <= _triangle.MaxX; x += 4) {
+			const __m128 kPixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), kLaneOffsets);
+
+			const __m128 kE0 = _mm_add_ps(_mm_mul_ps(kA0, kPixelX), kRow0);
+			const __m128 kE1 = _mm_add_ps(_mm_mul_ps(kA1, kPixelX), kRow1);
+			const __m128 kE2 = _mm_add_ps(_mm_mul_ps(kA2, kPixelX), kRow2);
+			const __m128 kInside = _mm_and_ps(_mm_cmpge_ps(kE0, kZero), _mm_and_ps(_mm_cmpge_ps(kE1, kZero), _mm_cmpge_ps(kE2, kZero)));
+			if (_mm_movemask_ps(kInside) == 0) {
+				continue;
+			}
+
+			const __m128 kDepth = _mm_add_ps(_mm_mul_ps(kDx, kPixelX), kRowDepth);
+			const __m128 kStored = _mm_loadu_ps(row + x);
+			const __m128 kNearest = _mm_min_ps(kStored, kDepth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(kInside, kNearest), _mm_andnot_ps(kInside, kStored)));
+		}
+	}
+
+	return;
+}
+
+void OcclusionCuller::TestRange(const std::vector<OcclusionBounds>& _bounds, size_t _first, size_t _last, std::vector<uint8_t>& visible, uint32_t& culled) const
+{
+	for (size_t i = _first; i < _last; i++) {
+		visible[i] = IsVisible(_bounds[i]) ? 1 : 0;
+		culled += visible[i] ? 0 : 1;
+	}
+
+	return;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Dependencies/glm/glm/glm.hpp"
+
+// World space box of something that may be hidden
+struct OcclusionBounds
+{
+	glm::vec3	Min;
+	glm::vec3	Max;
+};
+
+struct OcclusionStats
+{
+	uint32_t	Occluders;
+	uint32_t	OccluderTriangles;	// front facing and in front of the near plane
+	uint32_t	Tested;
+	uint32_t	Culled;
+	float		RasterMs;
+	float		TestMs;
+};
+
+// CPU occlusion culling. A few marked occluder boxes are rasterized into a small depth buffer with SSE,
+// four pixels per instruction, then object bounds are tested against it before they are submitted.
+// Depth is NDC z remapped to 0..1, 1 is the far plane. Each 8x8 tile keeps its farthest depth so most
+// tests never touch single pixels.
+class OcclusionCuller
+{
+public:
+	static const int kDepthWidth = 256;
+	static const int kDepthHeight = 192;
+	static const int kTileSize = 8;
+	static const int kTilesX = kDepthWidth / kTileSize;
+	static const int kTilesY = kDepthHeight / kTileSize;
+
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	// Clears the occluders, everything added after is projected with _viewProjection
+	void Begin(const glm::mat4& _viewProjection);
+	// Box occluder, the cube from -1 to 1 under _model like the built-in cube mesh
+	void AddOccluder(const glm::mat4& _model);
+	// Rasterizes every occluder, worker threads each own a band of tile rows
+	void Rasterize();
+
+	bool IsVisible(const OcclusionBounds& _bounds) const;
+	// Tests a whole list on the workers, visible[i] is 0 for each box hidden behind the occluders
+	void Test(const std::vector<OcclusionBounds>& _bounds, std::vector<uint8_t>& visible);
+
+	void setThreadCount(unsigned int _threadCount);
+
+	// Row 0 is the bottom of the screen
+	const std::vector<float>& getDepthBuffer() const;
+	const std::vector<float>& getTileDepths() const;
+	const OcclusionStats& getStats() const;
+	// Binary PGM of the depth buffer, near is black, for checking what the culler sees
+	bool WriteDepthImage(const std::string& _fileName) const;
+
+private:
+	// Triangle in depth buffer pixels, set up once and shared by every band
+	struct ScreenTriangle
+	{
+		float	X[3];
+		float	Y[3];
+		float	Z[3];
+		int		MinX, MaxX;
+		int		MinY, MaxY;
+	};
+
+	glm::mat4 viewProjection;
+	std::vector<glm::mat4> occluders;
+	std::vector<ScreenTriangle> triangles;
+
+	std::vector<float> depthBuffer;
+	std::vector<float> tileDepths;
+
+	unsigned int threadCount;
+	OcclusionStats stats;
+
+	void SetupTriangles();
+	void RasterizeBand(int _firstTileRow, int _lastTileRow);
+	void RasterizeTriangle(const ScreenTriangle& _triangle, int _minY, int _maxY);
+	void TestRange(const std::vector<OcclusionBounds>& _bounds, size_t _first, size_t _last, std::vector<uint8_t>& visible, uint32_t& culled) const;
+};
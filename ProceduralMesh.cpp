@@ -0,0 +1,498 @@
+#include "ProceduralMesh.h"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static const double kPi = 3.14159265358979323846;
+// Fewer segments around a ring than this can't enclose anything
+static const uint32_t kMinRadialSegments = 3;
+
+// One ring of a surface of revolution, see GenerateLathe
+struct LatheRow
+{
+	float	Radius;			// distance from the y axis
+	float	Y;
+	float	NormalRadial;	// normal component pointing away from the axis
+	float	NormalY;
+	float	V;				// texture v
+};
+
+// cos / sin of _steps + 1 evenly spaced angles over _range, by rotating the previous entry.
+// Run in double so a million steps still drift by less than a float ulp.
+static void BuildSinCosTable(uint32_t _steps, double _range, std::vector<glm::vec2>& table)
+{
+	table.resize(_steps + 1);
+
+	const double kCosStep = std::cos(_range / _steps);
+	const double kSinStep = std::sin(_range / _steps);
+
+	double c = 1.0;
+	double s = 0.0;
+	for (uint32_t i = 0; i <= _steps; i++) {
+		table[i] = glm::vec2(static_cast<float>(c), static_cast<float>(s));
+
+		const double kNextC = c * kCosStep - s * kSinStep;
+		s = s * kCosStep + c * kSinStep;
+		c = kNextC;
+	}
+
+	return;
+}
+
+static size_t GetLatheIndexCount(const LatheRow* _rows, uint32_t _rowCount, uint32_t _segments)
+{
+	size_t triangles = 0;
+	for (uint32_t row = 0; row + 1 < _rowCount; row++) {
+		// A ring that collapses to a point only needs one triangle per segment
+		triangles += (_rows[row].Radius > 0.0f ? _segments : 0) + (_rows[row + 1].Radius > 0.0f ? _segments : 0);
+	}
+
+	return triangles * 3;
+}
+
+// Sweeps the rows around the y axis, columns go from angle 0 to 2 pi with the seam duplicated
+static void GenerateLathe(const LatheRow* _rows, uint32_t _rowCount, uint32_t _segments, Vertex*& vertices, uint32_t*& indices, uint32_t& baseVertex)
+{
+	std::vector<glm::vec2> columns;
+	BuildSinCosTable(_segments, 2.0 * kPi, columns);
+	columns[_segments] = columns[0];
+
+	for (uint32_t row = 0; row < _rowCount; row++) {
+		const LatheRow& kRow = _rows[row];
+
+		for (uint32_t column = 0; column <= _segments; column++) {
+			const glm::vec2 kDirection = columns[column];
+			Vertex& vertex = *vertices++;
+
+			vertex.normal = glm::vec3(kDirection.x * kRow.NormalRadial, kRow.NormalY, kDirection.y * kRow.NormalRadial);
+			vertex.position = glm::vec3(kDirection.x * kRow.Radius, kRow.Y, kDirection.y * kRow.Radius);
+			vertex.color = vertex.normal;
+			vertex.texture_coordinate = glm::vec2(static_cast<float>(column) / _segments, kRow.V);
+		}
+	}
+
+	for (uint32_t row = 0; row + 1 < _rowCount; row++) {
+		const bool kTopOpen = _rows[row].Radius > 0.0f;
+		const bool kBottomOpen = _rows[row + 1].Radius > 0.0f;
+
+		for (uint32_t column = 0; column < _segments; column++) {
+			const uint32_t kFirst = baseVertex + row * (_segments + 1) + column;
+			const uint32_t kSecond = kFirst + _segments + 1;
+
+			if (kTopOpen) {
+				*indices++ = kFirst;
+				*indices++ = kSecond;
+				*indices++ = kFirst + 1;
+			}
+			if (kBottomOpen) {
+				*indices++ = kSecond;
+				*indices++ = kSecond + 1;
+				*indices++ = kFirst + 1;
+			}
+		}
+	}
+
+	baseVertex += _rowCount * (_segments + 1);
+
+	return;
+}
+
+// Flat grid spanning _origin + [0, 1] * _u + [0, 1] * _v, facing _normal
+static void GenerateGrid(glm::vec3 _origin, glm::vec3 _u, glm::vec3 _v, glm::vec3 _normal, uint32_t _segmentsU, uint32_t _segmentsV, Vertex*& vertices, uint32_t*& indices, uint32_t& baseVertex)
+{
+	const float kStepU = 1.0f / _segmentsU;
+	const float kStepV = 1.0f / _segmentsV;
+
+	for (uint32_t j = 0; j <= _segmentsV; j++) {
+		const float kT = j * kStepV;
+
+		for (uint32_t i = 0; i <= _segmentsU; i++) {
+			const float kS = i * kStepU;
+			Vertex& vertex = *vertices++;
+
+			vertex.position = _origin + _u * kS + _v * kT;
+			vertex.normal = _normal;
+			vertex.color = _normal;
+			vertex.texture_coordinate = glm::vec2(kS, 1.0f - kT);
+		}
+	}
+
+	for (uint32_t j = 0; j < _segmentsV; j++) {
+		for (uint32_t i = 0; i < _segmentsU; i++) {
+			const uint32_t kA = baseVertex + j * (_segmentsU + 1) + i;
+			const uint32_t kB = kA + _segmentsU + 1;
+
+			*indices++ = kA;
+			*indices++ = kB;
+			*indices++ = kB + 1;
+
+			*indices++ = kB + 1;
+			*indices++ = kA + 1;
+			*indices++ = kA;
+		}
+	}
+
+	baseVertex += (_segmentsU + 1) * (_segmentsV + 1);
+
+	return;
+}
+
+// Center plus one ring facing up or down
+static void GenerateDisc(float _radius, float _y, bool _bUp, uint32_t _segments, Vertex*& vertices, uint32_t*& indices, uint32_t& baseVertex)
+{
+	std::vector<glm::vec2> columns;
+	BuildSinCosTable(_segments, 2.0 * kPi, columns);
+
+	const glm::vec3 kNormal = glm::vec3(0.0f, _bUp ? 1.0f : -1.0f, 0.0f);
+
+	Vertex& center = *vertices++;
+	center.position = glm::vec3(0.0f, _y, 0.0f);
+	center.normal = kNormal;
+	center.color = kNormal;
+	center.texture_coordinate = glm::vec2(0.5f, 0.5f);
+
+	for (uint32_t column = 0; column < _segments; column++) {
+		Vertex& vertex = *vertices++;
+		vertex.position = glm::vec3(columns[column].x * _radius, _y, columns[column].y * _radius);
+		vertex.normal = kNormal;
+		vertex.color = kNormal;
+		vertex.texture_coordinate = glm::vec2(0.5f + columns[column].x * 0.5f, 0.5f + columns[column].y * 0.5f);
+	}
+
+	for (uint32_t column = 0; column < _segments; column++) {
+		const uint32_t kCurrent = baseVertex + 1 + column;
+		const uint32_t kNext = baseVertex + 1 + (column + 1) % _segments;
+
+		*indices++ = baseVertex;
+		*indices++ = _bUp ? kCurrent : kNext;
+		*indices++ = _bUp ? kNext : kCurrent;
+	}
+
+	baseVertex += _segments + 1;
+
+	return;
+}
+
+static void BuildSphereRows(float _radius, uint32_t _latitudeBands, std::vector<LatheRow>& rows)
+{
+	std::vector<glm::vec2> rings;
+	BuildSinCosTable(_latitudeBands, kPi, rings);
+
+	// The recurrence lands within an ulp of the pole, snap it so the last ring is exactly a point
+	rings[_latitudeBands] = glm::vec2(-1.0f, 0.0f);
+
+	rows.resize(_latitudeBands + 1);
+	for (uint32_t ring = 0; ring <= _latitudeBands; ring++) {
+		const float kCosTheta = rings[ring].x;
+		const float kSinTheta = rings[ring].y;
+
+		LatheRow row = { _radius * kSinTheta, _radius * kCosTheta, kSinTheta, kCosTheta, static_cast<float>(ring) / _latitudeBands };
+		rows[ring] = row;
+	}
+
+	return;
+}
+
+static void BuildCapsuleRows(float _radius, float _height, uint32_t _capRings, uint32_t _heightSegments, std::vector<LatheRow>& rows)
+{
+	std::vector<glm::vec2> rings;
+	BuildSinCosTable(_capRings * 2, kPi, rings);
+	rings[_capRings] = glm::vec2(0.0f, 1.0f);
+	rings[_capRings * 2] = glm::vec2(-1.0f, 0.0f);
+
+	// v follows the length of the profile so the texture doesn't stretch over the straight part
+	const float kCapLength = static_cast<float>(kPi * 0.5) * _radius;
+	const float kTotalLength = kCapLength * 2.0f + _height;
+	const float kHalfHeight = _height * 0.5f;
+
+	rows.clear();
+	rows.reserve(_capRings * 2 + _heightSegments + 1);
+
+	for (uint32_t ring = 0; ring <= _capRings; ring++) {
+		LatheRow row = { _radius * rings[ring].y, kHalfHeight + _radius * rings[ring].x, rings[ring].y, rings[ring].x,
+			(kCapLength * ring / _capRings) / kTotalLength };
+		rows.push_back(row);
+	}
+	for (uint32_t segment = 1; segment < _heightSegments; segment++) {
+		const float kT = static_cast<float>(segment) / _heightSegments;
+		LatheRow row = { _radius, kHalfHeight - _height * kT, 1.0f, 0.0f, (kCapLength + _height * kT) / kTotalLength };
+		rows.push_back(row);
+	}
+	for (uint32_t ring = _capRings; ring <= _capRings * 2; ring++) {
+		LatheRow row = { _radius * rings[ring].y, -kHalfHeight + _radius * rings[ring].x, rings[ring].y, rings[ring].x,
+			(kCapLength + _height + kCapLength * (ring - _capRings) / _capRings) / kTotalLength };
+		rows.push_back(row);
+	}
+
+	return;
+}
+
+// Public //
+
+ProceduralMeshSize ProceduralMesh::GetSphereSize(uint32_t _latitudeBands, uint32_t _longitudeBands)
+{
+	_latitudeBands = std::max(_latitudeBands, 2u);
+	_longitudeBands = std::max(_longitudeBands, kMinRadialSegments);
+
+	// Both pole bands lose their degenerate half
+	ProceduralMeshSize size;
+	size.VertexCount = (size_t)(_latitudeBands + 1) * (_longitudeBands + 1);
+	size.IndexCount = (size_t)(_latitudeBands * 2 - 2) * _longitudeBands * 3;
+
+	return size;
+}
+
+ProceduralMeshSize ProceduralMesh::GetCubeSize(uint32_t _segments)
+{
+	_segments = std::max(_segments, 1u);
+
+	ProceduralMeshSize size;
+	size.VertexCount = (size_t)6 * (_segments + 1) * (_segments + 1);
+	size.IndexCount = (size_t)6 * _segments * _segments * 6;
+
+	return size;
+}
+
+ProceduralMeshSize ProceduralMesh::GetPlaneSize(uint32_t _segmentsX, uint32_t _segmentsZ)
+{
+	_segmentsX = std::max(_segmentsX, 1u);
+	_segmentsZ = std::max(_segmentsZ, 1u);
+
+	ProceduralMeshSize size;
+	size.VertexCount = (size_t)(_segmentsX + 1) * (_segmentsZ + 1);
+	size.IndexCount = (size_t)_segmentsX * _segmentsZ * 6;
+
+	return size;
+}
+
+ProceduralMeshSize ProceduralMesh::GetCylinderSize(uint32_t _radialSegments, uint32_t _heightSegments)
+{
+	_radialSegments = std::max(_radialSegments, kMinRadialSegments);
+	_heightSegments = std::max(_heightSegments, 1u);
+
+	// Side plus two caps
+	ProceduralMeshSize size;
+	size.VertexCount = (size_t)(_heightSegments + 1) * (_radialSegments + 1) + (size_t)(_radialSegments + 1) * 2;
+	size.IndexCount = (size_t)_heightSegments * _radialSegments * 6 + (size_t)_radialSegments * 3 * 2;
+
+	return size;
+}
+
+ProceduralMeshSize ProceduralMesh::GetCapsuleSize(uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments)
+{
+	_radialSegments = std::max(_radialSegments, kMinRadialSegments);
+	_capRings = std::max(_capRings, 1u);
+	_heightSegments = std::max(_heightSegments, 1u);
+
+	const uint32_t kRows = _capRings * 2 + _heightSegments + 1;
+
+	ProceduralMeshSize size;
+	size.VertexCount = (size_t)kRows * (_radialSegments + 1);
+	size.IndexCount = (size_t)((kRows - 1) * 2 - 2) * _radialSegments * 3;
+
+	return size;
+}
+
+void ProceduralMesh::GenerateSphere(float _radius, uint32_t _latitudeBands, uint32_t _longitudeBands, Vertex* _vertices, uint32_t* _indices)
+{
+	_latitudeBands = std::max(_latitudeBands, 2u);
+	_longitudeBands = std::max(_longitudeBands, kMinRadialSegments);
+
+	std::vector<LatheRow> rows;
+	BuildSphereRows(_radius, _latitudeBands, rows);
+
+	uint32_t baseVertex = 0;
+	GenerateLathe(&rows[0], static_cast<uint32_t>(rows.size()), _longitudeBands, _vertices, _indices, baseVertex);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCube(float _halfExtent, uint32_t _segments, Vertex* _vertices, uint32_t* _indices)
+{
+	_segments = std::max(_segments, 1u);
+
+	// Each face spans origin + u + v with u x v pointing along the face normal
+	const glm::vec3 kNormals[6] = {
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+	const glm::vec3 kUs[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)
+	};
+
+	uint32_t baseVertex = 0;
+	for (int face = 0; face < 6; face++) {
+		const glm::vec3 kV = glm::cross(kNormals[face], kUs[face]);
+		const glm::vec3 kOrigin = (kNormals[face] - kUs[face] - kV) * _halfExtent;
+
+		GenerateGrid(kOrigin, kUs[face] * (_halfExtent * 2.0f), kV * (_halfExtent * 2.0f), kNormals[face], _segments, _segments, _vertices, _indices, baseVertex);
+	}
+
+	return;
+}
+
+void ProceduralMesh::GeneratePlane(float _width, float _depth, uint32_t _segmentsX, uint32_t _segmentsZ, Vertex* _vertices, uint32_t* _indices)
+{
+	_segmentsX = std::max(_segmentsX, 1u);
+	_segmentsZ = std::max(_segmentsZ, 1u);
+
+	// Lies on y = 0 facing up, centered on the origin
+	const glm::vec3 kOrigin = glm::vec3(-_width * 0.5f, 0.0f, _depth * 0.5f);
+
+	uint32_t baseVertex = 0;
+	GenerateGrid(kOrigin, glm::vec3(_width, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -_depth), glm::vec3(0.0f, 1.0f, 0.0f), _segmentsX, _segmentsZ, _vertices, _indices, baseVertex);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCylinder(float _radius, float _height, uint32_t _radialSegments, uint32_t _heightSegments, Vertex* _vertices, uint32_t* _indices)
+{
+	_radialSegments = std::max(_radialSegments, kMinRadialSegments);
+	_heightSegments = std::max(_heightSegments, 1u);
+
+	std::vector<LatheRow> rows(_heightSegments + 1);
+	for (uint32_t segment = 0; segment <= _heightSegments; segment++) {
+		const float kT = static_cast<float>(segment) / _heightSegments;
+		LatheRow row = { _radius, _height * (0.5f - kT), 1.0f, 0.0f, kT };
+		rows[segment] = row;
+	}
+
+	uint32_t baseVertex = 0;
+	GenerateLathe(&rows[0], static_cast<uint32_t>(rows.size()), _radialSegments, _vertices, _indices, baseVertex);
+	GenerateDisc(_radius, _height * 0.5f, true, _radialSegments, _vertices, _indices, baseVertex);
+	GenerateDisc(_radius, -_height * 0.5f, false, _radialSegments, _vertices, _indices, baseVertex);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCapsule(float _radius, float _height, uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments, Vertex* _vertices, uint32_t* _indices)
+{
+	_radialSegments = std::max(_radialSegments, kMinRadialSegments);
+	_capRings = std::max(_capRings, 1u);
+	_heightSegments = std::max(_heightSegments, 1u);
+
+	std::vector<LatheRow> rows;
+	BuildCapsuleRows(_radius, _height, _capRings, _heightSegments, rows);
+
+	uint32_t baseVertex = 0;
+	GenerateLathe(&rows[0], static_cast<uint32_t>(rows.size()), _radialSegments, _vertices, _indices, baseVertex);
+
+	return;
+}
+
+void ProceduralMesh::GenerateSphere(float _radius, uint32_t _latitudeBands, uint32_t _longitudeBands, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const ProceduralMeshSize kSize = GetSphereSize(_latitudeBands, _longitudeBands);
+	vertices.resize(kSize.VertexCount);
+	indices.resize(kSize.IndexCount);
+
+	GenerateSphere(_radius, _latitudeBands, _longitudeBands, &vertices[0], &indices[0]);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCube(float _halfExtent, uint32_t _segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const ProceduralMeshSize kSize = GetCubeSize(_segments);
+	vertices.resize(kSize.VertexCount);
+	indices.resize(kSize.IndexCount);
+
+	GenerateCube(_halfExtent, _segments, &vertices[0], &indices[0]);
+
+	return;
+}
+
+void ProceduralMesh::GeneratePlane(float _width, float _depth, uint32_t _segmentsX, uint32_t _segmentsZ, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const ProceduralMeshSize kSize = GetPlaneSize(_segmentsX, _segmentsZ);
+	vertices.resize(kSize.VertexCount);
+	indices.resize(kSize.IndexCount);
+
+	GeneratePlane(_width, _depth, _segmentsX, _segmentsZ, &vertices[0], &indices[0]);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCylinder(float _radius, float _height, uint32_t _radialSegments, uint32_t _heightSegments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const ProceduralMeshSize kSize = GetCylinderSize(_radialSegments, _heightSegments);
+	vertices.resize(kSize.VertexCount);
+	indices.resize(kSize.IndexCount);
+
+	GenerateCylinder(_radius, _height, _radialSegments, _heightSegments, &vertices[0], &indices[0]);
+
+	return;
+}
+
+void ProceduralMesh::GenerateCapsule(float _radius, float _height, uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const ProceduralMeshSize kSize = GetCapsuleSize(_radialSegments, _capRings, _heightSegments);
+	vertices.resize(kSize.VertexCount);
+	indices.resize(kSize.IndexCount);
+
+	GenerateCapsule(_radius, _height, _radialSegments, _capRings, _heightSegments, &vertices[0], &indices[0]);
+
+	return;
+}
+
+void ProceduralMesh::Benchmark(size_t _vertexCount, int _iterations)
+{
+	// Square-ish tessellations that land near the requested vertex count
+	const uint32_t kBands = static_cast<uint32_t>(std::sqrt((double)_vertexCount));
+	const uint32_t kFaceBands = static_cast<uint32_t>(std::sqrt(_vertexCount / 6.0));
+
+	const char* kNames[5] = { "sphere", "cube", "plane", "cylinder", "capsule" };
+	const ProceduralMeshSize kSizes[5] = {
+		GetSphereSize(kBands, kBands),
+		GetCubeSize(kFaceBands),
+		GetPlaneSize(kBands, kBands),
+		GetCylinderSize(kBands, kBands),
+		GetCapsuleSize(kBands, kBands / 4, kBands / 2)
+	};
+
+	for (int shape = 0; shape < 5; shape++) {
+		// Allocated once outside the timed loop, the generators only write
+		std::vector<Vertex> vertices(kSizes[shape].VertexCount);
+		std::vector<uint32_t> indices(kSizes[shape].IndexCount);
+
+		double bestSeconds = 0.0;
+		for (int iteration = 0; iteration < _iterations; iteration++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			switch (shape) {
+			case 0:
+				GenerateSphere(1.0f, kBands, kBands, &vertices[0], &indices[0]);
+				break;
+			case 1:
+				GenerateCube(1.0f, kFaceBands, &vertices[0], &indices[0]);
+				break;
+			case 2:
+				GeneratePlane(2.0f, 2.0f, kBands, kBands, &vertices[0], &indices[0]);
+				break;
+			case 3:
+				GenerateCylinder(1.0f, 2.0f, kBands, kBands, &vertices[0], &indices[0]);
+				break;
+			case 4:
+				GenerateCapsule(0.5f, 1.0f, kBands, kBands / 4, kBands / 2, &vertices[0], &indices[0]);
+				break;
+			}
+
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+			const double kSeconds = std::chrono::duration<double>(end - start).count();
+			if (iteration == 0 || kSeconds < bestSeconds) {
+				bestSeconds = kSeconds;
+			}
+		}
+
+		std::cout << "Procedural Mesh : " << kNames[shape]
+			<< " " << kSizes[shape].VertexCount << " vertices, " << kSizes[shape].IndexCount / 3 << " triangles in "
+			<< bestSeconds * 1000.0 << " ms, " << (kSizes[shape].VertexCount / bestSeconds) / 1000000.0 << " M vertices/s" << std::endl;
+	}
+
+	return;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+
+#include "Mesh.h"
+
+// Vertex and index counts a shape will write, so callers can size their buffers up front
+struct ProceduralMeshSize
+{
+	size_t	VertexCount;
+	size_t	IndexCount;
+};
+
+// Tessellated primitives written straight into caller owned memory. Trig is evaluated once per ring
+// and once per column with a rotation recurrence, never per vertex. Triangles are wound like the
+// built-in meshes and rings close exactly, the last column repeats the first with u = 1.
+class ProceduralMesh
+{
+public:
+	static ProceduralMeshSize GetSphereSize(uint32_t _latitudeBands, uint32_t _longitudeBands);
+	static ProceduralMeshSize GetCubeSize(uint32_t _segments);
+	static ProceduralMeshSize GetPlaneSize(uint32_t _segmentsX, uint32_t _segmentsZ);
+	static ProceduralMeshSize GetCylinderSize(uint32_t _radialSegments, uint32_t _heightSegments);
+	static ProceduralMeshSize GetCapsuleSize(uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments);
+
+	// _vertices and _indices must hold at least the matching Get*Size counts. Counts too small to make a
+	// shape are raised to the minimum, 2 latitude bands, 3 segments around a ring and 1 for the rest.
+	static void GenerateSphere(float _radius, uint32_t _latitudeBands, uint32_t _longitudeBands, Vertex* _vertices, uint32_t* _indices);
+	static void GenerateCube(float _halfExtent, uint32_t _segments, Vertex* _vertices, uint32_t* _indices);
+	static void GeneratePlane(float _width, float _depth, uint32_t _segmentsX, uint32_t _segmentsZ, Vertex* _vertices, uint32_t* _indices);
+	static void GenerateCylinder(float _radius, float _height, uint32_t _radialSegments, uint32_t _heightSegments, Vertex* _vertices, uint32_t* _indices);
+	static void GenerateCapsule(float _radius, float _height, uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments, Vertex* _vertices, uint32_t* _indices);
+
+	// Vector versions size the outputs once and fill them in place
+	static void GenerateSphere(float _radius, uint32_t _latitudeBands, uint32_t _longitudeBands, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	static void GenerateCube(float _halfExtent, uint32_t _segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	static void GeneratePlane(float _width, float _depth, uint32_t _segmentsX, uint32_t _segmentsZ, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	static void GenerateCylinder(float _radius, float _height, uint32_t _radialSegments, uint32_t _heightSegments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	static void GenerateCapsule(float _radius, float _height, uint32_t _radialSegments, uint32_t _capRings, uint32_t _heightSegments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Generates every shape at about _vertexCount vertices and prints time and throughput
+	static void Benchmark(size_t _vertexCount, int _iterations);
+};
@@ -0,0 +1,607 @@
+#include "Profiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+const uint32_t Profiler::kGpuThread = 0;
+const size_t Profiler::kHistoryFrames = 240;
+
+uint64_t Profiler::frame = 0;
+
+// Zones a thread can close between two EndFrame calls, a power of two so the indices can wrap
+static const uint32_t kThreadCapacity = 16384;
+// A capture stops growing here, around 40 MB of JSON
+static const size_t kMaxCaptureEvents = 1 << 20;
+// Frames a GPU query gets to finish before it is given up on
+static const uint64_t kGpuMaxLatency = 8;
+static const size_t kNoQuery = static_cast<size_t>(-1);
+// Per thread per frame in Benchmark, below kThreadCapacity so nothing is dropped
+static const int kBenchmarkZones = 10000;
+
+static const std::chrono::steady_clock::time_point kStartTime = std::chrono::steady_clock::now();
+
+// Written only by the thread holding it and read only by EndFrame. Threads that exit hand their ring
+// back and the next new thread takes it over, so short lived workers don't pile up rings or trace rows.
+struct ThreadBuffer
+{
+	ProfileEvent			Events[kThreadCapacity];
+	std::atomic<uint32_t>	Written;
+	std::atomic<uint32_t>	Read;
+	std::atomic<uint32_t>	Dropped;
+	std::atomic<bool>		bInUse;
+	uint32_t				Thread;
+	std::string				Name;		// guarded by threadBuffersMutex
+};
+
+struct ThreadBufferOwner
+{
+	ThreadBuffer*	Buffer;
+
+	~ThreadBufferOwner()
+	{
+		if (Buffer) {
+			Buffer->bInUse.store(false, std::memory_order_release);
+		}
+	}
+};
+
+struct GpuQuery
+{
+	const char*	Name;
+	GLuint		Begin;
+	GLuint		End;
+	uint64_t	Frame;
+};
+
+struct ZoneHistory
+{
+	std::string				Name;
+	bool					bGpu;
+	std::vector<float>		Ms;				// one sample per frame the zone ran in
+	std::vector<uint32_t>	Calls;
+	size_t					Next;			// oldest sample once the window is full
+	float					LastMs;
+	uint64_t				Frame;			// frame being summed
+	double					FrameMs;
+	uint32_t				FrameCalls;
+};
+
+static std::mutex threadBuffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+static thread_local ThreadBufferOwner threadBufferOwner = { nullptr };
+static uint64_t droppedEvents = 0;
+
+static bool bGpuEnabled = false;
+static std::vector<GpuQuery> gpuQueries;
+static std::vector<GLuint> freeQueries;
+// CPU time minus GPU time, only refreshed when a capture starts since reading the GPU clock can flush
+static int64_t gpuClockOffset = 0;
+
+static std::map<std::pair<bool, std::string>, ZoneHistory> zoneHistories;
+// Zone names are literals, so lookups by pointer skip building a string for every event
+static std::unordered_map<const char*, ZoneHistory*> zonesByName[2];
+
+static bool bCapturing = false;
+static std::vector<ProfileEvent> capture;
+
+static ThreadBuffer* getThreadBuffer()
+{
+	if (threadBufferOwner.Buffer) {
+		return threadBufferOwner.Buffer;
+	}
+
+	std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+	ThreadBuffer* buffer = nullptr;
+	for (size_t i = 0; i < threadBuffers.size() && !buffer; i++) {
+		bool bInUse = false;
+		if (threadBuffers[i]->bInUse.compare_exchange_strong(bInUse, true, std::memory_order_acquire)) {
+			buffer = threadBuffers[i].get();
+		}
+	}
+
+	if (!buffer) {
+		threadBuffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		buffer = threadBuffers.back().get();
+		buffer->Written.store(0);
+		buffer->Read.store(0);
+		buffer->Dropped.store(0);
+		buffer->bInUse.store(true);
+		// 0 is the GPU row
+		buffer->Thread = static_cast<uint32_t>(threadBuffers.size());
+	}
+	buffer->Name = "Thread " + std::to_string(buffer->Thread);
+
+	threadBufferOwner.Buffer = buffer;
+
+	return buffer;
+}
+
+static ZoneHistory& FindHistory(const char* _name, bool _bGpu)
+{
+	std::unordered_map<const char*, ZoneHistory*>& zones = zonesByName[_bGpu ? 1 : 0];
+	std::unordered_map<const char*, ZoneHistory*>::iterator found = zones.find(_name);
+	if (found != zones.end()) {
+		return *found->second;
+	}
+
+	// The same name from another translation unit can be another pointer, it still shares the history
+	ZoneHistory& history = zoneHistories[std::make_pair(_bGpu, std::string(_name))];
+	if (history.Name.empty()) {
+		history.Name = _name;
+		history.bGpu = _bGpu;
+		history.Next = 0;
+		history.LastMs = 0.0f;
+		history.Frame = 0;
+		history.FrameMs = 0.0;
+		history.FrameCalls = 0;
+	}
+	zones[_name] = &history;
+
+	return history;
+}
+
+static void FlushHistory(ZoneHistory& _history)
+{
+	if (_history.FrameCalls == 0) {
+		return;
+	}
+
+	const float kMs = static_cast<float>(_history.FrameMs);
+	if (_history.Ms.size() < Profiler::kHistoryFrames) {
+		_history.Ms.push_back(kMs);
+		_history.Calls.push_back(_history.FrameCalls);
+	}
+	else {
+		_history.Ms[_history.Next] = kMs;
+		_history.Calls[_history.Next] = _history.FrameCalls;
+		_history.Next = (_history.Next + 1) % Profiler::kHistoryFrames;
+	}
+	_history.LastMs = kMs;
+	_history.FrameMs = 0.0;
+	_history.FrameCalls = 0;
+
+	return;
+}
+
+static void Collect(const ProfileEvent& _event, bool _bGpu, uint64_t _frame)
+{
+	ZoneHistory& history = FindHistory(_event.Name, _bGpu);
+	if (history.FrameCalls > 0 && history.Frame != _frame) {
+		FlushHistory(history);
+	}
+	history.Frame = _frame;
+	history.FrameMs += (_event.End - _event.Start) / 1000000.0;
+	history.FrameCalls++;
+
+	if (bCapturing && capture.size() < kMaxCaptureEvents) {
+		capture.push_back(_event);
+	}
+
+	return;
+}
+
+// Nearest rank of a sorted window
+static float getPercentile(const std::vector<float>& _sorted, float _percentile)
+{
+	size_t rank = static_cast<size_t>(std::ceil(_percentile * _sorted.size()));
+	rank = std::min(std::max<size_t>(rank, 1), _sorted.size());
+
+	return _sorted[rank - 1];
+}
+
+static void WriteJsonString(std::ostream& _stream, const std::string& _text)
+{
+	_stream << '"';
+	for (size_t i = 0; i < _text.size(); i++) {
+		const char kChar = _text[i];
+		if (kChar == '"' || kChar == '\\') {
+			_stream << '\\' << kChar;
+		}
+		else if (static_cast<unsigned char>(kChar) < 0x20) {
+			_stream << ' ';
+		}
+		else {
+			_stream << kChar;
+		}
+	}
+	_stream << '"';
+
+	return;
+}
+
+// Public //
+
+Profiler::Zone::Zone(const char* _name)
+{
+	this->name = _name;
+	this->start = getTime();
+	return;
+}
+
+Profiler::Zone::~Zone()
+{
+	Record(name, start, getTime());
+	return;
+}
+
+Profiler::GpuZone::GpuZone(const char* _name)
+{
+	this->query = BeginGpuQuery(_name);
+	return;
+}
+
+Profiler::GpuZone::~GpuZone()
+{
+	EndGpuQuery(query);
+	return;
+}
+
+void Profiler::setThreadName(const std::string& _name)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(threadBuffersMutex);
+	buffer->Name = _name;
+
+	return;
+}
+
+bool Profiler::InitGpu()
+{
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_timer_query) {
+		std::cout << "Profiler : No timer queries, GPU zones are off" << std::endl;
+		return false;
+	}
+
+	bGpuEnabled = true;
+	UpdateGpuClock();
+
+	return true;
+}
+
+void Profiler::ShutdownGpu()
+{
+	for (size_t i = 0; i < gpuQueries.size(); i++) {
+		freeQueries.push_back(gpuQueries[i].Begin);
+		freeQueries.push_back(gpuQueries[i].End);
+	}
+	gpuQueries.clear();
+
+	if (!freeQueries.empty()) {
+		glDeleteQueries(static_cast<GLsizei>(freeQueries.size()), &freeQueries[0]);
+		freeQueries.clear();
+	}
+	bGpuEnabled = false;
+
+	return;
+}
+
+void Profiler::EndFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+		for (size_t i = 0; i < threadBuffers.size(); i++) {
+			ThreadBuffer& buffer = *threadBuffers[i];
+			const uint32_t kRead = buffer.Read.load(std::memory_order_relaxed);
+			const uint32_t kWritten = buffer.Written.load(std::memory_order_acquire);
+			for (uint32_t index = kRead; index != kWritten; index++) {
+				Collect(buffer.Events[index % kThreadCapacity], false, frame);
+			}
+			buffer.Read.store(kWritten, std::memory_order_release);
+			droppedEvents += buffer.Dropped.exchange(0, std::memory_order_relaxed);
+		}
+	}
+
+	if (bGpuEnabled) {
+		ReadGpuQueries();
+	}
+
+	// A GPU frame is only complete once none of its queries are still out
+	const uint64_t kGpuFrame = gpuQueries.empty() ? frame + 1 : gpuQueries.front().Frame;
+	for (std::map<std::pair<bool, std::string>, ZoneHistory>::iterator it = zoneHistories.begin(); it != zoneHistories.end(); ++it) {
+		if (!it->second.bGpu || it->second.Frame < kGpuFrame) {
+			FlushHistory(it->second);
+		}
+	}
+
+	frame++;
+
+	return;
+}
+
+void Profiler::BeginCapture()
+{
+	capture.clear();
+	bCapturing = true;
+	if (bGpuEnabled) {
+		UpdateGpuClock();
+	}
+
+	return;
+}
+
+bool Profiler::EndCapture(const std::string& _fileName)
+{
+	bCapturing = false;
+
+	std::ofstream file(_fileName, std::ios::out | std::ios::trunc);
+	if (!file.good()) {
+		std::cout << "Profiler : Can't write " << _fileName << std::endl;
+		return false;
+	}
+
+	std::vector<std::pair<uint32_t, std::string>> threads;
+	threads.push_back(std::make_pair(kGpuThread, std::string("GPU")));
+	{
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+		for (size_t i = 0; i < threadBuffers.size(); i++) {
+			threads.push_back(std::make_pair(threadBuffers[i]->Thread, threadBuffers[i]->Name));
+		}
+	}
+
+	std::stable_sort(capture.begin(), capture.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+		return a.Start < b.Start;
+	});
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"OpenGLProject\"}}";
+	for (size_t i = 0; i < threads.size(); i++) {
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threads[i].first << ",\"args\":{\"name\":";
+		WriteJsonString(file, threads[i].second);
+		file << "}}";
+		// Main thread rows above workers, GPU last
+		file << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threads[i].first
+			<< ",\"args\":{\"sort_index\":" << (threads[i].first == kGpuThread ? 1000 : threads[i].first) << "}}";
+	}
+	for (size_t i = 0; i < capture.size(); i++) {
+		const ProfileEvent& kEvent = capture[i];
+		file << ",\n{\"name\":";
+		WriteJsonString(file, kEvent.Name);
+		file << ",\"cat\":\"" << (kEvent.Thread == kGpuThread ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << kEvent.Thread
+			<< ",\"ts\":" << kEvent.Start / 1000.0 << ",\"dur\":" << (kEvent.End - kEvent.Start) / 1000.0 << "}";
+	}
+	file << "\n]}\n";
+
+	std::cout << "Profiler : Wrote " << capture.size() << " zones to " << _fileName << std::endl;
+	capture.clear();
+
+	return file.good();
+}
+
+bool Profiler::isCapturing()
+{
+	return bCapturing;
+}
+
+std::vector<ProfileZoneStats> Profiler::getStatistics()
+{
+	std::vector<ProfileZoneStats> statistics;
+	std::vector<float> sorted;
+
+	// The map is ordered by (bGpu, name) already
+	for (std::map<std::pair<bool, std::string>, ZoneHistory>::const_iterator it = zoneHistories.begin(); it != zoneHistories.end(); ++it) {
+		const ZoneHistory& kHistory = it->second;
+		if (kHistory.Ms.empty()) {
+			continue;
+		}
+
+		sorted = kHistory.Ms;
+		std::sort(sorted.begin(), sorted.end());
+
+		double totalMs = 0.0;
+		uint64_t totalCalls = 0;
+		for (size_t i = 0; i < sorted.size(); i++) {
+			totalMs += sorted[i];
+			totalCalls += kHistory.Calls[i];
+		}
+
+		ProfileZoneStats stats;
+		stats.Name = kHistory.Name;
+		stats.bGpu = kHistory.bGpu;
+		stats.Frames = static_cast<uint32_t>(sorted.size());
+		stats.CallsPerFrame = static_cast<float>(totalCalls) / sorted.size();
+		stats.LastMs = kHistory.LastMs;
+		stats.MeanMs = static_cast<float>(totalMs / sorted.size());
+		stats.P50Ms = getPercentile(sorted, 0.50f);
+		stats.P95Ms = getPercentile(sorted, 0.95f);
+		stats.P99Ms = getPercentile(sorted, 0.99f);
+		stats.MaxMs = sorted.back();
+		statistics.push_back(stats);
+	}
+
+	return statistics;
+}
+
+void Profiler::PrintStatistics()
+{
+	const std::vector<ProfileZoneStats> kStatistics = getStatistics();
+
+	std::cout << "Profiler : last " << kHistoryFrames << " frames, ms per frame" << std::endl;
+	std::cout << std::left << std::setw(28) << "zone" << std::right
+		<< std::setw(8) << "calls" << std::setw(9) << "last" << std::setw(9) << "mean"
+		<< std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < kStatistics.size(); i++) {
+		const ProfileZoneStats& kStats = kStatistics[i];
+		std::cout << std::left << std::setw(28) << ((kStats.bGpu ? "GPU " : "") + kStats.Name) << std::right
+			<< std::setw(8) << std::setprecision(1) << kStats.CallsPerFrame << std::setprecision(3)
+			<< std::setw(9) << kStats.LastMs << std::setw(9) << kStats.MeanMs
+			<< std::setw(9) << kStats.P50Ms << std::setw(9) << kStats.P95Ms << std::setw(9) << kStats.P99Ms
+			<< std::setw(9) << kStats.MaxMs << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+
+	if (droppedEvents > 0) {
+		std::cout << "Profiler : " << droppedEvents << " zones dropped, a thread filled its buffer within a frame" << std::endl;
+	}
+
+	return;
+}
+
+int64_t Profiler::getTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kStartTime).count();
+}
+
+void Profiler::Benchmark(int _iterations)
+{
+	const int kFrames = 20;
+	const unsigned int kCores = std::max(1u, std::thread::hardware_concurrency());
+	const unsigned int kThreadCounts[2] = { 1, kCores };
+
+	for (int run = 0; run < 2; run++) {
+		const unsigned int kThreads = kThreadCounts[run];
+		double bestMs = 1e30;
+
+		for (int iteration = 0; iteration < _iterations; iteration++) {
+			const std::chrono::high_resolution_clock::time_point kStart = std::chrono::high_resolution_clock::now();
+
+			for (int f = 0; f < kFrames; f++) {
+				std::vector<std::thread> threads;
+				for (unsigned int i = 1; i < kThreads; i++) {
+					threads.push_back(std::thread([]() {
+						for (int zone = 0; zone < kBenchmarkZones; zone++) {
+							Zone benchmarkZone("Benchmark");
+						}
+					}));
+				}
+				for (int zone = 0; zone < kBenchmarkZones; zone++) {
+					Zone benchmarkZone("Benchmark");
+				}
+				for (size_t i = 0; i < threads.size(); i++) {
+					threads[i].join();
+				}
+
+				EndFrame();
+			}
+
+			const double kMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - kStart).count();
+			bestMs = std::min(bestMs, kMs);
+		}
+
+		std::cout << "Profiler : " << kThreads << " threads, " << kFrames * kBenchmarkZones << " zones per thread"
+			<< " | best " << bestMs << " ms, " << bestMs * 1000000.0 / (kFrames * kBenchmarkZones) << " ns per zone" << std::endl;
+	}
+
+	PrintStatistics();
+
+	return;
+}
+
+// Private //
+
+void Profiler::Record(const char* _name, int64_t _start, int64_t _end)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	const uint32_t kWritten = buffer->Written.load(std::memory_order_relaxed);
+	if (kWritten - buffer->Read.load(std::memory_order_acquire) >= kThreadCapacity) {
+		buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ProfileEvent& event = buffer->Events[kWritten % kThreadCapacity];
+	event.Name = _name;
+	event.Start = _start;
+	event.End = _end;
+	event.Thread = buffer->Thread;
+	buffer->Written.store(kWritten + 1, std::memory_order_release);
+
+	return;
+}
+
+size_t Profiler::BeginGpuQuery(const char* _name)
+{
+	if (!bGpuEnabled) {
+		return kNoQuery;
+	}
+
+	if (freeQueries.size() < 2) {
+		GLuint queries[16];
+		glGenQueries(16, queries);
+		freeQueries.insert(freeQueries.end(), queries, queries + 16);
+	}
+
+	GpuQuery query;
+	query.Name = _name;
+	query.End = freeQueries.back();
+	freeQueries.pop_back();
+	query.Begin = freeQueries.back();
+	freeQueries.pop_back();
+	query.Frame = frame;
+
+	// Timestamps rather than GL_TIME_ELAPSED, elapsed queries can't nest
+	glQueryCounter(query.Begin, GL_TIMESTAMP);
+	gpuQueries.push_back(query);
+
+	return gpuQueries.size() - 1;
+}
+
+void Profiler::EndGpuQuery(size_t _query)
+{
+	if (_query == kNoQuery || !bGpuEnabled) {
+		return;
+	}
+
+	glQueryCounter(gpuQueries[_query].End, GL_TIMESTAMP);
+
+	return;
+}
+
+void Profiler::ReadGpuQueries()
+{
+	// Timestamps finish in the order they were issued, so stop at the first one that isn't there yet
+	size_t done = 0;
+	for (; done < gpuQueries.size(); done++) {
+		const GpuQuery& kQuery = gpuQueries[done];
+
+		GLint available = 0;
+		glGetQueryObjectiv(kQuery.End, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available && frame - kQuery.Frame < kGpuMaxLatency) {
+			break;
+		}
+
+		if (available) {
+			GLuint64 begin = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(kQuery.Begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(kQuery.End, GL_QUERY_RESULT, &end);
+
+			ProfileEvent event;
+			event.Name = kQuery.Name;
+			event.Start = static_cast<int64_t>(begin) + gpuClockOffset;
+			event.End = static_cast<int64_t>(end) + gpuClockOffset;
+			event.Thread = kGpuThread;
+			Collect(event, true, kQuery.Frame);
+		}
+
+		freeQueries.push_back(kQuery.Begin);
+		freeQueries.push_back(kQuery.End);
+	}
+	gpuQueries.erase(gpuQueries.begin(), gpuQueries.begin() + done);
+
+	return;
+}
+
+void Profiler::UpdateGpuClock()
+{
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	gpuClockOffset = getTime() - gpuTime;
+
+	return;
+}
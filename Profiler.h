@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// A closed zone, times are nanoseconds from Profiler::getTime
+struct ProfileEvent
+{
+	const char*	Name;
+	int64_t		Start;
+	int64_t		End;
+	uint32_t	Thread;		// Profiler::kGpuThread for GPU zones
+};
+
+// A zone that runs several times a frame is summed, so the times are what it cost per frame
+struct ProfileZoneStats
+{
+	std::string	Name;
+	bool		bGpu;
+	uint32_t	Frames;			// frames in the window the zone ran in
+	float		CallsPerFrame;
+	float		LastMs;
+	float		MeanMs;
+	float		P50Ms;
+	float		P95Ms;
+	float		P99Ms;
+	float		MaxMs;
+};
+
+// Scoped timings of the hot paths. A CPU zone lands in a ring owned by the thread that closed it, so
+// recording takes no lock, and EndFrame drains every ring into rolling per-zone statistics and, while a
+// capture runs, into a Chrome trace. GPU zones put timestamp queries around the GL work they cover and are
+// read back once the results are there, a few frames later, so they never wait on the GPU.
+class Profiler
+{
+public:
+	// Times until it goes away, zones nest. _name has to outlive the profiler, use string literals.
+	class Zone
+	{
+	public:
+		Zone(const char* _name);
+		~Zone();
+
+	private:
+		const char* name;
+		int64_t start;
+	};
+
+	// Times the GL commands issued until it goes away. Main thread only, does nothing before InitGpu.
+	class GpuZone
+	{
+	public:
+		GpuZone(const char* _name);
+		~GpuZone();
+
+	private:
+		size_t query;
+	};
+
+	// Row name of the calling thread in traces
+	static void setThreadName(const std::string& _name);
+
+	// Needs a current context, false when the driver has no timestamp queries
+	static bool InitGpu();
+	// Deletes the queries, call while the context is still alive
+	static void ShutdownGpu();
+
+	// Main thread, once per frame after the frame's zones have closed
+	static void EndFrame();
+
+	static void BeginCapture();
+	// Writes everything since BeginCapture as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev
+	static bool EndCapture(const std::string& _fileName);
+	static bool isCapturing();
+
+	// Over the last kHistoryFrames frames, CPU zones first then by name
+	static std::vector<ProfileZoneStats> getStatistics();
+	static void PrintStatistics();
+
+	// Nanoseconds since the program started
+	static int64_t getTime();
+
+	// Cost of opening and closing a zone on one thread and on every core, EndFrame included
+	static void Benchmark(int _iterations);
+
+	static const uint32_t kGpuThread;
+	static const size_t kHistoryFrames;
+
+private:
+	static uint64_t frame;
+
+	static void Record(const char* _name, int64_t _start, int64_t _end);
+	static size_t BeginGpuQuery(const char* _name);
+	static void EndGpuQuery(size_t _query);
+	static void ReadGpuQueries();
+	static void UpdateGpuClock();
+};
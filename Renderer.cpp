@@ -1,5 +1,13 @@
 #include "Renderer.h"
 
+#include "Profiler.h"
+
+#include "GLCallStats.h"
+
+static const GLuint kModelUniform = CommandBuffer::getUniformId("model");
+static const GLuint kViewUniform = CommandBuffer::getUniformId("view");
+static const GLuint kProjectionUniform = CommandBuffer::getUniformId("projection");
+
 Renderer::Renderer(MeshType _meshType, Camera* _camera)
 {
 	this->camera = _camera;
@@ -7,8 +15,8 @@ Renderer::Renderer(MeshType _meshType, Camera* _camera)
 
 	this->ebo = 0;
 	this->vbo = 0;
-	this->vao = 0;
 	this->program = 0;
+	this->indexType = GL_UNSIGNED_INT;
 
 	HandleMeshType(_meshType);
 	HandleGLSetup();
@@ -23,15 +31,26 @@ Renderer::~Renderer()
 
 void Renderer::Draw()
 {
-	glUseProgram(program);
+	Profiler::Zone zone("Renderer::Draw");
+
+	drawCommands.Clear();
+	Record(drawCommands);
+
+	drawExecutor.ResetStats();
+	drawExecutor.Execute(drawCommands);
+
+	return;
+}
 
-	SetupModelViewProjectionMatrix();
+void Renderer::Record(CommandBuffer& commands)
+{
+	commands.BindProgram(program);
 
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	RecordModelViewProjectionMatrix(commands);
 
-	glBindVertexArray(0);
-	glUseProgram(0);
+	// The vao is shared with every other colored mesh, only the buffers change
+	commands.BindVertexBuffers(kColoredVertexLayout, vbo, ebo);
+	commands.Draw(indexType, static_cast<GLsizei>(indices.size()), 0, 0);
 
 	return;
 }
@@ -53,19 +72,11 @@ glm::vec3 Renderer::getPosition() const
 
 // Protected //
 
-void Renderer::SetupModelViewProjectionMatrix()
+void Renderer::RecordModelViewProjectionMatrix(CommandBuffer& commands) const
 {
-	const glm::mat4 kModel = glm::translate(glm::mat4(1.0), position);
-	GLint modelLoc = glGetUniformLocation(program, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(kModel));
-
-	const glm::mat4 kView = camera->GetViewMatrix();
-	GLint vLoc = glGetUniformLocation(program, "view");
-	glUniformMatrix4fv(vLoc, 1, GL_FALSE, glm::value_ptr(kView));
-
-	const glm::mat4 kProj = camera->GetProjectionMatrix();
-	GLint pLoc = glGetUniformLocation(program, "projection");
-	glUniformMatrix4fv(pLoc, 1, GL_FALSE, glm::value_ptr(kProj));
+	commands.SetConstant(kModelUniform, glm::translate(glm::mat4(1.0), position));
+	commands.SetConstant(kViewUniform, camera->GetViewMatrix());
+	commands.SetConstant(kProjectionUniform, camera->GetProjectionMatrix());
 }
 
 // Private //
@@ -91,22 +102,15 @@ void Renderer::HandleMeshType(MeshType _meshType)
 void Renderer::HandleGLSetup()
 {
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
 	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	VertexArrayCache::Bind(kColoredVertexLayout, vbo, ebo);
+
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, Vertex::color)));
-
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+	indexType = IndexBuffer::SelectType(vertices.size());
+	IndexBuffer::Upload(indexType, &indices[0], indices.size(), GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
 }
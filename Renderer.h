@@ -8,6 +8,9 @@
 
 #include "Mesh.h"
 #include "Camera.h"
+#include "IndexBuffer.h"
+#include "VertexLayout.h"
+#include "CommandBuffer.h"
 
 class Renderer
 {
@@ -15,8 +18,10 @@ public:
 	Renderer(MeshType _meshType, Camera* _camera);
 	~Renderer();
 
+	// Records the draw and replays it straight away
 	virtual void Draw();
-
+	// Appends the draw without touching GL
+	virtual void Record(CommandBuffer& commands);
 
 	virtual void setPosition(glm::vec3 _position);
 	virtual void setProgram(GLuint _program);
@@ -26,17 +31,20 @@ public:
 protected:
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
+	GLenum indexType;
 
 	glm::vec3 position;
 
 	GLuint vbo; // Vertex Buffer Object
 	GLuint ebo; // Element Buffer Object;
-	GLuint vao; // Vertex Array Object
 	GLuint program;
 
 	Camera* camera;
 
-	virtual void SetupModelViewProjectionMatrix();
+	CommandBuffer drawCommands;	// reused by Draw
+	GLCommandExecutor drawExecutor;
+
+	virtual void RecordModelViewProjectionMatrix(CommandBuffer& commands) const;
 
 private:
 	void HandleMeshType(MeshType _meshType);
@@ -3,78 +3,198 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+#include "ShaderPreprocessor.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Linked programs are kept here between launches
+static const char* kProgramCacheDirectory = "Assets/ShaderCache";
+
+// Define names of the ShaderFeature bits, in bit order
+static const char* kShaderFeatureDefines[] = { "FEATURE_SPECULAR", "FEATURE_TEXTURE", "FEATURE_INSTANCING", "FEATURE_CLUSTERED" };
+static const GLuint kShaderFeatureCount = sizeof(kShaderFeatureDefines) / sizeof(kShaderFeatureDefines[0]);
+
+static const uint64_t kFNVOffsetBasis = 0xCBF29CE484222325ULL;
+static const uint64_t kFNVPrime = 0x100000001B3ULL;
+
+static uint64_t HashBytes(uint64_t _hash, const std::string& _bytes)
+{
+	// FNV-1a, with a separator so moving text between two strings changes the hash
+	for (size_t i = 0; i < _bytes.size(); i++) {
+		_hash = (_hash ^ static_cast<unsigned char>(_bytes[i])) * kFNVPrime;
+	}
+	return (_hash ^ 0xFF) * kFNVPrime;
+}
+
+static std::string GetString(GLenum _name)
+{
+	const GLubyte* value = glGetString(_name);
+	return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+static uint32_t MicrosecondsSince(std::chrono::high_resolution_clock::time_point _start)
+{
+	return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - _start).count());
+}
 
 // Public //
 ShaderLoader::ShaderLoader()
 {
+	// Drivers may expose the entry points yet support no formats, then there is nothing to cache
+	GLint formats = 0;
+	if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	}
+	this->bBinaryCache = formats > 0;
+	this->driver = GetString(GL_VENDOR) + "|" + GetString(GL_RENDERER) + "|" + GetString(GL_VERSION);
+
+	// Let the driver compile on as many threads as it likes, completion is then polled instead of waited on
+	this->bParallelCompile = false;
+	if (GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		this->bParallelCompile = true;
+	}
+	else if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		this->bParallelCompile = true;
+	}
+
+	if (bBinaryCache) {
+#ifdef _WIN32
+		_mkdir(kProgramCacheDirectory);
+#else
+		mkdir(kProgramCacheDirectory, 0755);
+#endif
+	}
+
 	return;
 }
 
 ShaderLoader::~ShaderLoader()
 {
+	// Worker threads read through this loader, they must be done before it goes away
+	Finish();
 	return;
 }
 
 GLuint ShaderLoader::CreateProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename)
 {
-	std::string vertex_shader_code = ReadShader(vertexShaderFilename);
-	GLuint vertex_shader = CreateShader(GL_VERTEX_SHADER, vertex_shader_code, "vertex shader");
-	
-	std::string fragment_shader_code = ReadShader(fragmentShaderFilename);
-	GLuint fragment_shader = CreateShader(GL_FRAGMENT_SHADER, fragment_shader_code, "fragment shader");
-	
-	int link_result = 0;
-	
-	//create the program handle, attach the shaders and link it
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &link_result);
-	
-	//check for link errors
-	if (link_result == GL_FALSE) {
-		int info_log_length = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
-		
-		std::vector<char> program_log(info_log_length);
-		glGetProgramInfoLog(program, info_log_length, NULL, &program_log[0]);
-		
-		std::cout << "Shader Loader : LINK ERROR" << std::endl << &program_log[0] << std::endl;
-		return 0;
+	GLuint program = SubmitProgram(vertexShaderFilename, fragmentShaderFilename);
+	Finish();
+
+	return isReady(program) ? program : 0;
+}
+
+GLuint ShaderLoader::SubmitProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename)
+{
+	return SubmitProgram(vertexShaderFilename, fragmentShaderFilename, kShaderFeatureNone);
+}
+
+GLuint ShaderLoader::SubmitProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename, GLuint _features)
+{
+	PendingProgram program;
+	program.Program = glCreateProgram();
+	program.Name = std::string(vertexShaderFilename) + " + " + fragmentShaderFilename;
+	for (GLuint i = 0; i < kShaderFeatureCount; i++) {
+		if (_features & (1 << i)) {
+			program.Name += std::string(" ") + kShaderFeatureDefines[i];
+		}
 	}
-	return program;
+	program.State = kProgramReading;
+	program.VertexShader = 0;
+	program.FragmentShader = 0;
+	program.Hash = 0;
+	program.SubmitTime = std::chrono::high_resolution_clock::now();
+	program.CompileTime = program.SubmitTime;
+
+	// File reads, preprocessing, hashing and the cache lookup happen off the main thread
+	program.Sources = std::async(std::launch::async, &ShaderLoader::PrepareProgram, this, std::string(vertexShaderFilename), std::string(fragmentShaderFilename), _features);
+
+	const GLuint kProgram = program.Program;
+	pending.push_back(std::move(program));
+
+	return kProgram;
 }
 
-// Private //
-std::string ShaderLoader::ReadShader(const char* filename)
+GLuint ShaderLoader::getVariant(const char* vertexShaderFilename, const char* fragmentShaderFilename, GLuint _features)
 {
-	std::string shaderCode;
-	std::ifstream file(filename, std::ios::in);
-	if (!file.good()) {
-		std::cout << "Can't read file " << filename << std::endl;
-		std::terminate();
+	const std::tuple<std::string, std::string, GLuint> kKey(vertexShaderFilename, fragmentShaderFilename, _features);
+
+	std::map<std::tuple<std::string, std::string, GLuint>, GLuint>::iterator it = variants.find(kKey);
+	if (it != variants.end()) {
+		return it->second;
 	}
 
-	file.seekg(0, std::ios::end);
-	shaderCode.resize((unsigned int)file.tellg());
-	file.seekg(0, std::ios::beg);
-	file.read(&shaderCode[0], shaderCode.size());
-	file.close();
-	
-	return shaderCode;
+	const GLuint kProgram = SubmitProgram(vertexShaderFilename, fragmentShaderFilename, _features);
+	variants.insert(std::pair<std::tuple<std::string, std::string, GLuint>, GLuint>(kKey, kProgram));
+
+	return kProgram;
 }
 
-GLuint ShaderLoader::CreateShader(GLenum shaderType, std::string source, const char* shaderName)
+bool ShaderLoader::Update()
+{
+	for (size_t i = 0; i < pending.size();) {
+		if (UpdateProgram(pending[i], false)) {
+			pending.erase(pending.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+
+	return pending.empty();
+}
+
+void ShaderLoader::Finish()
+{
+	for (size_t i = 0; i < pending.size(); i++) {
+		UpdateProgram(pending[i], true);
+	}
+	pending.clear();
+
+	return;
+}
+
+bool ShaderLoader::isReady(GLuint _program) const
+{
+	for (size_t i = 0; i < pending.size(); i++) {
+		if (pending[i].Program == _program) {
+			return false;
+		}
+	}
+	return _program != 0 && std::find(failed.begin(), failed.end(), _program) == failed.end();
+}
+
+size_t ShaderLoader::getPendingCount() const
+{
+	return pending.size();
+}
+
+// Private //
+GLuint ShaderLoader::CreateShader(GLenum shaderType, std::string source)
 {
-	int compile_result = 0;
-	
 	GLuint shader = glCreateShader(shaderType);
 	
 	const char* shader_code_ptr = source.c_str();
 	const int shader_code_size = source.size();
 	glShaderSource(shader, 1, &shader_code_ptr, &shader_code_size);
 	glCompileShader(shader);
+
+	// Status isn't queried here, that would wait for the compile to finish
+	return shader;
+}
+
+bool ShaderLoader::CheckShader(GLuint shader, const char* shaderName)
+{
+	int compile_result = 0;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_result);
 	
 	//check for errors
@@ -87,7 +207,211 @@ GLuint ShaderLoader::CreateShader(GLenum shaderType, std::string source, const c
 		glGetShaderInfoLog(shader, info_log_length, NULL, &shader_log[0]);
 		
 		std::cout << "ERROR compiling shader: " << shaderName << std::endl << &shader_log[0] << std::endl;
-		return 0;
+		return false;
 	}
-	return shader;
-}
\ No newline at end of file
+	return true;
+}
+
+ProgramSources ShaderLoader::PrepareProgram(std::string _vertexShaderFilename, std::string _fragmentShaderFilename, GLuint _features) const
+{
+	// Runs on a worker thread, only reads files and the driver string fixed at construction
+	std::vector<std::string> defines;
+	for (GLuint i = 0; i < kShaderFeatureCount; i++) {
+		if (_features & (1 << i)) {
+			defines.push_back(kShaderFeatureDefines[i]);
+		}
+	}
+
+	// The hash is over the expanded sources, so editing an include or picking other features gets its own binary
+	ProgramSources sources;
+	sources.bValid =
+		ShaderPreprocessor::Process(_vertexShaderFilename, defines, sources.VertexSource) &&
+		ShaderPreprocessor::Process(_fragmentShaderFilename, defines, sources.FragmentSource);
+	sources.Hash = HashProgram(sources.VertexSource, sources.FragmentSource);
+
+	if (!sources.bValid || !bBinaryCache || !ReadProgramBinary(sources.Hash, sources.BinaryHeader, sources.Binary)) {
+		sources.Binary.clear();
+	}
+
+	return sources;
+}
+
+bool ShaderLoader::UpdateProgram(PendingProgram& _program, bool _bWait)
+{
+	if (_program.State == kProgramReading) {
+		if (!_bWait && _program.Sources.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return false;
+		}
+
+		const ProgramSources kSources = _program.Sources.get();
+		_program.Hash = kSources.Hash;
+
+		if (!kSources.bValid) {
+			std::cout << "Shader Loader : " << _program.Name << " sources could not be read" << std::endl;
+			_program.State = kProgramFailed;
+			failed.push_back(_program.Program);
+			return true;
+		}
+
+		//try the binary linked on an earlier launch first
+		if (!kSources.Binary.empty()) {
+			const std::chrono::high_resolution_clock::time_point kLoadStart = std::chrono::high_resolution_clock::now();
+			glProgramBinary(_program.Program, kSources.BinaryHeader.Format, &kSources.Binary[0], kSources.BinaryHeader.Length);
+
+			// Drivers are free to reject any binary, it is then compiled from source and overwritten
+			GLint link_result = GL_FALSE;
+			glGetProgramiv(_program.Program, GL_LINK_STATUS, &link_result);
+			if (link_result == GL_TRUE) {
+				const uint32_t kLoadTime = MicrosecondsSince(kLoadStart);
+				const int kSaved = static_cast<int>(kSources.BinaryHeader.CompileTime) - static_cast<int>(kLoadTime);
+				std::cout << "Shader Loader : " << _program.Name << " loaded from binary in " << kLoadTime / 1000.0f << " ms, saved " << kSaved / 1000.0f << " ms" << std::endl;
+				_program.State = kProgramReady;
+				return true;
+			}
+			std::cout << "Shader Loader : cached binary for " << _program.Name << " was rejected, compiling from source" << std::endl;
+		}
+
+		CompileProgram(_program, kSources);
+	}
+
+	if (_program.State == kProgramLinking) {
+		// Without the extension the status query below simply waits for the driver
+		if (bParallelCompile && !_bWait) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(_program.Program, GL_COMPLETION_STATUS_KHR, &completed);
+			if (completed == GL_FALSE) {
+				return false;
+			}
+		}
+
+		CompleteProgram(_program);
+	}
+
+	return true;
+}
+
+void ShaderLoader::CompileProgram(PendingProgram& _program, const ProgramSources& _sources)
+{
+	_program.CompileTime = std::chrono::high_resolution_clock::now();
+
+	_program.VertexShader = CreateShader(GL_VERTEX_SHADER, _sources.VertexSource);
+	_program.FragmentShader = CreateShader(GL_FRAGMENT_SHADER, _sources.FragmentSource);
+
+	//attach the shaders and link straight away, the driver chains the link after the compiles
+	if (bBinaryCache) {
+		glProgramParameteri(_program.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glAttachShader(_program.Program, _program.VertexShader);
+	glAttachShader(_program.Program, _program.FragmentShader);
+	glLinkProgram(_program.Program);
+
+	_program.State = kProgramLinking;
+
+	return;
+}
+
+void ShaderLoader::CompleteProgram(PendingProgram& _program)
+{
+	int link_result = 0;
+	glGetProgramiv(_program.Program, GL_LINK_STATUS, &link_result);
+
+	//check for link errors, the shader logs usually say why
+	if (link_result == GL_FALSE) {
+		CheckShader(_program.VertexShader, "vertex shader");
+		CheckShader(_program.FragmentShader, "fragment shader");
+
+		int info_log_length = 0;
+		glGetProgramiv(_program.Program, GL_INFO_LOG_LENGTH, &info_log_length);
+		
+		std::vector<char> program_log(info_log_length + 1, '\0');
+		glGetProgramInfoLog(_program.Program, info_log_length, NULL, &program_log[0]);
+		
+		std::cout << "Shader Loader : LINK ERROR " << _program.Name << std::endl << &program_log[0] << std::endl;
+		_program.State = kProgramFailed;
+		failed.push_back(_program.Program);
+	}
+	else {
+		const uint32_t kCompileTime = MicrosecondsSince(_program.CompileTime);
+		std::cout << "Shader Loader : " << _program.Name << " compiled in " << kCompileTime / 1000.0f << " ms, ready "
+			<< MicrosecondsSince(_program.SubmitTime) / 1000.0f << " ms after submit" << std::endl;
+
+		if (bBinaryCache) {
+			SaveProgramBinary(_program.Program, _program.Hash, kCompileTime);
+		}
+		_program.State = kProgramReady;
+	}
+
+	// The linked program keeps everything it needs
+	glDetachShader(_program.Program, _program.VertexShader);
+	glDetachShader(_program.Program, _program.FragmentShader);
+	glDeleteShader(_program.VertexShader);
+	glDeleteShader(_program.FragmentShader);
+
+	return;
+}
+
+uint64_t ShaderLoader::HashProgram(const std::string& _vertexSource, const std::string& _fragmentSource) const
+{
+	uint64_t hash = kFNVOffsetBasis;
+	hash = HashBytes(hash, _vertexSource);
+	hash = HashBytes(hash, _fragmentSource);
+	hash = HashBytes(hash, driver);
+	return hash;
+}
+
+std::string ShaderLoader::GetCachePath(uint64_t _hash) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(_hash));
+	return std::string(kProgramCacheDirectory) + "/" + name;
+}
+
+bool ShaderLoader::ReadProgramBinary(uint64_t _hash, ProgramBinaryHeader& header, std::vector<char>& binary) const
+{
+	std::ifstream file(GetCachePath(_hash), std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		return false;
+	}
+
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file.good() || header.Magic != kProgramBinaryMagic || header.Version != kProgramBinaryVersion || header.Hash != _hash || header.Length == 0) {
+		return false;
+	}
+
+	binary.resize(header.Length);
+	file.read(&binary[0], header.Length);
+
+	return file.good();
+}
+
+void ShaderLoader::SaveProgramBinary(GLuint _program, uint64_t _hash, uint32_t _compileTime)
+{
+	GLint length = 0;
+	glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(_program, length, &length, &format, &binary[0]);
+
+	ProgramBinaryHeader header;
+	header.Magic = kProgramBinaryMagic;
+	header.Version = kProgramBinaryVersion;
+	header.Hash = _hash;
+	header.Format = format;
+	header.Length = static_cast<uint32_t>(length);
+	header.CompileTime = _compileTime;
+	header.Padding = 0;
+
+	std::ofstream file(GetCachePath(_hash), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good()) {
+		std::cout << "Shader Loader : Can't write program cache " << GetCachePath(_hash) << std::endl;
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(&binary[0], length);
+
+	return;
+}
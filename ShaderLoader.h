@@ -1,18 +1,113 @@
-#pragma once
-#include <string>
-
-#include <GL/glew.h>
-
-class ShaderLoader
-{
-public:
-	ShaderLoader();
-	~ShaderLoader();
-
-	GLuint CreateProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename);
-
-private:
-	std::string ReadShader(const char* filename);
-	GLuint CreateShader(GLenum shaderType, std::string source, const char* shaderName);
-};
-
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <future>
+#include <chrono>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// Header of a cached program binary, the file is named after Hash
+struct ProgramBinaryHeader
+{
+	uint32_t	Magic;			// kProgramBinaryMagic
+	uint32_t	Version;		// kProgramBinaryVersion
+	uint64_t	Hash;			// sources and driver strings the binary was linked from
+	uint32_t	Format;			// from glGetProgramBinary
+	uint32_t	Length;			// bytes of binary following the header
+	uint32_t	CompileTime;	// microseconds the source compile and link took, to report what loading saved
+	uint32_t	Padding;
+};
+
+static const uint32_t kProgramBinaryMagic = 0x4E494253;	// "SBIN"
+static const uint32_t kProgramBinaryVersion = 1;
+
+// Feature bits a shader source can be compiled with, each one becomes a FEATURE_* define
+enum ShaderFeature
+{
+	kShaderFeatureNone = 0,
+	kShaderFeatureSpecular = 1 << 0,	// FEATURE_SPECULAR
+	kShaderFeatureTexture = 1 << 1,		// FEATURE_TEXTURE
+	kShaderFeatureInstancing = 1 << 2,	// FEATURE_INSTANCING, model matrix per instance from attribute 3
+	kShaderFeatureClustered = 1 << 3,	// FEATURE_CLUSTERED, point lights from ClusteredLighting
+};
+
+enum ProgramState
+{
+	kProgramReading = 0,	// a worker thread is reading the sources and cached binary
+	kProgramLinking,		// compile and link submitted, the driver may still be working on it
+	kProgramReady,
+	kProgramFailed,
+};
+
+// Everything a worker thread prepares for one program, no GL calls are needed to build it
+struct ProgramSources
+{
+	bool					bValid;			// false when a file or include couldn't be read
+	std::string				VertexSource;
+	std::string				FragmentSource;
+	uint64_t				Hash;
+	ProgramBinaryHeader		BinaryHeader;
+	std::vector<char>		Binary;			// empty when nothing usable is cached
+};
+
+struct PendingProgram
+{
+	GLuint							Program;
+	std::string						Name;
+	ProgramState					State;
+	std::future<ProgramSources>		Sources;
+	GLuint							VertexShader;
+	GLuint							FragmentShader;
+	uint64_t						Hash;
+	std::chrono::high_resolution_clock::time_point	SubmitTime;
+	std::chrono::high_resolution_clock::time_point	CompileTime;
+};
+
+class ShaderLoader
+{
+public:
+	ShaderLoader();
+	~ShaderLoader();
+
+	// Loads the linked program from the binary cache when the driver accepts it, otherwise compiles and caches it.
+	// Blocks until it is done, prefer SubmitProgram when several programs are needed.
+	GLuint CreateProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename);
+
+	// Returns the program name straight away, it may only be used once isReady says so
+	GLuint SubmitProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename);
+	GLuint SubmitProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename, GLuint _features);
+	// Permutation registry, each combination of sources and ShaderFeature bits is submitted once and shared
+	GLuint getVariant(const char* vertexShaderFilename, const char* fragmentShaderFilename, GLuint _features);
+	// Advances every pending program without waiting on the driver, true once none are left
+	bool Update();
+	// Waits for every pending program
+	void Finish();
+
+	bool isReady(GLuint _program) const;
+	size_t getPendingCount() const;
+
+private:
+	bool bBinaryCache;		// false when the driver has no program binary formats
+	bool bParallelCompile;	// completion can be polled without blocking
+	std::string driver;		// vendor, renderer and version, a driver update invalidates every binary
+
+	std::vector<PendingProgram> pending;
+	std::vector<GLuint> failed;
+	std::map<std::tuple<std::string, std::string, GLuint>, GLuint> variants;
+
+	GLuint CreateShader(GLenum shaderType, std::string source);
+	bool CheckShader(GLuint shader, const char* shaderName);
+
+	ProgramSources PrepareProgram(std::string _vertexShaderFilename, std::string _fragmentShaderFilename, GLuint _features) const;
+	bool UpdateProgram(PendingProgram& _program, bool _bWait);
+	void CompileProgram(PendingProgram& _program, const ProgramSources& _sources);
+	void CompleteProgram(PendingProgram& _program);
+
+	uint64_t HashProgram(const std::string& _vertexSource, const std::string& _fragmentSource) const;
+	std::string GetCachePath(uint64_t _hash) const;
+	bool ReadProgramBinary(uint64_t _hash, ProgramBinaryHeader& header, std::vector<char>& binary) const;
+	void SaveProgramBinary(GLuint _program, uint64_t _hash, uint32_t _compileTime);
+};
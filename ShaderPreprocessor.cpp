@@ -0,0 +1,145 @@
+#include "ShaderPreprocessor.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+// Deep enough for any sane chain, anything past it is a cycle the stack check missed
+static const size_t kMaxIncludeDepth = 16;
+
+static std::string GetDirectory(const std::string& _fileName)
+{
+	const size_t kSlash = _fileName.find_last_of("/\\");
+	return (kSlash == std::string::npos) ? "" : _fileName.substr(0, kSlash + 1);
+}
+
+static std::string TrimLeft(const std::string& _line)
+{
+	const size_t kStart = _line.find_first_not_of(" \t");
+	return (kStart == std::string::npos) ? "" : _line.substr(kStart);
+}
+
+// Public //
+
+bool ShaderPreprocessor::Process(const std::string& _fileName, const std::vector<std::string>& _defines, std::string& source)
+{
+	std::vector<std::string> files;
+	std::vector<std::string> stack;
+
+	source.clear();
+	if (!Expand(_fileName, _defines, files, stack, source)) {
+		source.clear();
+		return false;
+	}
+
+	return true;
+}
+
+// Private //
+
+bool ShaderPreprocessor::Expand(const std::string& _fileName, const std::vector<std::string>& _defines, std::vector<std::string>& files, std::vector<std::string>& stack, std::string& source)
+{
+	if (std::find(stack.begin(), stack.end(), _fileName) != stack.end() || stack.size() >= kMaxIncludeDepth) {
+		std::cout << "Shader Preprocessor : " << _fileName << " includes itself" << std::endl;
+		return false;
+	}
+
+	std::string contents;
+	if (!ReadFile(_fileName, contents)) {
+		std::cout << "Shader Preprocessor : Can't read file " << _fileName << std::endl;
+		return false;
+	}
+
+	// #line takes a source string number, the index in files stands in for the name
+	const size_t kFileIndex = files.size();
+	files.push_back(_fileName);
+	stack.push_back(_fileName);
+
+	const bool kRoot = (kFileIndex == 0);
+	if (!kRoot) {
+		source += "#line 1 " + std::to_string(kFileIndex) + "\n";
+	}
+
+	std::istringstream lines(contents);
+	std::string line;
+	size_t lineNumber = 0;
+	bool bVersion = false;
+
+	while (std::getline(lines, line)) {
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		const std::string kDirective = TrimLeft(line);
+
+		if (kDirective.compare(0, 8, "#version") == 0) {
+			if (!kRoot) {
+				std::cout << "Shader Preprocessor : " << _fileName << " is included but has a #version" << std::endl;
+				return false;
+			}
+
+			// Defines must come after #version, which has to stay the first statement
+			bVersion = true;
+			source += line + "\n";
+			for (size_t i = 0; i < _defines.size(); i++) {
+				source += "#define " + _defines[i] + " 1\n";
+			}
+			source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(kFileIndex) + "\n";
+			continue;
+		}
+
+		if (kDirective.compare(0, 8, "#include") == 0) {
+			const size_t kOpen = kDirective.find('"');
+			const size_t kClose = (kOpen == std::string::npos) ? std::string::npos : kDirective.find('"', kOpen + 1);
+			if (kClose == std::string::npos) {
+				std::cout << "Shader Preprocessor : " << _fileName << "(" << lineNumber << ") malformed #include" << std::endl;
+				return false;
+			}
+
+			// Every include behaves as if it had #pragma once
+			const std::string kIncludeName = GetDirectory(_fileName) + kDirective.substr(kOpen + 1, kClose - kOpen - 1);
+			if (std::find(files.begin(), files.end(), kIncludeName) == files.end()) {
+				if (!Expand(kIncludeName, _defines, files, stack, source)) {
+					std::cout << "Shader Preprocessor : included from " << _fileName << "(" << lineNumber << ")" << std::endl;
+					return false;
+				}
+				source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(kFileIndex) + "\n";
+			}
+			continue;
+		}
+
+		source += line + "\n";
+	}
+
+	// Without a #version the defines simply lead the source
+	if (kRoot && !bVersion && !_defines.empty()) {
+		std::string defines;
+		for (size_t i = 0; i < _defines.size(); i++) {
+			defines += "#define " + _defines[i] + " 1\n";
+		}
+		source = defines + "#line 1 0\n" + source;
+	}
+
+	stack.pop_back();
+
+	return true;
+}
+
+bool ShaderPreprocessor::ReadFile(const std::string& _fileName, std::string& contents)
+{
+	std::ifstream file(_fileName, std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	contents.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	if (!contents.empty()) {
+		file.read(&contents[0], contents.size());
+	}
+
+	return file.good();
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Expands #include "file" and injects #defines so one shader source can build several variants.
+// Pure file and string work, safe to run on a worker thread.
+class ShaderPreprocessor
+{
+public:
+	// Includes resolve relative to the including file and each file is pasted at most once.
+	// _defines go right after #version, #line directives keep compile errors pointing at the right file.
+	static bool Process(const std::string& _fileName, const std::vector<std::string>& _defines, std::string& source);
+
+private:
+	static bool Expand(const std::string& _fileName, const std::vector<std::string>& _defines, std::vector<std::string>& files, std::vector<std::string>& stack, std::string& source);
+	static bool ReadFile(const std::string& _fileName, std::string& contents);
+};
@@ -0,0 +1,709 @@
+#include "SoftwareRenderer.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+#include <emmintrin.h>
+
+#include "Dependencies/stb-master/stb_image.h"
+
+#include "Camera.h"
+#include "ProceduralMesh.h"
+
+// Below this many triangles per worker the setup isn't worth a thread
+static const size_t kMinTrianglesPerWorker = 1024;
+
+// Floats per glyph in TextLayout::Quads, vertex 1 is the bottom left corner and vertex 5 the top right
+static const size_t kFloatsPerGlyph = 24;
+
+const int SoftwareRenderer::kTileSize;
+const int SoftwareRenderer::kAttributeCount;
+
+// Runs _work(worker) for every worker, worker 0 on the calling thread
+template <typename Work>
+static void RunWorkers(unsigned int _workerCount, Work _work)
+{
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < _workerCount; i++) {
+		threads.push_back(std::thread(_work, i));
+	}
+	_work(0);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	return;
+}
+
+static uint32_t PackColor(glm::vec3 _color)
+{
+	const glm::vec3 kColor = glm::clamp(_color, 0.0f, 1.0f) * 255.0f + 0.5f;
+	return static_cast<uint32_t>(kColor.r) | (static_cast<uint32_t>(kColor.g) << 8) | (static_cast<uint32_t>(kColor.b) << 16) | 0xFF000000u;
+}
+
+static glm::vec3 UnpackColor(uint32_t _color)
+{
+	return glm::vec3(_color & 0xFF, (_color >> 8) & 0xFF, (_color >> 16) & 0xFF) / 255.0f;
+}
+
+// Bilinear with GL_REPEAT, the texture's first row is v = 0
+static glm::vec3 SampleTexture(const SoftwareTexture& _texture, glm::vec2 _uv)
+{
+	const float kX = _uv.x * _texture.Width - 0.5f;
+	const float kY = _uv.y * _texture.Height - 0.5f;
+	const float kFloorX = std::floor(kX);
+	const float kFloorY = std::floor(kY);
+	const float kFractionX = kX - kFloorX;
+	const float kFractionY = kY - kFloorY;
+
+	int x0 = static_cast<int>(kFloorX) % _texture.Width;
+	int y0 = static_cast<int>(kFloorY) % _texture.Height;
+	x0 += (x0 < 0) ? _texture.Width : 0;
+	y0 += (y0 < 0) ? _texture.Height : 0;
+	const int kX1 = (x0 + 1) % _texture.Width;
+	const int kY1 = (y0 + 1) % _texture.Height;
+
+	glm::vec3 texels[4];
+	const int kCoords[4][2] = { { x0, y0 }, { kX1, y0 }, { x0, kY1 }, { kX1, kY1 } };
+	for (int i = 0; i < 4; i++) {
+		const unsigned char* kTexel = &_texture.Pixels[(kCoords[i][1] * _texture.Width + kCoords[i][0]) * _texture.Channels];
+		texels[i] = (_texture.Channels >= 3) ? glm::vec3(kTexel[0], kTexel[1], kTexel[2]) : glm::vec3(kTexel[0]);
+	}
+
+	const glm::vec3 kBottom = glm::mix(texels[0], texels[1], kFractionX);
+	const glm::vec3 kTop = glm::mix(texels[2], texels[3], kFractionX);
+	return glm::mix(kBottom, kTop, kFractionY) / 255.0f;
+}
+
+// Bilinear with GL_CLAMP_TO_EDGE on the first channel, how glyph atlases are sampled
+static float SampleAtlas(const SoftwareTexture& _atlas, glm::vec2 _uv)
+{
+	const float kX = glm::clamp(_uv.x * _atlas.Width - 0.5f, 0.0f, _atlas.Width - 1.0f);
+	const float kY = glm::clamp(_uv.y * _atlas.Height - 0.5f, 0.0f, _atlas.Height - 1.0f);
+	const int kX0 = static_cast<int>(kX);
+	const int kY0 = static_cast<int>(kY);
+	const int kX1 = std::min(kX0 + 1, _atlas.Width - 1);
+	const int kY1 = std::min(kY0 + 1, _atlas.Height - 1);
+	const float kFractionX = kX - kX0;
+	const float kFractionY = kY - kY0;
+
+	const float kBottom = glm::mix((float)_atlas.Pixels[(kY0 * _atlas.Width + kX0) * _atlas.Channels], (float)_atlas.Pixels[(kY0 * _atlas.Width + kX1) * _atlas.Channels], kFractionX);
+	const float kTop = glm::mix((float)_atlas.Pixels[(kY1 * _atlas.Width + kX0) * _atlas.Channels], (float)_atlas.Pixels[(kY1 * _atlas.Width + kX1) * _atlas.Channels], kFractionX);
+	return glm::mix(kBottom, kTop, kFractionY) / 255.0f;
+}
+
+// Public //
+
+SoftwareRenderer::SoftwareRenderer(int _width, int _height)
+{
+	this->width = std::max(1, _width);
+	this->height = std::max(1, _height);
+	this->tilesX = (width + kTileSize - 1) / kTileSize;
+	this->tilesY = (height + kTileSize - 1) / kTileSize;
+
+	// Rows are padded to whole tiles so four pixel groups never run off the end
+	this->colorBuffer.assign(tilesX * kTileSize * tilesY * kTileSize, 0);
+	this->depthBuffer.assign(tilesX * kTileSize * tilesY * kTileSize, 1.0f);
+
+	this->viewProjection = glm::mat4(1.0f);
+	this->clearColor = 0xFF000000u;
+	this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+	this->stats = { 0, 0, 0, 0, 0, 0.0f, 0.0f };
+
+	return;
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+	return;
+}
+
+void SoftwareRenderer::Begin(const glm::mat4& _viewProjection, glm::vec3 _clearColor)
+{
+	this->viewProjection = _viewProjection;
+	this->clearColor = PackColor(_clearColor);
+
+	draws.clear();
+	textQuads.clear();
+
+	return;
+}
+
+void SoftwareRenderer::DrawMesh(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const glm::mat4& _model, const SoftwareMaterial& _material)
+{
+	if (_vertices.empty() || _indices.size() < 3) {
+		return;
+	}
+
+	DrawCommand draw;
+	draw.Vertices = &_vertices[0];
+	draw.VertexCount = _vertices.size();
+	draw.Indices = &_indices[0];
+	draw.TriangleCount = _indices.size() / 3;
+	draw.Model = _model;
+	draw.Material = _material;
+	draw.FirstVertex = draws.empty() ? 0 : draws.back().FirstVertex + draws.back().VertexCount;
+	draw.FirstTriangle = draws.empty() ? 0 : draws.back().FirstTriangle + draws.back().TriangleCount;
+	draws.push_back(draw);
+
+	return;
+}
+
+void SoftwareRenderer::DrawText(const TextLayout& _layout, const SoftwareTexture* _atlas, glm::vec3 _color, FontRenderMode _mode)
+{
+	if (!_atlas || _atlas->Pixels.empty()) {
+		return;
+	}
+
+	for (size_t i = 0; i + kFloatsPerGlyph <= _layout.Quads.size(); i += kFloatsPerGlyph) {
+		const GLfloat* kGlyph = &_layout.Quads[i];
+
+		TextQuad quad;
+		quad.Min = glm::vec2(kGlyph[4], kGlyph[5]);
+		quad.UVMin = glm::vec2(kGlyph[6], kGlyph[7]);
+		quad.Max = glm::vec2(kGlyph[20], kGlyph[21]);
+		quad.UVMax = glm::vec2(kGlyph[22], kGlyph[23]);
+		quad.Color = _color;
+		quad.Atlas = _atlas;
+		quad.Mode = _mode;
+		textQuads.push_back(quad);
+	}
+
+	return;
+}
+
+void SoftwareRenderer::Flush()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	const size_t kVertexCount = draws.empty() ? 0 : draws.back().FirstVertex + draws.back().VertexCount;
+	const size_t kTriangleCount = draws.empty() ? 0 : draws.back().FirstTriangle + draws.back().TriangleCount;
+	const unsigned int kSetupWorkers = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threadCount, kTriangleCount / kMinTrianglesPerWorker)));
+
+	// Each vertex is transformed once however many triangles share it
+	transformed.resize(kVertexCount);
+	RunWorkers(kSetupWorkers, [this, kVertexCount, kSetupWorkers](unsigned int _worker) {
+		TransformVertices(kVertexCount * _worker / kSetupWorkers, kVertexCount * (_worker + 1) / kSetupWorkers);
+	});
+
+	triangles.resize(kSetupWorkers);
+	bins.resize(kSetupWorkers);
+	RunWorkers(kSetupWorkers, [this, kTriangleCount, kSetupWorkers](unsigned int _worker) {
+		SetupTriangles(_worker, kTriangleCount * _worker / kSetupWorkers, kTriangleCount * (_worker + 1) / kSetupWorkers);
+	});
+
+	std::chrono::high_resolution_clock::time_point binned = std::chrono::high_resolution_clock::now();
+
+	// Tiles are handed out one at a time, a busy tile doesn't hold up a whole band
+	const unsigned int kTileWorkers = std::min<unsigned int>(threadCount, tilesX * tilesY);
+	std::atomic<int> nextTile(0);
+	RunWorkers(kTileWorkers, [this, &nextTile](unsigned int) {
+		ShadeTiles(&nextTile);
+	});
+
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	stats.Triangles = static_cast<uint32_t>(kTriangleCount);
+	stats.SetupTriangles = 0;
+	stats.BinEntries = 0;
+	for (unsigned int i = 0; i < kSetupWorkers; i++) {
+		stats.SetupTriangles += static_cast<uint32_t>(triangles[i].size());
+		for (size_t tile = 0; tile < bins[i].size(); tile++) {
+			stats.BinEntries += static_cast<uint32_t>(bins[i][tile].size());
+		}
+	}
+	stats.TextQuads = static_cast<uint32_t>(textQuads.size());
+	stats.Threads = threadCount;
+	stats.SetupMs = std::chrono::duration<float, std::milli>(binned - start).count();
+	stats.RasterMs = std::chrono::duration<float, std::milli>(end - binned).count();
+
+	return;
+}
+
+void SoftwareRenderer::setThreadCount(unsigned int _threadCount)
+{
+	this->threadCount = std::max(1u, _threadCount);
+	return;
+}
+
+int SoftwareRenderer::getWidth() const
+{
+	return width;
+}
+
+int SoftwareRenderer::getHeight() const
+{
+	return height;
+}
+
+const std::vector<uint32_t>& SoftwareRenderer::getColorBuffer() const
+{
+	return colorBuffer;
+}
+
+const std::vector<float>& SoftwareRenderer::getDepthBuffer() const
+{
+	return depthBuffer;
+}
+
+const SoftwareStats& SoftwareRenderer::getStats() const
+{
+	return stats;
+}
+
+bool SoftwareRenderer::WriteImage(const std::string& _fileName) const
+{
+	std::ofstream file(_fileName, std::ios::out | std::ios::binary);
+	if (!file.good()) {
+		std::cout << "Software Renderer : Can't write " << _fileName << std::endl;
+		return false;
+	}
+
+	const int kStride = tilesX * kTileSize;
+	std::vector<unsigned char> pixels(width * height * 3);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const uint32_t kColor = colorBuffer[(height - 1 - y) * kStride + x];
+			unsigned char* pixel = &pixels[(y * width + x) * 3];
+			pixel[0] = kColor & 0xFF;
+			pixel[1] = (kColor >> 8) & 0xFF;
+			pixel[2] = (kColor >> 16) & 0xFF;
+		}
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(&pixels[0]), pixels.size());
+
+	return file.good();
+}
+
+bool SoftwareRenderer::LoadTexture(const std::string& _fileName, SoftwareTexture& texture)
+{
+	int channels = 0;
+	stbi_uc* image = stbi_load(_fileName.c_str(), &texture.Width, &texture.Height, &channels, STBI_rgb);
+	if (!image) {
+		std::cout << "Software Renderer : Can't load texture " << _fileName << std::endl;
+		return false;
+	}
+
+	texture.Channels = 3;
+	texture.Pixels.assign(image, image + texture.Width * texture.Height * 3);
+	stbi_image_free(image);
+
+	return true;
+}
+
+void SoftwareRenderer::Benchmark(int _iterations)
+{
+	const int kWidth = 800;
+	const int kHeight = 600;
+	const uint32_t kTriangleCounts[3] = { 10000, 100000, 1000000 };
+
+	std::vector<unsigned int> threadCounts;
+	const unsigned int kCores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int threads = 1; threads < kCores; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(kCores);
+
+	// Checkerboard so texturing costs what it would with a real texture
+	SoftwareTexture checker;
+	checker.Width = 256;
+	checker.Height = 256;
+	checker.Channels = 3;
+	checker.Pixels.resize(256 * 256 * 3);
+	for (int i = 0; i < 256 * 256; i++) {
+		const unsigned char kValue = (((i % 256) / 32 + (i / 256) / 32) % 2) ? 230 : 60;
+		checker.Pixels[i * 3] = kValue;
+		checker.Pixels[i * 3 + 1] = kValue;
+		checker.Pixels[i * 3 + 2] = kValue;
+	}
+
+	// Same view as the game, the sphere fills a good part of the screen
+	const Camera kCamera(45.0f, static_cast<GLfloat>(kWidth), static_cast<GLfloat>(kHeight), 0.1f, 100.0f, glm::vec3(0.0f, 4.0f, 30.0f));
+	const SoftwareMaterial kMaterial = { &checker, glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(1.0f), kCamera.GetCameraPosition(), 0.5f, 0.1f, true };
+
+	std::vector<Vertex> groundVertices;
+	std::vector<uint32_t> groundIndices;
+	Mesh::SetCubeData(groundVertices, groundIndices);
+	glm::mat4 groundModel(1.0f);
+	groundModel = glm::translate(groundModel, glm::vec3(0.0f, -1.0f, 0.0f));
+	groundModel = glm::scale(groundModel, glm::vec3(4.0f, 0.5f, 4.0f));
+
+	for (uint32_t triangleCount : kTriangleCounts) {
+		const uint32_t kBands = static_cast<uint32_t>(std::sqrt(triangleCount / 2.0));
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		ProceduralMesh::GenerateSphere(3.0f, kBands, kBands, vertices, indices);
+		const glm::mat4 kSphereModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.5f, 0.0f));
+
+		for (unsigned int threads : threadCounts) {
+			SoftwareRenderer renderer(kWidth, kHeight);
+			renderer.setThreadCount(threads);
+
+			double bestSeconds = 0.0;
+			for (int i = 0; i < std::max(1, _iterations); i++) {
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				renderer.Begin(kCamera.GetProjectionMatrix() * kCamera.GetViewMatrix(), glm::vec3(0.0f));
+				renderer.DrawMesh(groundVertices, groundIndices, groundModel, kMaterial);
+				renderer.DrawMesh(vertices, indices, kSphereModel, kMaterial);
+				renderer.Flush();
+				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+				const double kSeconds = std::chrono::duration<double>(end - start).count();
+				bestSeconds = (i == 0) ? kSeconds : std::min(bestSeconds, kSeconds);
+			}
+
+			const SoftwareStats& kStats = renderer.getStats();
+			std::cout << "Software Renderer : " << kWidth << "x" << kHeight
+				<< " | " << kStats.Triangles << " triangles"
+				<< " | " << threads << " threads"
+				<< " | setup " << kStats.SetupMs << " ms"
+				<< " | raster " << kStats.RasterMs << " ms"
+				<< " | best " << bestSeconds * 1000.0 << " ms"
+				<< " | " << (kStats.Triangles / bestSeconds) / 1000000.0 << " M triangles/s" << std::endl;
+		}
+	}
+
+	return;
+}
+
+// Private //
+
+void SoftwareRenderer::TransformVertices(size_t _first, size_t _last)
+{
+	for (size_t d = 0; d < draws.size(); d++) {
+		const DrawCommand& kDraw = draws[d];
+		const size_t kBegin = std::max(_first, kDraw.FirstVertex);
+		const size_t kEnd = std::min(_last, kDraw.FirstVertex + kDraw.VertexCount);
+		if (kBegin >= kEnd) {
+			continue;
+		}
+
+		const glm::mat4 kMVP = viewProjection * kDraw.Model;
+		// Same normal matrix LitTexturedModel.vs builds per vertex, here once per draw
+		const glm::mat3 kNormalMatrix = glm::mat3(glm::transpose(glm::inverse(kDraw.Model)));
+
+		for (size_t i = kBegin; i < kEnd; i++) {
+			const Vertex& kVertex = kDraw.Vertices[i - kDraw.FirstVertex];
+			TransformedVertex& vertex = transformed[i];
+			vertex.Clip = kMVP * glm::vec4(kVertex.position, 1.0f);
+			vertex.World = glm::vec3(kDraw.Model * glm::vec4(kVertex.position, 1.0f));
+			vertex.Normal = kNormalMatrix * kVertex.normal;
+			vertex.UV = kVertex.texture_coordinate;
+		}
+	}
+
+	return;
+}
+
+void SoftwareRenderer::SetupTriangles(unsigned int _worker, size_t _first, size_t _last)
+{
+	triangles[_worker].clear();
+	bins[_worker].resize(tilesX * tilesY);
+	for (size_t i = 0; i < bins[_worker].size(); i++) {
+		bins[_worker][i].clear();
+	}
+
+	for (size_t d = 0; d < draws.size(); d++) {
+		const DrawCommand& kDraw = draws[d];
+		const size_t kBegin = std::max(_first, kDraw.FirstTriangle);
+		const size_t kEnd = std::min(_last, kDraw.FirstTriangle + kDraw.TriangleCount);
+
+		for (size_t t = kBegin; t < kEnd; t++) {
+			const uint32_t* kIndices = &kDraw.Indices[(t - kDraw.FirstTriangle) * 3];
+			if (kIndices[0] >= kDraw.VertexCount || kIndices[1] >= kDraw.VertexCount || kIndices[2] >= kDraw.VertexCount) {
+				continue;
+			}
+
+			const TransformedVertex* kVertices[3] = {
+				&transformed[kDraw.FirstVertex + kIndices[0]],
+				&transformed[kDraw.FirstVertex + kIndices[1]],
+				&transformed[kDraw.FirstVertex + kIndices[2]]
+			};
+
+			// Only the near plane is clipped, x and y are clamped to the screen when binning
+			bool bInside[3];
+			int insideCount = 0;
+			for (int v = 0; v < 3; v++) {
+				bInside[v] = kVertices[v]->Clip.z >= -kVertices[v]->Clip.w;
+				insideCount += bInside[v] ? 1 : 0;
+			}
+
+			if (insideCount == 3) {
+				AddTriangle(_worker, kVertices, static_cast<uint32_t>(d));
+				continue;
+			}
+			if (insideCount == 0) {
+				continue;
+			}
+
+			// Walk the edges and keep the inside part, a triangle becomes one or two
+			TransformedVertex clipped[4];
+			int clippedCount = 0;
+			for (int v = 0; v < 3; v++) {
+				const TransformedVertex& kA = *kVertices[v];
+				const TransformedVertex& kB = *kVertices[(v + 1) % 3];
+				if (bInside[v]) {
+					clipped[clippedCount++] = kA;
+				}
+				if (bInside[v] != bInside[(v + 1) % 3]) {
+					const float kDistanceA = kA.Clip.z + kA.Clip.w;
+					const float kDistanceB = kB.Clip.z + kB.Clip.w;
+					const float kT = kDistanceA / (kDistanceA - kDistanceB);
+
+					TransformedVertex& vertex = clipped[clippedCount++];
+					vertex.Clip = glm::mix(kA.Clip, kB.Clip, kT);
+					vertex.World = glm::mix(kA.World, kB.World, kT);
+					vertex.Normal = glm::mix(kA.Normal, kB.Normal, kT);
+					vertex.UV = glm::mix(kA.UV, kB.UV, kT);
+				}
+			}
+
+			for (int v = 1; v + 1 < clippedCount; v++) {
+				const TransformedVertex* kFan[3] = { &clipped[0], &clipped[v], &clipped[v + 1] };
+				AddTriangle(_worker, kFan, static_cast<uint32_t>(d));
+			}
+		}
+	}
+
+	return;
+}
+
+void SoftwareRenderer::AddTriangle(unsigned int _worker, const TransformedVertex* _vertices[3], uint32_t _draw)
+{
+	float x[3];
+	float y[3];
+	SetupTriangle triangle;
+
+	for (int v = 0; v < 3; v++) {
+		const TransformedVertex& kVertex = *_vertices[v];
+		const float kInverseW = 1.0f / kVertex.Clip.w;
+		x[v] = (kVertex.Clip.x * kInverseW * 0.5f + 0.5f) * width;
+		y[v] = (kVertex.Clip.y * kInverseW * 0.5f + 0.5f) * height;
+		triangle.Z[v] = kVertex.Clip.z * kInverseW * 0.5f + 0.5f;
+		triangle.InverseW[v] = kInverseW;
+
+		const float kAttributes[kAttributeCount] = {
+			kVertex.World.x, kVertex.World.y, kVertex.World.z,
+			kVertex.Normal.x, kVertex.Normal.y, kVertex.Normal.z,
+			kVertex.UV.x, kVertex.UV.y
+		};
+		for (int a = 0; a < kAttributeCount; a++) {
+			triangle.Attributes[v][a] = kAttributes[a] * kInverseW;
+		}
+	}
+
+	// Nothing is culled by facing, like the GL path, clockwise triangles just have their edges flipped
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < 1e-8f) {
+		return;
+	}
+	const float kSign = (area < 0.0f) ? -1.0f : 1.0f;
+	area *= kSign;
+
+	const float kMinX = std::min(x[0], std::min(x[1], x[2]));
+	const float kMaxX = std::max(x[0], std::max(x[1], x[2]));
+	const float kMinY = std::min(y[0], std::min(y[1], y[2]));
+	const float kMaxY = std::max(y[0], std::max(y[1], y[2]));
+	triangle.MinX = std::max(static_cast<int>(std::ceil(std::max(kMinX, -1.0f) - 0.5f)), 0);
+	triangle.MaxX = std::min(static_cast<int>(std::floor(std::min(kMaxX, static_cast<float>(width + 1)) - 0.5f)), width - 1);
+	triangle.MinY = std::max(static_cast<int>(std::ceil(std::max(kMinY, -1.0f) - 0.5f)), 0);
+	triangle.MaxY = std::min(static_cast<int>(std::floor(std::min(kMaxY, static_cast<float>(height + 1)) - 0.5f)), height - 1);
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY) {
+		return;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		const int kNext = (i + 1) % 3;
+		triangle.EdgeA[i] = kSign * (y[i] - y[kNext]);
+		triangle.EdgeB[i] = kSign * (x[kNext] - x[i]);
+		triangle.EdgeC[i] = kSign * ((y[kNext] - y[i]) * x[i] - (x[kNext] - x[i]) * y[i]);
+	}
+	triangle.InverseArea = 1.0f / area;
+	triangle.Draw = _draw;
+
+	std::vector<SetupTriangle>& workerTriangles = triangles[_worker];
+	const uint32_t kIndex = static_cast<uint32_t>(workerTriangles.size());
+	workerTriangles.push_back(triangle);
+
+	for (int tileY = triangle.MinY / kTileSize; tileY <= triangle.MaxY / kTileSize; tileY++) {
+		for (int tileX = triangle.MinX / kTileSize; tileX <= triangle.MaxX / kTileSize; tileX++) {
+			bins[_worker][tileY * tilesX + tileX].push_back(kIndex);
+		}
+	}
+
+	return;
+}
+
+void SoftwareRenderer::ShadeTiles(std::atomic<int>* _nextTile)
+{
+	const int kStride = tilesX * kTileSize;
+
+	for (int tile = (*_nextTile)++; tile < tilesX * tilesY; tile = (*_nextTile)++) {
+		const int kMinX = (tile % tilesX) * kTileSize;
+		const int kMinY = (tile / tilesX) * kTileSize;
+		const int kMaxX = std::min(kMinX + kTileSize, width) - 1;
+		const int kMaxY = std::min(kMinY + kTileSize, height) - 1;
+
+		for (int y = kMinY; y < kMinY + kTileSize; y++) {
+			std::fill(colorBuffer.begin() + y * kStride + kMinX, colorBuffer.begin() + y * kStride + kMinX + kTileSize, clearColor);
+			std::fill(depthBuffer.begin() + y * kStride + kMinX, depthBuffer.begin() + y * kStride + kMinX + kTileSize, 1.0f);
+		}
+
+		// Setup workers in order, then each one's bin in order, is submission order
+		for (size_t worker = 0; worker < bins.size(); worker++) {
+			const std::vector<uint32_t>& kBin = bins[worker][tile];
+			for (size_t i = 0; i < kBin.size(); i++) {
+				RasterizeTriangle(triangles[worker][kBin[i]], kMinX, kMaxX, kMinY, kMaxY);
+			}
+		}
+
+		for (size_t i = 0; i < textQuads.size(); i++) {
+			DrawTextQuad(textQuads[i], kMinX, kMaxX, kMinY, kMaxY);
+		}
+	}
+
+	return;
+}
+
+void SoftwareRenderer::RasterizeTriangle(const SetupTriangle& _triangle, int _minX, int _maxX, int _minY, int _maxY)
+{
+	const int kStride = tilesX * kTileSize;
+	const int kFirstX = std::max(_triangle.MinX, _minX) & ~3;
+	const int kLastX = std::min(_triangle.MaxX, _maxX);
+	const int kFirstY = std::max(_triangle.MinY, _minY);
+	const int kLastY = std::min(_triangle.MaxY, _maxY);
+
+	// Screen space depth is a plane, z = Z0 + (Z1 - Z0) * b1 + (Z2 - Z0) * b2 folded into A * x + B * y + C
+	const float* kZ = _triangle.Z;
+	const float kB1 = _triangle.InverseArea;
+	const float kDepthA = ((kZ[1] - kZ[0]) * _triangle.EdgeA[2] + (kZ[2] - kZ[0]) * _triangle.EdgeA[0]) * kB1;
+	const float kDepthB = ((kZ[1] - kZ[0]) * _triangle.EdgeB[2] + (kZ[2] - kZ[0]) * _triangle.EdgeB[0]) * kB1;
+	const float kDepthC = kZ[0] + ((kZ[1] - kZ[0]) * _triangle.EdgeC[2] + (kZ[2] - kZ[0]) * _triangle.EdgeC[0]) * kB1;
+
+	const __m128 kA0 = _mm_set1_ps(_triangle.EdgeA[0]);
+	const __m128 kA1 = _mm_set1_ps(_triangle.EdgeA[1]);
+	const __m128 kA2 = _mm_set1_ps(_triangle.EdgeA[2]);
+	const __m128 kDA = _mm_set1_ps(kDepthA);
+	const __m128 kZero = _mm_setzero_ps();
+	const __m128 kLaneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 kLastPixel = _mm_set1_ps(static_cast<float>(kLastX) + 0.5f);
+
+	for (int y = kFirstY; y <= kLastY; y++) {
+		const float kPixelY = y + 0.5f;
+		const __m128 kRow0 = _mm_set1_ps(_triangle.EdgeB[0] * kPixelY + _triangle.EdgeC[0]);
+		const __m128 kRow1 = _mm_set1_ps(_triangle.EdgeB[1] * kPixelY + _triangle.EdgeC[1]);
+		const __m128 kRow2 = _mm_set1_ps(_triangle.EdgeB[2] * kPixelY + _triangle.EdgeC[2]);
+		const __m128 kRowDepth = _mm_set1_ps(kDepthB * kPixelY + kDepthC);
+		float* depthRow = &depthBuffer[y * kStride];
+		uint32_t* colorRow = &colorBuffer[y * kStride];
+
+		for (int x = kFirstX; x <= kLastX; x += 4) {
+			const __m128 kPixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), kLaneOffsets);
+
+			const __m128 kE0 = _mm_add_ps(_mm_mul_ps(kA0, kPixelX), kRow0);
+			const __m128 kE1 = _mm_add_ps(_mm_mul_ps(kA1, kPixelX), kRow1);
+			const __m128 kE2 = _mm_add_ps(_mm_mul_ps(kA2, kPixelX), kRow2);
+			__m128 pass = _mm_and_ps(_mm_cmpge_ps(kE0, kZero), _mm_and_ps(_mm_cmpge_ps(kE1, kZero), _mm_cmpge_ps(kE2, kZero)));
+			// Lanes past the frame edge belong to the row padding
+			pass = _mm_and_ps(pass, _mm_cmple_ps(kPixelX, kLastPixel));
+			if (_mm_movemask_ps(pass) == 0) {
+				continue;
+			}
+
+			// GL_LESS against what the tile already holds
+			const __m128 kDepth = _mm_add_ps(_mm_mul_ps(kDA, kPixelX), kRowDepth);
+			const __m128 kStored = _mm_loadu_ps(depthRow + x);
+			pass = _mm_and_ps(pass, _mm_cmplt_ps(kDepth, kStored));
+			const int kMask = _mm_movemask_ps(pass);
+			if (kMask == 0) {
+				continue;
+			}
+			_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, kDepth), _mm_andnot_ps(pass, kStored)));
+
+			float e0[4];
+			float e1[4];
+			float e2[4];
+			_mm_storeu_ps(e0, kE0);
+			_mm_storeu_ps(e1, kE1);
+			_mm_storeu_ps(e2, kE2);
+			for (int lane = 0; lane < 4; lane++) {
+				if (kMask & (1 << lane)) {
+					// Edge i weighs the vertex across from it
+					colorRow[x + lane] = ShadePixel(_triangle, e1[lane] * _triangle.InverseArea, e2[lane] * _triangle.InverseArea, e0[lane] * _triangle.InverseArea);
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+void SoftwareRenderer::DrawTextQuad(const TextQuad& _quad, int _minX, int _maxX, int _minY, int _maxY)
+{
+	const int kStride = tilesX * kTileSize;
+	const int kFirstX = std::max(static_cast<int>(std::ceil(_quad.Min.x - 0.5f)), _minX);
+	const int kLastX = std::min(static_cast<int>(std::floor(_quad.Max.x - 0.5f)), _maxX);
+	const int kFirstY = std::max(static_cast<int>(std::ceil(_quad.Min.y - 0.5f)), _minY);
+	const int kLastY = std::min(static_cast<int>(std::floor(_quad.Max.y - 0.5f)), _maxY);
+	if (kFirstX > kLastX || kFirstY > kLastY) {
+		return;
+	}
+
+	const glm::vec2 kUVPerPixel = (_quad.UVMax - _quad.UVMin) / (_quad.Max - _quad.Min);
+
+	for (int y = kFirstY; y <= kLastY; y++) {
+		for (int x = kFirstX; x <= kLastX; x++) {
+			const glm::vec2 kUV = _quad.UVMin + (glm::vec2(x + 0.5f, y + 0.5f) - _quad.Min) * kUVPerPixel;
+			float alpha = SampleAtlas(*_quad.Atlas, kUV);
+
+			if (_quad.Mode == kSDF) {
+				// Same one pixel band textSDF.fs gets from fwidth, from the neighbours' samples
+				const float kWidth = std::fabs(SampleAtlas(*_quad.Atlas, kUV + glm::vec2(kUVPerPixel.x, 0.0f)) - alpha)
+					+ std::fabs(SampleAtlas(*_quad.Atlas, kUV + glm::vec2(0.0f, kUVPerPixel.y)) - alpha);
+				const float kT = glm::clamp((alpha - (0.5f - kWidth)) / std::max(2.0f * kWidth, 1e-6f), 0.0f, 1.0f);
+				alpha = kT * kT * (3.0f - 2.0f * kT);
+			}
+
+			// GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+			uint32_t& pixel = colorBuffer[y * kStride + x];
+			pixel = PackColor(glm::mix(UnpackColor(pixel), _quad.Color, alpha));
+		}
+	}
+
+	return;
+}
+
+uint32_t SoftwareRenderer::ShadePixel(const SetupTriangle& _triangle, float _b0, float _b1, float _b2) const
+{
+	// Perspective correct attributes from the screen space weights
+	const float kW = 1.0f / (_b0 * _triangle.InverseW[0] + _b1 * _triangle.InverseW[1] + _b2 * _triangle.InverseW[2]);
+	float attributes[kAttributeCount];
+	for (int a = 0; a < kAttributeCount; a++) {
+		attributes[a] = (_b0 * _triangle.Attributes[0][a] + _b1 * _triangle.Attributes[1][a] + _b2 * _triangle.Attributes[2][a]) * kW;
+	}
+
+	const glm::vec3 kWorldPosition(attributes[0], attributes[1], attributes[2]);
+	const glm::vec3 kNormal = glm::normalize(glm::vec3(attributes[3], attributes[4], attributes[5]));
+	const glm::vec2 kUV(attributes[6], attributes[7]);
+	const SoftwareMaterial& kMaterial = draws[_triangle.Draw].Material;
+
+	// LitTexturedModel.fs
+	const glm::vec3 kObjectColor = kMaterial.Texture ? SampleTexture(*kMaterial.Texture, kUV) : glm::vec3(1.0f);
+	const glm::vec3 kLightDirection = glm::normalize(kMaterial.LightPosition - kWorldPosition);
+	const glm::vec3 kLight = kMaterial.AmbientStrength * kMaterial.LightColor + std::max(glm::dot(kNormal, kLightDirection), 0.0f) * kMaterial.LightColor;
+
+	glm::vec3 specular(0.0f);
+	if (kMaterial.bSpecular) {
+		const glm::vec3 kViewDirection = glm::normalize(kMaterial.CameraPosition - kWorldPosition);
+		const glm::vec3 kReflection = glm::reflect(-kLightDirection, kNormal);
+		specular = kMaterial.SpecularStrength * std::pow(std::max(glm::dot(kViewDirection, kReflection), 0.0f), 128.0f) * kMaterial.LightColor;
+	}
+
+	return PackColor(kLight * kObjectColor + specular);
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <atomic>
+
+#include "Dependencies/glm/glm/glm.hpp"
+
+#include "Mesh.h"
+#include "TextRenderer.h"
+
+// Texels kept in memory, 3 channels for surfaces like TextureLoader, 1 for glyph atlases
+struct SoftwareTexture
+{
+	int							Width;
+	int							Height;
+	int							Channels;
+	std::vector<unsigned char>	Pixels;		// rows from v = 0, like the GL upload
+};
+
+// The uniforms LitTexturedModel.fs reads
+struct SoftwareMaterial
+{
+	const SoftwareTexture*	Texture;			// null is white, like a variant without FEATURE_TEXTURE
+	glm::vec3				LightPosition;
+	glm::vec3				LightColor;
+	glm::vec3				CameraPosition;
+	float					AmbientStrength;
+	float					SpecularStrength;
+	bool					bSpecular;			// FEATURE_SPECULAR
+};
+
+struct SoftwareStats
+{
+	uint32_t	Triangles;			// submitted
+	uint32_t	SetupTriangles;		// after near plane clipping and screen rejection
+	uint32_t	BinEntries;			// triangle references across every tile
+	uint32_t	TextQuads;
+	uint32_t	Threads;
+	float		SetupMs;			// vertex transform, clipping and binning
+	float		RasterMs;			// tile shading
+};
+
+// CPU render backend for machines without a GPU. Draws are recorded, then Flush transforms and bins
+// the triangles into 64x64 pixel tiles on worker threads and shades whole tiles in parallel.
+// Coverage, depth and interpolation run four pixels at a time with SSE2, lighting is per pixel.
+// Row 0 of the frame is the bottom of the screen like GL, the colors are RGBA8 with R in the low byte.
+class SoftwareRenderer
+{
+public:
+	static const int kTileSize = 64;
+
+	SoftwareRenderer(int _width, int _height);
+	~SoftwareRenderer();
+
+	// Starts a frame, every draw until Flush is seen through _viewProjection
+	void Begin(const glm::mat4& _viewProjection, glm::vec3 _clearColor);
+	// Indexed triangles with depth testing, the arrays must stay alive until Flush
+	void DrawMesh(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const glm::mat4& _model, const SoftwareMaterial& _material);
+	// Alpha blended glyph quads from a TextRenderer layout over a 1 channel atlas, composited after the meshes
+	void DrawText(const TextLayout& _layout, const SoftwareTexture* _atlas, glm::vec3 _color, FontRenderMode _mode);
+	// Renders everything recorded since Begin into the frame
+	void Flush();
+
+	void setThreadCount(unsigned int _threadCount);
+
+	int getWidth() const;
+	int getHeight() const;
+	const std::vector<uint32_t>& getColorBuffer() const;
+	const std::vector<float>& getDepthBuffer() const;
+	const SoftwareStats& getStats() const;
+	// Binary PPM, top row first
+	bool WriteImage(const std::string& _fileName) const;
+
+	// Loads an image as 3 channels the way TextureLoader does
+	static bool LoadTexture(const std::string& _fileName, SoftwareTexture& texture);
+	// Renders tessellated spheres from 10k to 1M triangles on 1 to every core and prints the frame times
+	static void Benchmark(int _iterations);
+
+private:
+	struct DrawCommand
+	{
+		const Vertex*		Vertices;
+		size_t				VertexCount;
+		const uint32_t*		Indices;
+		size_t				TriangleCount;
+		glm::mat4			Model;
+		SoftwareMaterial	Material;
+		size_t				FirstVertex;	// into transformed
+		size_t				FirstTriangle;	// across every draw of the frame
+	};
+
+	struct TransformedVertex
+	{
+		glm::vec4	Clip;
+		glm::vec3	World;
+		glm::vec3	Normal;
+		glm::vec2	UV;
+	};
+
+	static const int kAttributeCount = 8;	// world position, normal, uv
+
+	// Screen space triangle with everything the tile loop needs
+	struct SetupTriangle
+	{
+		float		EdgeA[3];		// E = A * x + B * y + C, >= 0 inside, edge i is opposite vertex (i + 2) % 3
+		float		EdgeB[3];
+		float		EdgeC[3];
+		float		InverseArea;
+		float		Z[3];			// 0..1 depth, linear in screen space
+		float		InverseW[3];
+		float		Attributes[3][kAttributeCount];	// divided by w for perspective correct interpolation
+		int			MinX, MaxX;
+		int			MinY, MaxY;
+		uint32_t	Draw;
+	};
+
+	struct TextQuad
+	{
+		glm::vec2				Min;		// pixels
+		glm::vec2				Max;
+		glm::vec2				UVMin;		// at Min
+		glm::vec2				UVMax;		// at Max
+		glm::vec3				Color;
+		const SoftwareTexture*	Atlas;
+		FontRenderMode			Mode;
+	};
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+
+	std::vector<uint32_t> colorBuffer;
+	std::vector<float> depthBuffer;
+
+	glm::mat4 viewProjection;
+	uint32_t clearColor;
+
+	std::vector<DrawCommand> draws;
+	std::vector<TextQuad> textQuads;
+	std::vector<TransformedVertex> transformed;
+
+	// Per setup worker, bins keep submission order because workers own consecutive triangle ranges
+	std::vector<std::vector<SetupTriangle>> triangles;
+	std::vector<std::vector<std::vector<uint32_t>>> bins;
+
+	unsigned int threadCount;
+	SoftwareStats stats;
+
+	void TransformVertices(size_t _first, size_t _last);
+	void SetupTriangles(unsigned int _worker, size_t _first, size_t _last);
+	void AddTriangle(unsigned int _worker, const TransformedVertex* _vertices[3], uint32_t _draw);
+	void ShadeTiles(std::atomic<int>* _nextTile);
+	void RasterizeTriangle(const SetupTriangle& _triangle, int _minX, int _maxX, int _minY, int _maxY);
+	void DrawTextQuad(const TextQuad& _quad, int _minX, int _maxX, int _minY, int _maxY);
+	uint32_t ShadePixel(const SetupTriangle& _triangle, float _b0, float _b1, float _b2) const;
+};
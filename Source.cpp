@@ -3,23 +3,46 @@
 #include <GLFW/glfw3.h>
 #include <btBulletDynamicsCommon.h>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
 
 #include "Camera.h"
+#include "CookedMesh.h"
+#include "ClusteredLighting.h"
+#include "CommandBuffer.h"
 #include "LightRenderer.h"
+#include "MeshOptimizer.h"
 #include "MeshRenderer.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "SoftwareRenderer.h"
 #include "TextRenderer.h"
+#include "FontCache.h"
+#include "UIBatcher.h"
+#include "VertexLayout.h"
+#include "Loader.h"
+#include "ProceduralMesh.h"
 #include "ShaderLoader.h"
 #include "TextureLoader.h"
+#include "TextureStreamer.h"
+
+#include "GLCallStats.h"
 
 bool bIsGrounded;
 bool bIsGameOver;
+bool bShowGLStats;
 
 int score;
 
 GLuint flatShaderProgram;
 GLuint litTexturedShaderProgram;
+GLuint litTexturedPackedShaderProgram;
 GLuint textureShaderProgram;
 GLuint textProgram;
+GLuint textSDFProgram;
+GLuint uiTextProgram;
+GLuint uiTextSDFProgram;
 GLuint sphereMeshTexture;
 GLuint groundMeshTexture;
 
@@ -34,56 +57,222 @@ MeshRenderer* sphereMesh;
 MeshRenderer* groundMesh;
 MeshRenderer* enemyMesh;
 TextRenderer* scoreText;
-
+TextRenderer* glStatsText;
+UIBatcher* uiBatcher;
+TextureStreamer* textureStreamer;
+ShaderLoader* shaderLoader;
+ClusteredLighting* clusteredLighting;
+OcclusionCuller* occlusionCuller;
+
+// Scene draws are recorded into these, one per recording thread, then replayed in order
+std::vector<CommandBuffer> sceneCommands;
+GLCommandExecutor sceneExecutor;
+unsigned int recordThreadCount = 1;
+
+// Where a Chrome trace of the profiler zones goes, see --profile and the T key
+std::string traceFileName = "profile.json";
+
+// Headless run through the CPU rasterizer, see --software. The meshes are kept on the CPU instead of in MeshRenderers
+SoftwareRenderer* softwareRenderer;
+SoftwareTexture sphereSoftwareTexture;
+SoftwareTexture groundSoftwareTexture;
+SoftwareTexture fontSoftwareTexture;
+std::vector<Vertex> sphereVertices;
+std::vector<uint32_t> sphereIndices;
+std::vector<Vertex> cubeVertices;
+std::vector<uint32_t> cubeIndices;
+
+// Shared by the GL renderers and the software path so both draw the same scene
+const glm::vec3 kLightPosition(0.0f, 10.0f, 0.0f);
+const glm::vec3 kGroundScale(4.0f, 0.5f, 4.0f);
+const float kMeshSpecularStrength = 0.1f;
+const float kMeshAmbientStrength = 0.5f;
+
+// Built-ins cooked ahead of time are mapped from here, e.g. OpenGLProject --cook sphere Assets/Meshes/sphere.cmesh
+const std::string kCookedSphereFile = "Assets/Meshes/sphere.cmesh";
+const std::string kCookedCubeFile = "Assets/Meshes/cube.cmesh";
+
+void AddMeshRenderers();
+void AddPointLights();
 void AddRigidBodies();
 void AddUIText();
+MeshRenderer* CreateMeshRenderer(MeshType _meshType, std::string _cookedMeshFile, btRigidBody* _rigidBody, std::string _name);
+void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void HandleCollisions();
 void InitGame();
 void InitPhysics();
 void RenderScene();
+void RenderSceneSoftware();
+bool RunSoftware(std::string _fileName, int _frames);
 void TickCallback(btDynamicsWorld* dynamicsWorld, btScalar timeStep);
 void UpdateKeyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 int main(int argc, char **argv)
 {
+	// Headless mesh import benchmark: OpenGLProject --bench-loader <file.obj|file.glb>
+	if (argc >= 3 && std::string(argv[1]) == "--bench-loader")
+	{
+		Loader::Benchmark(argv[2], 5);
+		return 0;
+	}
+
+	// Headless generator benchmark: OpenGLProject --bench-procedural [vertex count]
+	if (argc >= 2 && std::string(argv[1]) == "--bench-procedural")
+	{
+		ProceduralMesh::Benchmark(argc >= 3 ? std::stoul(argv[2]) : 1000000, 5);
+		return 0;
+	}
+
+	// Headless light binning benchmark: OpenGLProject --bench-clusters
+	if (argc >= 2 && std::string(argv[1]) == "--bench-clusters")
+	{
+		ClusteredLighting::Benchmark(10);
+		return 0;
+	}
+
+	// Headless submission overhead benchmark: OpenGLProject --bench-commands [draw count]
+	if (argc >= 2 && std::string(argv[1]) == "--bench-commands")
+	{
+		CommandBuffer::Benchmark(argc >= 3 ? std::stoul(argv[2]) : 10000, 10);
+		return 0;
+	}
+
+	// Headless CPU rasterizer benchmark: OpenGLProject --bench-software
+	if (argc >= 2 && std::string(argv[1]) == "--bench-software")
+	{
+		SoftwareRenderer::Benchmark(5);
+		return 0;
+	}
+
+	// Headless profiler overhead benchmark: OpenGLProject --bench-profiler
+	if (argc >= 2 && std::string(argv[1]) == "--bench-profiler")
+	{
+		Profiler::Benchmark(5);
+		return 0;
+	}
+
+	// Headless game through the CPU rasterizer, no window or GL context: OpenGLProject --software <file.ppm> [frames]
+	if (argc >= 3 && std::string(argv[1]) == "--software")
+	{
+		return RunSoftware(argv[2], argc >= 4 ? std::stoi(argv[3]) : 120) ? 0 : 1;
+	}
+
+	// Offline cook step: OpenGLProject --cook <file.obj|file.glb|triangle|quad|cube|sphere> <file.cmesh>
+	if (argc >= 4 && std::string(argv[1]) == "--cook")
+	{
+		const std::string kSource = argv[2];
+		bool bCooked = false;
+
+		if (kSource == "triangle") bCooked = CookedMesh::CookMeshType(kTriangle, argv[3]);
+		else if (kSource == "quad") bCooked = CookedMesh::CookMeshType(kQuad, argv[3]);
+		else if (kSource == "cube") bCooked = CookedMesh::CookMeshType(kCube, argv[3]);
+		else if (kSource == "sphere") bCooked = CookedMesh::CookMeshType(kSphere, argv[3]);
+		else bCooked = CookedMesh::CookFile(kSource, argv[3]);
+
+		std::cout << (bCooked ? "Cooked " : "Failed to cook ") << kSource << " -> " << argv[3] << std::endl;
+		return bCooked ? 0 : 1;
+	}
+
+	// GL call tallies per frame and scope, needs a GL_CALL_STATS build: OpenGLProject --gl-stats <file.csv>
+	if (argc >= 3 && std::string(argv[1]) == "--gl-stats")
+	{
+		GLCallStats::OpenLog(argv[2]);
+	}
+
+	// Chrome trace of the whole run, written on exit: OpenGLProject --profile <file.json>
+	const bool kProfile = argc >= 3 && std::string(argv[1]) == "--profile";
+	if (kProfile)
+	{
+		traceFileName = argv[2];
+	}
+
 	// Init GLFW
 	glfwInit();
 	
 	GLFWwindow* window = glfwCreateWindow(800, 600, "Hello OpenGL", NULL, NULL);
 	glfwMakeContextCurrent(window);
 	glfwSetKeyCallback(window, UpdateKeyboard);
+	glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
 
 	// Init GLEW
 	glewInit();
 
+	Profiler::setThreadName("Main");
+	Profiler::InitGpu();
+
 	// Init Game
 	InitGame();
 
+	// The framebuffer can differ from the window size, on high DPI displays for one
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	FramebufferSizeCallback(window, framebufferWidth, framebufferHeight);
+
+	if (kProfile) {
+		Profiler::BeginCapture();
+	}
+
 	// Start Game Clock
 	std::chrono::high_resolution_clock::time_point previousTime = std::chrono::high_resolution_clock::now();
 
 	while (!glfwWindowShouldClose(window)) {
-		// Handle Frame Tick
-		std::chrono::high_resolution_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
-		float dt = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - previousTime).count();
-		dynamicsWorld->stepSimulation(dt);
-		previousTime = currentTime;
+		GLCallStats::BeginFrame();
+		FontCache::BeginFrame();
 
-		RenderScene();
+		{
+			Profiler::Zone frameZone("Frame");
+
+			// Handle Frame Tick
+			std::chrono::high_resolution_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
+			float dt = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - previousTime).count();
+			{
+				Profiler::Zone zone("stepSimulation");
+				dynamicsWorld->stepSimulation(dt);
+			}
+			previousTime = currentTime;
+
+			{
+				Profiler::GpuZone gpuZone("RenderScene");
+				RenderScene();
+			}
+
+			// render our scene
+			{
+				Profiler::Zone zone("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			glfwPollEvents();
+		}
 
-		// render our scene
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		GLCallStats::EndFrame();
+		Profiler::EndFrame();
 	}
 
-	glfwTerminate();
+	GLCallStats::CloseLog();
+	if (Profiler::isCapturing()) {
+		Profiler::EndCapture(traceFileName);
+	}
+	Profiler::ShutdownGpu();
 
-	delete camera;
+	// Everything owning GL objects goes while the context is still alive, still pending programs need it to finish
+	delete shaderLoader;
 	delete light;
 	delete sphereMesh;
 	delete groundMesh;
 	delete enemyMesh;
+	delete clusteredLighting;
 	delete scoreText;
+	delete glStatsText;
+	delete uiBatcher;
+	FontCache::Clear();
+	VertexArrayCache::Clear();
+	delete textureStreamer;
+
+	glfwTerminate();
+
+	delete camera;
+	delete occlusionCuller;
 	delete sphereRigidBody;
 	delete groundRigidBody;
 	delete enemyRigidBody;
@@ -109,16 +298,8 @@ void AddRigidBodies()
 	sphereRigidBody->setActivationState(DISABLE_DEACTIVATION);
 	dynamicsWorld->addRigidBody(sphereRigidBody);
 
-	// Create Sphere Mesh
-	sphereMesh = new MeshRenderer(MeshType::kSphere, camera, sphereRigidBody, "hero", light, 0.1f, 0.5f);
-	sphereMesh->setProgram(litTexturedShaderProgram);
-	sphereMesh->setTexture(sphereMeshTexture);
-	sphereMesh->setScale(glm::vec3(1.0f));
-	
-	sphereRigidBody->setUserPointer(sphereMesh);
-
 	// Create Ground Rigid Body
-	btCollisionShape* groundShape = new btBoxShape(btVector3(4.0f, 0.5f, 4.0f));
+	btCollisionShape* groundShape = new btBoxShape(btVector3(kGroundScale.x, kGroundScale.y, kGroundScale.z));
 	btDefaultMotionState* groundMotionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, -1.0f, 0)));
 
 	btRigidBody::btRigidBodyConstructionInfo groundRigidBodyCI(0.0f, groundMotionState, groundShape, btVector3(0, 0, 0));
@@ -129,14 +310,6 @@ void AddRigidBodies()
 
 	dynamicsWorld->addRigidBody(groundRigidBody);
 
-	// Create Ground Mesh
-	groundMesh = new MeshRenderer(MeshType::kCube, camera, groundRigidBody, "ground", light, 0.1f, 0.5f);
-	groundMesh->setProgram(litTexturedShaderProgram);
-	groundMesh->setTexture(groundMeshTexture);
-	groundMesh->setScale(glm::vec3(4.0f, 0.5f, 4.0f));
-
-	groundRigidBody->setUserPointer(groundMesh);
-	
 	// Create Enemy Rigid Body
 	btCollisionShape* enemyShape = new btBoxShape(btVector3(1.0f, 1.0f, 1.0f));
 	btDefaultMotionState* enemyMotionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(18, 1.0f, 0)));
@@ -150,23 +323,109 @@ void AddRigidBodies()
 
 	dynamicsWorld->addRigidBody(enemyRigidBody);
 
+	return;
+}
+
+void AddMeshRenderers()
+{
+	// Create Sphere Mesh
+	// Packing, LODs and meshlets need the vertices on the CPU, a cooked sphere skips them and draws unpacked
+	sphereMesh = CreateMeshRenderer(MeshType::kSphere, kCookedSphereFile, sphereRigidBody, "hero");
+	sphereMesh->PackVertices();
+	sphereMesh->BuildLods();
+	sphereMesh->BuildMeshlets();
+	sphereMesh->setProgram(sphereMesh->isPacked() ? litTexturedPackedShaderProgram : litTexturedShaderProgram);
+	sphereMesh->setTexture(sphereMeshTexture);
+	sphereMesh->setScale(glm::vec3(1.0f));
+	
+	sphereRigidBody->setUserPointer(sphereMesh);
+
+	// Create Ground Mesh
+	groundMesh = CreateMeshRenderer(MeshType::kCube, kCookedCubeFile, groundRigidBody, "ground");
+	groundMesh->setProgram(litTexturedShaderProgram);
+	groundMesh->setTexture(groundMeshTexture);
+	groundMesh->setScale(kGroundScale);
+	groundMesh->BuildMeshlets();
+
+	groundRigidBody->setUserPointer(groundMesh);
+
 	// Create Enemy Mesh
-	enemyMesh = new MeshRenderer(MeshType::kCube, camera, enemyRigidBody, "enemy", light, 0.1f, 0.5f);
+	enemyMesh = CreateMeshRenderer(MeshType::kCube, kCookedCubeFile, enemyRigidBody, "enemy");
 	enemyMesh->setProgram(litTexturedShaderProgram);
 	enemyMesh->setTexture(groundMeshTexture);
 	enemyMesh->setScale(glm::vec3(1.0f, 1.0f, 1.0f));
+	enemyMesh->BuildLods();
 
 	enemyRigidBody->setUserPointer(enemyMesh);
 
 	return;
 }
 
+// Maps the cooked file straight to the GPU when there is one, otherwise generates the built-in mesh.
+// A stale or broken cooked file is reported by CookedMesh and falls back the same way.
+MeshRenderer* CreateMeshRenderer(MeshType _meshType, std::string _cookedMeshFile, btRigidBody* _rigidBody, std::string _name)
+{
+	if (std::ifstream(_cookedMeshFile).good()) {
+		MeshRenderer* cooked = new MeshRenderer(_cookedMeshFile, camera, _rigidBody, _name, light, kMeshSpecularStrength, kMeshAmbientStrength);
+		if (cooked->isLoaded()) {
+			std::cout << "Mesh : " << _name << " mapped from " << _cookedMeshFile << std::endl;
+			return cooked;
+		}
+		delete cooked;
+	}
+
+	return new MeshRenderer(_meshType, camera, _rigidBody, _name, light, kMeshSpecularStrength, kMeshAmbientStrength);
+}
+
+void AddPointLights()
+{
+	clusteredLighting = new ClusteredLighting();
+
+	// Ring of small colored lights around the ground, the lit meshes pick them up through their cluster
+	const int kLightCount = 64;
+	for (int i = 0; i < kLightCount; i++) {
+		const float kAngle = i * 6.2831853f / kLightCount;
+		const float kDistance = 3.0f + (i % 4) * 4.0f;
+
+		PointLight pointLight;
+		pointLight.Position = glm::vec3(std::cos(kAngle) * kDistance, 0.5f, std::sin(kAngle) * kDistance);
+		pointLight.Radius = 3.0f;
+		pointLight.Color = glm::vec3(0.5f + 0.5f * std::cos(kAngle), 0.5f + 0.5f * std::sin(kAngle), 1.0f - 0.5f * std::cos(kAngle));
+		pointLight.Intensity = 2.0f;
+		clusteredLighting->AddLight(pointLight);
+	}
+
+	MeshRenderer::setClusteredLighting(clusteredLighting);
+
+	return;
+}
+
 void AddUIText()
 {
 	// Create Score Text
-	scoreText = new TextRenderer("Score: 0", "Assets/fonts/gooddog.ttf", 64, glm::vec3(1.0f, 0.0f, 0.0f), textProgram);
+	scoreText = new TextRenderer("Score: 0", "Assets/fonts/gooddog.ttf", 64, glm::vec3(1.0f, 0.0f, 0.0f), textSDFProgram, FontRenderMode::kSDF);
 	scoreText->setPosition(glm::vec2(320.0f, 500.0f));
 
+	// Debug overlay of the last frame's GL calls
+	glStatsText = new TextRenderer("", "Assets/fonts/gooddog.ttf", 18, glm::vec3(1.0f, 1.0f, 0.0f), textProgram, FontRenderMode::kBitmap);
+	glStatsText->setPosition(glm::vec2(10.0f, 580.0f));
+
+	// Every label is drawn through the batcher in one pass, headless runs draw them through the software renderer
+	if (!FontCache::isHeadless()) {
+		uiBatcher = new UIBatcher(uiTextProgram, uiTextSDFProgram);
+	}
+
+	return;
+}
+
+void FramebufferSizeCallback(GLFWwindow* /*window*/, int width, int height)
+{
+	glViewport(0, 0, width, height);
+	TextRenderer::setViewportSize(glm::vec2(width, height));
+	MeshRenderer::setViewportHeight(static_cast<float>(height));
+	TextureStreamer::setViewportHeight(static_cast<GLfloat>(height));
+	ClusteredLighting::setViewportSize(glm::vec2(width, height));
+
 	return;
 }
 
@@ -176,28 +435,41 @@ void InitGame()
 
 	InitPhysics();
 
-	ShaderLoader shader;
-	// Create Shaders
-	flatShaderProgram = shader.CreateProgram("Assets/Shaders/FlatModel.vs", "Assets/Shaders/FlatModel.fs");
-	litTexturedShaderProgram = shader.CreateProgram("Assets/Shaders/LitTexturedModel.vs", "Assets/Shaders/LitTexturedModel.fs");
-	textureShaderProgram = shader.CreateProgram("Assets/Shaders/TexturedModel.vs", "Assets/Shaders/TexturedModel.fs");
-	textProgram = shader.CreateProgram("Assets/Shaders/text.vs", "Assets/Shaders/text.fs");
-
-	TextureLoader textureLoader;
+	// Create Shaders, all submitted up front so they compile in parallel while the rest loads
+	shaderLoader = new ShaderLoader();
+	flatShaderProgram = shaderLoader->SubmitProgram("Assets/Shaders/FlatModel.vs", "Assets/Shaders/FlatModel.fs");
+	// Lit variants only pay for the features their material uses, the hero ball is the only shiny one
+	litTexturedShaderProgram = shaderLoader->getVariant("Assets/Shaders/LitTexturedModel.vs", "Assets/Shaders/LitTexturedModel.fs", kShaderFeatureTexture | kShaderFeatureClustered);
+	litTexturedPackedShaderProgram = shaderLoader->getVariant("Assets/Shaders/LitTexturedModelPacked.vs", "Assets/Shaders/LitTexturedModel.fs", kShaderFeatureTexture | kShaderFeatureSpecular | kShaderFeatureClustered);
+	textureShaderProgram = shaderLoader->SubmitProgram("Assets/Shaders/TexturedModel.vs", "Assets/Shaders/TexturedModel.fs");
+	textProgram = shaderLoader->SubmitProgram("Assets/Shaders/text.vs", "Assets/Shaders/text.fs");
+	textSDFProgram = shaderLoader->SubmitProgram("Assets/Shaders/text.vs", "Assets/Shaders/textSDF.fs");
+	uiTextProgram = shaderLoader->SubmitProgram("Assets/Shaders/uiText.vs", "Assets/Shaders/uiText.fs");
+	uiTextSDFProgram = shaderLoader->SubmitProgram("Assets/Shaders/uiText.vs", "Assets/Shaders/uiTextSDF.fs");
+
+	// Texture Streamer, only the low mips are resident until the meshes ask for more
+	textureStreamer = new TextureStreamer(64 * 1024 * 1024);
 	// Sphere Texture Loader
-	sphereMeshTexture = textureLoader.getTexture("Assets/Textures/tennisBall.jpg");
+	sphereMeshTexture = textureStreamer->getTexture("Assets/Textures/tennisBall.jpg");
 	// Ground Texture Loader
-	groundMeshTexture = textureLoader.getTexture("Assets/Textures/ground.jpg");
+	groundMeshTexture = textureStreamer->getTexture("Assets/Textures/ground.jpg");
 	
+	// Post transform cache stats of the built-in meshes, cooked meshes print theirs when cooked
+	MeshOptimizer::PrintBuiltinStats();
+
 	camera = new Camera(45.0f, 800, 600, 0.1f, 100.0f, glm::vec3(0.0f, 4.0f, 30.0f));
 
 	light = new LightRenderer(MeshType::kCube, camera);
 	light->setProgram(flatShaderProgram);
-	light->setPosition(glm::vec3(0.0f, 10.0f, 0.0f));
+	light->setPosition(kLightPosition);
 
 	AddRigidBodies();
+	AddMeshRenderers();
+	AddPointLights();
 	AddUIText();
 
+	occlusionCuller = new OcclusionCuller();
+
 	return;
 }
 
@@ -219,21 +491,193 @@ void InitPhysics()
 
 void RenderScene()
 {
+	Profiler::Zone renderZone("RenderScene");
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glClearColor(0.0, 0.0, 0.0, 1.0);//clear yellow
+
+	// Nothing is drawn until every program has finished linking
+	if (!shaderLoader->Update()) {
+		return;
+	}
+
+	// Stream texture mips for what is on screen
+	textureStreamer->ReportUsage(sphereMesh->getTexture(), sphereMesh->getWorldPosition(), sphereMesh->getBoundingRadius());
+	textureStreamer->ReportUsage(groundMesh->getTexture(), groundMesh->getWorldPosition(), groundMesh->getBoundingRadius());
+	textureStreamer->ReportUsage(enemyMesh->getTexture(), enemyMesh->getWorldPosition(), enemyMesh->getBoundingRadius());
+	{
+		GLCallStats::Scope scope("TextureStreamer");
+		Profiler::Zone zone("TextureStreamer");
+		textureStreamer->Update(camera);
+	}
+
+	// Lights are binned against this frame's camera before anything lit is drawn
+	{
+		GLCallStats::Scope scope("ClusteredLighting");
+		Profiler::Zone zone("ClusteredLighting");
+		clusteredLighting->Update(camera);
+	}
 	
+	// The ground and the enemy block are big enough to hide things, every mesh is tested against them
+	MeshRenderer* const kMeshes[3] = { sphereMesh, groundMesh, enemyMesh };
+	std::vector<uint8_t> visible;
+	{
+		Profiler::Zone zone("OcclusionCuller");
+		occlusionCuller->Begin(camera->GetProjectionMatrix() * camera->GetViewMatrix());
+		occlusionCuller->AddOccluder(groundMesh->GetModelMatrix());
+		occlusionCuller->AddOccluder(enemyMesh->GetModelMatrix());
+		occlusionCuller->Rasterize();
+
+		std::vector<OcclusionBounds> bounds(3);
+		for (int i = 0; i < 3; i++) {
+			const glm::vec3 kRadius(kMeshes[i]->getBoundingRadius());
+			bounds[i].Min = kMeshes[i]->getWorldPosition() - kRadius;
+			bounds[i].Max = kMeshes[i]->getWorldPosition() + kRadius;
+		}
+		occlusionCuller->Test(bounds, visible);
+	}
+
 	// Draw game objects here
 	//light->Draw();
-	sphereMesh->Draw();
-	groundMesh->Draw();
-	enemyMesh->Draw();
+	std::vector<MeshRenderer*> drawn;
+	for (int i = 0; i < 3; i++) {
+		if (visible[i]) {
+			drawn.push_back(kMeshes[i]);
+		}
+	}
+
+	CommandBuffer::RecordParallel(sceneCommands, drawn.size(), recordThreadCount, [&drawn](CommandBuffer& _commands, size_t _first, size_t _last) {
+		Profiler::Zone zone("RecordMeshes");
+		for (size_t i = _first; i < _last; i++) {
+			drawn[i]->Record(_commands);
+		}
+	});
+	{
+		GLCallStats::Scope scope("MeshRenderer");
+		Profiler::Zone zone("MeshRenderer");
+		Profiler::GpuZone gpuZone("MeshRenderer");
+		sceneExecutor.ResetStats();
+		sceneExecutor.ExecuteAll(sceneCommands);
+	}
 	
 	// Drawn last because of alpha blending
-	scoreText->Draw();
+	GLCallStats::Scope scope("UIBatcher");
+	Profiler::GpuZone gpuZone("UIBatcher");
+	uiBatcher->Begin();
+	uiBatcher->AddText(scoreText);
+	if (bShowGLStats) {
+		glStatsText->setText(GLCallStats::getOverlayText());
+		uiBatcher->AddText(glStatsText);
+	}
+	uiBatcher->Flush();
+
+	return;
+}
+
+void RenderSceneSoftware()
+{
+	Profiler::Zone renderZone("RenderSceneSoftware");
+
+	softwareRenderer->Begin(camera->GetProjectionMatrix() * camera->GetViewMatrix(), glm::vec3(0.0f));
+
+	// The single light LitTexturedModel.fs shades with, the clustered point lights stay GL only
+	SoftwareMaterial material;
+	material.LightPosition = kLightPosition;
+	material.LightColor = glm::vec3(1.0f);
+	material.CameraPosition = camera->GetCameraPosition();
+	material.AmbientStrength = kMeshAmbientStrength;
+	material.SpecularStrength = kMeshSpecularStrength;
+
+	// Only the hero's program variant has FEATURE_SPECULAR
+	material.Texture = &sphereSoftwareTexture;
+	material.bSpecular = true;
+	softwareRenderer->DrawMesh(sphereVertices, sphereIndices, MeshRenderer::GetModelMatrix(sphereRigidBody, glm::vec3(1.0f)), material);
+
+	material.Texture = &groundSoftwareTexture;
+	material.bSpecular = false;
+	softwareRenderer->DrawMesh(cubeVertices, cubeIndices, MeshRenderer::GetModelMatrix(groundRigidBody, kGroundScale), material);
+	softwareRenderer->DrawMesh(cubeVertices, cubeIndices, MeshRenderer::GetModelMatrix(enemyRigidBody, glm::vec3(1.0f)), material);
+
+	// Laying out rasterizes any new glyphs, so the atlas is copied after it. A copy a frame is small next to shading
+	Font* font = scoreText->getFont();
+	if (font) {
+		const TextLayout& kLayout = scoreText->getLayout();
+		fontSoftwareTexture.Width = font->getAtlasSize();
+		fontSoftwareTexture.Height = font->getAtlasSize();
+		fontSoftwareTexture.Channels = 1;
+		fontSoftwareTexture.Pixels = font->getAtlasPixels();
+		softwareRenderer->DrawText(kLayout, &fontSoftwareTexture, scoreText->getColor(), font->getMode());
+	}
+
+	softwareRenderer->Flush();
 
 	return;
 }
 
+bool RunSoftware(std::string _fileName, int _frames)
+{
+	Profiler::setThreadName("Main");
+
+	// Nothing below may touch GL, there is no context
+	FontCache::setHeadless(true);
+
+	InitPhysics();
+
+	camera = new Camera(45.0f, 800, 600, 0.1f, 100.0f, glm::vec3(0.0f, 4.0f, 30.0f));
+
+	AddRigidBodies();
+	AddUIText();
+
+	// Same data the MeshRenderers upload, and the full resolution textures the streamer would end up with
+	Mesh::SetSphereData(sphereVertices, sphereIndices);
+	Mesh::SetCubeData(cubeVertices, cubeIndices);
+	const bool kLoaded =
+		SoftwareRenderer::LoadTexture("Assets/Textures/tennisBall.jpg", sphereSoftwareTexture) &&
+		SoftwareRenderer::LoadTexture("Assets/Textures/ground.jpg", groundSoftwareTexture);
+
+	softwareRenderer = new SoftwareRenderer(800, 600);
+
+	// Fixed steps so every run renders the same frames
+	const float kTimeStep = 1.0f / 60.0f;
+	float renderMs = 0.0f;
+	for (int frame = 0; kLoaded && frame < _frames; frame++) {
+		FontCache::BeginFrame();
+
+		{
+			Profiler::Zone frameZone("Frame");
+			{
+				Profiler::Zone zone("stepSimulation");
+				dynamicsWorld->stepSimulation(kTimeStep);
+			}
+
+			RenderSceneSoftware();
+		}
+
+		Profiler::EndFrame();
+
+		const SoftwareStats& kStats = softwareRenderer->getStats();
+		renderMs += kStats.SetupMs + kStats.RasterMs;
+	}
+
+	const bool kWritten = kLoaded && softwareRenderer->WriteImage(_fileName);
+	if (kWritten) {
+		std::cout << "Software Renderer : " << _frames << " frames, " << renderMs / std::max(1, _frames) << " ms per frame on "
+			<< softwareRenderer->getStats().Threads << " threads, score " << score << ", last frame written to " << _fileName << std::endl;
+	}
+
+	delete softwareRenderer;
+	delete camera;
+	delete scoreText;
+	delete glStatsText;
+	FontCache::Clear();
+	delete sphereRigidBody;
+	delete groundRigidBody;
+	delete enemyRigidBody;
+	delete dynamicsWorld;
+
+	return kWritten;
+}
+
 void TickCallback(btDynamicsWorld* dynamicsWorld, btScalar timeStep)
 {
 	if (bIsGameOver)
@@ -242,7 +686,7 @@ void TickCallback(btDynamicsWorld* dynamicsWorld, btScalar timeStep)
 	}
 
 	// Get enemy transform
-	btTransform enemyTransform(enemyMesh->getRigidBody()->getWorldTransform());
+	btTransform enemyTransform(enemyRigidBody->getWorldTransform());
 	// Set enemy position
 	enemyTransform.setOrigin(enemyTransform.getOrigin() + btVector3(-15, 0, 0) * timeStep);
 	// Check if offScreen
@@ -252,14 +696,16 @@ void TickCallback(btDynamicsWorld* dynamicsWorld, btScalar timeStep)
 		scoreText->setText("Score: " + std::to_string(++score));
 	}
 
-	enemyMesh->getRigidBody()->setWorldTransform(enemyTransform);
-	enemyMesh->getRigidBody()->getMotionState()->setWorldTransform(enemyTransform);
+	enemyRigidBody->setWorldTransform(enemyTransform);
+	enemyRigidBody->getMotionState()->setWorldTransform(enemyTransform);
 
 	HandleCollisions();
 }
 
 void HandleCollisions()
 {
+	Profiler::Zone zone("HandleCollisions");
+
 	const int kNumManifolds = dynamicsWorld->getDispatcher()->getNumManifolds();
 
 	for (int i = 0; i < kNumManifolds; i++)
@@ -267,36 +713,20 @@ void HandleCollisions()
 		btPersistentManifold* contactManifold = dynamicsWorld->getDispatcher()->getManifoldByIndexInternal(i);
 		const int kNumContacts = contactManifold->getNumContacts();
 		if (kNumContacts > 0) {
+			// Bodies are told apart directly, headless runs have no MeshRenderer behind them
 			const btCollisionObject* objA = contactManifold->getBody0();
 			const btCollisionObject* objB = contactManifold->getBody1();
-			MeshRenderer* gModA = (MeshRenderer*)objA->getUserPointer();
-			MeshRenderer* gModB = (MeshRenderer*)objB->getUserPointer();
-			if (!gModA || !gModB)
-			{
-				continue;
-			}
 
 			// Player got hit
 			if (
-				(gModA->getName() == "hero" && gModB->getName() == "enemy") ||
-				(gModA->getName() == "enemy" && gModB->getName() == "hero")
+				(objA == sphereRigidBody && objB == enemyRigidBody) ||
+				(objA == enemyRigidBody && objB == sphereRigidBody)
 				)
 			{
-				//printf("collision: %s with %s \n", gModA->getName(), gModB->getName());
-
-				if (gModB->getName() == "enemy")
-				{
-					btTransform b(gModB->getRigidBody()->getWorldTransform());
-					b.setOrigin(btVector3(18, 1, 0));
-					gModB->getRigidBody()->setWorldTransform(b);
-					gModB->getRigidBody()->getMotionState()->setWorldTransform(b);
-				}
-				else {
-					btTransform a(gModA->getRigidBody()->getWorldTransform());
-					a.setOrigin(btVector3(18, 1, 0));
-					gModA->getRigidBody()->setWorldTransform(a);
-					gModA->getRigidBody()->getMotionState()->setWorldTransform(a);
-				}
+				btTransform enemyTransform(enemyRigidBody->getWorldTransform());
+				enemyTransform.setOrigin(btVector3(18, 1, 0));
+				enemyRigidBody->setWorldTransform(enemyTransform);
+				enemyRigidBody->getMotionState()->setWorldTransform(enemyTransform);
 
 				score = 0;
 				bIsGameOver = true;
@@ -305,14 +735,13 @@ void HandleCollisions()
 			}
 			// Player is on the floor
 			else if (
-				(gModA->getName() == "hero" && gModB->getName() == "ground") ||
-				(gModA->getName() == "ground" && gModB->getName() == "hero")
+				(objA == sphereRigidBody && objB == groundRigidBody) ||
+				(objA == groundRigidBody && objB == sphereRigidBody)
 				)
 			{
 				if (!bIsGrounded)
 				{
 					bIsGrounded = true;
-					//printf("collision: %s with %s \n", gModA->getName(), gModB->getName());
 				}
 			}
 		}
@@ -326,6 +755,60 @@ void UpdateKeyboard(GLFWwindow* window, int key, int scancode, int action, int m
 		return;
 	}
 
+	// Debug: dump what the occlusion culler saw last frame
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		const OcclusionStats& kStats = occlusionCuller->getStats();
+		std::cout << "Occlusion Culler : " << kStats.Culled << "/" << kStats.Tested << " culled, "
+			<< kStats.OccluderTriangles << " occluder triangles, raster " << kStats.RasterMs << " ms, test " << kStats.TestMs << " ms" << std::endl;
+		occlusionCuller->WriteDepthImage("occlusion.pgm");
+
+		// Meshlet culling of the last frame, for the meshes that were split into meshlets
+		MeshRenderer* const kMeshes[3] = { sphereMesh, groundMesh, enemyMesh };
+		for (int i = 0; i < 3; i++) {
+			const MeshletCullStats& kMeshletStats = kMeshes[i]->getMeshletStats();
+			if (kMeshletStats.Meshlets == 0) {
+				continue;
+			}
+			std::cout << "Meshlet Culling : " << kMeshes[i]->getName() << " " << kMeshletStats.FrustumCulled << " frustum and "
+				<< kMeshletStats.BackfaceCulled << " backface culled of " << kMeshletStats.Meshlets << " meshlets, "
+				<< kMeshletStats.TrianglesCulled << " triangles culled, " << kMeshletStats.TrianglesDrawn << " drawn in "
+				<< kMeshletStats.DrawCommands << " draws" << std::endl;
+		}
+	}
+
+	// Debug: show the GL calls of the last frame
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+	{
+		bShowGLStats = !bShowGLStats;
+	}
+
+	// Debug: print per-zone frame times
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		Profiler::PrintStatistics();
+	}
+
+	// Debug: start a Chrome trace, the second press writes it
+	if (key == GLFW_KEY_T && action == GLFW_PRESS)
+	{
+		if (Profiler::isCapturing()) {
+			Profiler::EndCapture(traceFileName);
+		}
+		else {
+			Profiler::BeginCapture();
+		}
+	}
+
+	// Debug: switch between recording the scene on this thread and on every core
+	if (key == GLFW_KEY_R && action == GLFW_PRESS)
+	{
+		recordThreadCount = (recordThreadCount == 1) ? WorkerPool::getShared().getThreadCount() : 1;
+		const CommandStats& kStats = sceneExecutor.getStats();
+		std::cout << "Command Buffer : recording on " << recordThreadCount << " threads, " << kStats.Commands << " commands, "
+			<< kStats.Draws << " draws, " << kStats.Redundant << " redundant binds last frame" << std::endl;
+	}
+
 	if (bIsGameOver)
 	{
 		if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
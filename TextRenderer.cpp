@@ -1,99 +1,92 @@
 #include "TextRenderer.h"
 
 #include <iostream>
+#include <algorithm>
 
-TextRenderer::TextRenderer(std::string _text, std::string _font, int _size, glm::vec3 _color, GLuint _program)
+#include "Profiler.h"
+
+#include "GLCallStats.h"
+
+// x, y, u, v for each of the 6 vertices of a glyph quad
+static const int kFloatsPerQuad = 6 * 4;
+// Layouts redone because the atlas was repacked part way through
+static const int kLayoutPasses = 2;
+
+glm::vec2 TextRenderer::viewportSize = glm::vec2(800.0f, 600.0f);
+
+// Decodes the next UTF-8 codepoint and advances _c past it, malformed bytes come out as U+FFFD
+static GLuint NextCodepoint(std::string::const_iterator& _c, std::string::const_iterator _end)
+{
+	const unsigned char kLead = static_cast<unsigned char>(*_c++);
+
+	int continuationBytes = 0;
+	GLuint codepoint = 0;
+	if (kLead < 0x80) {
+		return kLead;
+	}
+	else if ((kLead & 0xE0) == 0xC0) {
+		continuationBytes = 1;
+		codepoint = kLead & 0x1F;
+	}
+	else if ((kLead & 0xF0) == 0xE0) {
+		continuationBytes = 2;
+		codepoint = kLead & 0x0F;
+	}
+	else if ((kLead & 0xF8) == 0xF0) {
+		continuationBytes = 3;
+		codepoint = kLead & 0x07;
+	}
+	else {
+		return 0xFFFD;
+	}
+
+	for (int i = 0; i < continuationBytes; i++) {
+		if (_c == _end || (static_cast<unsigned char>(*_c) & 0xC0) != 0x80) {
+			return 0xFFFD;
+		}
+		codepoint = (codepoint << 6) | (static_cast<unsigned char>(*_c++) & 0x3F);
+	}
+
+	return codepoint;
+}
+
+TextRenderer::TextRenderer(std::string _text, std::string _font, int _size, glm::vec3 _color, GLuint _program, FontRenderMode _mode)
 {
 	this->text = _text;
 	this->color = _color;
 	this->scale = 1.0;
 	this->program = _program;
-	this->setPosition(position);
+	this->vboCapacity = 0;
+	this->bLayoutDirty = true;
+	this->bAtlasOverflow = false;
+	this->bVboDirty = true;
+	this->bVisible = true;
+	this->position = glm::vec2(0.0f, 0.0f);
 
-	glm::mat4 projection = glm::ortho(0.0f, static_cast<GLfloat>(800), 0.0f, static_cast<GLfloat>(600));
-	
-	glUseProgram(program);
-	glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	this->layout.QuadCount = 0;
+	this->layout.BoundsMin = glm::vec2(0.0f, 0.0f);
+	this->layout.BoundsMax = glm::vec2(0.0f, 0.0f);
+	this->layout.LineCount = 0;
 
-	// FreeType
-	FT_Library ft;
-	// Initialise freetype
-	if (FT_Init_FreeType(&ft))
-	{
-		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+	// Glyphs are rasterized by the shared font on first use
+	this->font = FontCache::getFont(_font, _size, _mode);
+	this->fontGeneration = 0;
+	this->fontScale = 1.0f;
+	if (this->font) {
+		this->fontScale = static_cast<GLfloat>(_size) / this->font->getPixelSize();
 	}
 
-	// Load font
-	FT_Face face;
-	if (FT_New_Face(ft, _font.c_str(), 0, &face))
-	{
-		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+	// Headless labels are only laid out, SoftwareRenderer::DrawText draws them from the layout
+	this->vao = 0;
+	this->vbo = 0;
+	if (FontCache::isHeadless()) {
+		return;
 	}
 
-	// Set size of glyphs
-	FT_Set_Pixel_Sizes(face, 0, _size);
-	// Disable byte-alignment restriction
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	for (GLubyte i = 0; i < 128; i++)
-	{
-		// Load character glyph
-		if (FT_Load_Char(face, i, FT_LOAD_RENDER))
-		{
-			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-				continue;
-		}
-		
-		// Generate texture
-		GLuint texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-		
-		// Set texture filtering options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		
-		// Create a character
-		Character character =
-		{
-			texture,
-			glm::ivec2(face->glyph->bitmap.width,
-			face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left,
-			face->glyph->bitmap_top),
-			face->glyph->advance.x
-		};
-
-		// Store character in characters map
-		characters.insert(std::pair<GLchar, Character>(i,
-			character));
-	}
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	// Destroy FreeType once we're finished
-	FT_Done_Face(face);
-	FT_Done_FreeType(ft);
-
 	glGenVertexArrays(1, &vao);
 	glGenBuffers(1, &vbo);
 	glBindVertexArray(vao);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
 
@@ -105,53 +98,46 @@ TextRenderer::TextRenderer(std::string _text, std::string _font, int _size, glm:
 
 TextRenderer::~TextRenderer()
 {
+	if (vao) {
+		glDeleteBuffers(1, &vbo);
+		glDeleteVertexArrays(1, &vao);
+	}
 }
 
 void TextRenderer::Draw()
 {
-	glm::vec2 textPos = this->position;
+	Profiler::Zone zone("TextRenderer::Draw");
+
+	if (!font || !vao) {
+		return;
+	}
+
+	UpdateLayout();
+
+	// Batched labels never need their own vbo, so it is only filled here
+	if (bVboDirty) {
+		UploadLayout();
+	}
+
+	if (!bVisible || layout.QuadCount == 0) {
+		return;
+	}
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+	// Projection follows the viewport so text keeps its pixel size when the window is resized
+	glm::mat4 projection = glm::ortho(0.0f, viewportSize.x, 0.0f, viewportSize.y);
+
 	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 	glUniform3f(glGetUniformLocation(program, "textColor"), this->color.x, this->color.y, this->color.z);
 	glActiveTexture(GL_TEXTURE0);
 
+	// Render every glyph quad from the atlas at once
+	glBindTexture(GL_TEXTURE_2D, font->getAtlas());
 	glBindVertexArray(vao);
-
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++) {
-		Character ch = characters[*c];
-		GLfloat xpos = textPos.x + ch.Bearing.x * this->scale;
-		GLfloat ypos = textPos.y - (ch.Size.y - ch.Bearing.y) * this->scale;
-		GLfloat w = ch.Size.x * this->scale;
-		GLfloat h = ch.Size.y * this->scale;
-		
-		// Per Character Update vbo
-		GLfloat vertices[6][4] =
-		{
-			{ xpos, ypos + h, 0.0, 0.0 },
-			{ xpos, ypos, 0.0, 1.0 },
-			{ xpos + w, ypos, 1.0, 1.0 },
-			{ xpos, ypos + h, 0.0, 0.0 },
-			{ xpos + w, ypos, 1.0, 1.0 },
-			{ xpos + w, ypos + h, 1.0, 0.0 }
-		};
-
-		// Render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// Update content of vbo memory
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		// Use glBufferSubData and not glBufferData
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// Render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		// Now advance cursors for next glyph (note that advance is number of 1 / 64 pixels)
-		// Bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1 / 64th pixels by 64 to get amount of pixels))
-		textPos.x += (ch.Advance >> 6) * this->scale;
-	}
+	glDrawArrays(GL_TRIANGLES, 0, layout.QuadCount * 6);
 
 	glBindVertexArray(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -162,12 +148,186 @@ void TextRenderer::Draw()
 
 void TextRenderer::setPosition(glm::vec2 _position)
 {
-	this->position = _position;
+	if (this->position != _position) {
+		this->position = _position;
+		this->bLayoutDirty = true;
+	}
 	return;
 }
 
 void TextRenderer::setText(std::string _text)
 {
-	this->text = _text;
+	if (this->text != _text) {
+		this->text = _text;
+		this->bLayoutDirty = true;
+		this->bAtlasOverflow = false;
+	}
+	return;
+}
+
+void TextRenderer::setScale(GLfloat _scale)
+{
+	if (this->scale != _scale) {
+		this->scale = _scale;
+		this->bLayoutDirty = true;
+	}
+	return;
+}
+
+void TextRenderer::setVisible(bool _bVisible)
+{
+	this->bVisible = _bVisible;
+	return;
+}
+
+void TextRenderer::setViewportSize(glm::vec2 _viewportSize)
+{
+	viewportSize = _viewportSize;
+	return;
+}
+
+glm::vec3 TextRenderer::getColor() const
+{
+	return color;
+}
+
+Font* TextRenderer::getFont() const
+{
+	return font;
+}
+
+bool TextRenderer::isVisible() const
+{
+	return bVisible;
+}
+
+glm::vec2 TextRenderer::getViewportSize()
+{
+	return viewportSize;
+}
+
+const TextLayout& TextRenderer::getLayout()
+{
+	if (font) {
+		UpdateLayout();
+	}
+	return layout;
+}
+
+// Private //
+
+void TextRenderer::UpdateLayout()
+{
+	// Glyphs evicted from the shared atlas invalidate the cached UVs. A layout still in use keeps its
+	// glyphs for the rest of the frame, so another label can't evict them after this one was batched
+	if (!bLayoutDirty && fontGeneration == font->getGeneration()) {
+		font->PinCells(layoutCells);
+		return;
+	}
+	bLayoutDirty = false;
+
+	const GLfloat kAscender = font->getAscender();
+	const GLfloat kDescender = font->getDescender();
+	const GLfloat kLineHeight = font->getLineHeight();
+	const GLfloat kScale = this->scale * this->fontScale;
+
+	// A glyph loaded below can evict others and repack the atlas, which moves glyphs already placed,
+	// so the generation is taken first and the string is laid out again if it changed. A string the
+	// atlas can't hold at once only uses the glyphs already resident from then on, so it never
+	// evicts and reloads glyphs again every frame.
+	GLuint generation = 0;
+	for (int pass = 0; pass < kLayoutPasses; pass++) {
+		generation = font->getGeneration();
+
+		glm::vec2 textPos = this->position;
+
+		// Build the quads of the whole string so it goes out in a single draw
+		layout.Quads.clear();
+		layout.Quads.reserve(text.size() * kFloatsPerQuad);
+		layoutCells.clear();
+		layout.BoundsMin = this->position + glm::vec2(0.0f, kDescender * kScale);
+		layout.BoundsMax = this->position + glm::vec2(0.0f, kAscender * kScale);
+		layout.LineCount = 1;
+
+		std::string::const_iterator c = text.begin();
+		while (c != text.end()) {
+			const GLuint kCodepoint = NextCodepoint(c, text.end());
+
+			// New lines go down one line height from the starting x
+			if (kCodepoint == '\n') {
+				textPos.x = this->position.x;
+				textPos.y -= kLineHeight * kScale;
+				layout.BoundsMin.y = textPos.y + kDescender * kScale;
+				layout.LineCount++;
+				continue;
+			}
+
+			const Character* glyph = bAtlasOverflow ? font->findGlyph(kCodepoint) : font->getGlyph(kCodepoint);
+			if (!glyph) {
+				if (!bAtlasOverflow && font->isFull()) {
+					std::cout << "Text Renderer : \"" << text << "\" needs more glyphs than the atlas holds, the rest are left out" << std::endl;
+					bAtlasOverflow = true;
+				}
+				continue;
+			}
+
+			// Copied since later lookups may evict it
+			const Character ch = *glyph;
+			if (ch.Cell >= 0) {
+				layoutCells.push_back(ch.Cell);
+			}
+			GLfloat xpos = textPos.x + ch.Bearing.x * kScale;
+			GLfloat ypos = textPos.y - (ch.Size.y - ch.Bearing.y) * kScale;
+			GLfloat w = ch.Size.x * kScale;
+			GLfloat h = ch.Size.y * kScale;
+
+			GLfloat vertices[kFloatsPerQuad] =
+			{
+				xpos, ypos + h, ch.UVMin.x, ch.UVMin.y,
+				xpos, ypos, ch.UVMin.x, ch.UVMax.y,
+				xpos + w, ypos, ch.UVMax.x, ch.UVMax.y,
+				xpos, ypos + h, ch.UVMin.x, ch.UVMin.y,
+				xpos + w, ypos, ch.UVMax.x, ch.UVMax.y,
+				xpos + w, ypos + h, ch.UVMax.x, ch.UVMin.y
+			};
+			layout.Quads.insert(layout.Quads.end(), vertices, vertices + kFloatsPerQuad);
+
+			// Now advance cursors for next glyph (note that advance is number of 1 / 64 pixels)
+			// Divided as a float rather than bitshifted by 6 so the fraction survives scaling a small SDF font up
+			textPos.x += (ch.Advance / 64.0f) * kScale;
+			layout.BoundsMax.x = glm::max(layout.BoundsMax.x, textPos.x);
+		}
+
+		layout.QuadCount = static_cast<GLsizei>(layout.Quads.size() / kFloatsPerQuad);
+
+		if (font->getGeneration() == generation) {
+			break;
+		}
+	}
+
+	fontGeneration = generation;
+	bVboDirty = true;
+
+	return;
+}
+
+void TextRenderer::UploadLayout()
+{
+	bVboDirty = false;
+	if (layout.QuadCount == 0) {
+		return;
+	}
+
+	// Update content of vbo memory, only reallocating when the string outgrows it
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	if (layout.QuadCount > vboCapacity) {
+		vboCapacity = layout.QuadCount;
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * layout.Quads.size(), &layout.Quads[0], GL_DYNAMIC_DRAW);
+	}
+	else {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * layout.Quads.size(), &layout.Quads[0]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
 	return;
 }
@@ -1,45 +1,74 @@
 #pragma once
 #include <string>
-#include <map>
+#include <vector>
 
 #include <GL/glew.h>
 #include "Dependencies/glm/glm/glm.hpp"
 #include "Dependencies/glm/glm/gtc/matrix_transform.hpp"
 #include "Dependencies/glm/glm/gtc/type_ptr.hpp"
-#include <ft2build.h>
-#include FT_FREETYPE_H
 
-struct Character
+#include "FontCache.h"
+
+struct TextLayout
 {
-	GLuint		TextureID;	// Texture ID of each glyph texture
-	glm::ivec2	Size;		// glyph Size
-	glm::ivec2	Bearing;	// baseline to left/top of glyph
-	GLuint		Advance;	// id to next glyph
+	std::vector<GLfloat>	Quads;		// x, y, u, v for the 6 vertices of each glyph
+	GLsizei					QuadCount;
+	glm::vec2				BoundsMin;	// bottom left of the laid out text
+	glm::vec2				BoundsMax;	// top right of the laid out text
+	GLuint					LineCount;
 };
 
 class TextRenderer
 {
 public:
-	TextRenderer(std::string _text, std::string _font, int _size, glm::vec3 _color, GLuint _program);
+	TextRenderer(std::string _text, std::string _font, int _size, glm::vec3 _color, GLuint _program, FontRenderMode _mode = kBitmap);
 	~TextRenderer();
 
 	void Draw();
 
+	static void setViewportSize(glm::vec2 _viewportSize);
+
 	void setPosition(glm::vec2 _position);
 	void setText(std::string _text);
+	void setScale(GLfloat _scale);
+	void setVisible(bool _bVisible);
+
+	const TextLayout& getLayout();
+	glm::vec3 getColor() const;
+	Font* getFont() const;
+	bool isVisible() const;
+
+	static glm::vec2 getViewportSize();
 
 private:
 	std::string text;
 
-	std::map<GLchar, Character> characters;
+	Font* font;	// shared with every other label of the same font and size
+	GLuint fontGeneration;	// font generation the layout was built against
 	
 	glm::vec3 color;
 	glm::vec2 position;
 
 	GLfloat scale;
+	GLfloat fontScale;	// requested size over the size the font was rasterized at
+
+	// Layout is only rebuilt after the text, position or scale change
+	TextLayout layout;
+	std::vector<GLint> layoutCells;	// atlas cells the layout samples, pinned every frame it is used
+	bool bLayoutDirty;
+	bool bAtlasOverflow;	// the text needs more glyphs than the atlas holds, the rest are left out until it changes
+	bool bVboDirty;
+	bool bVisible;
 	
 	GLuint vao;
 	GLuint vbo;
 	GLuint program;
+
+	GLsizei vboCapacity;	// in glyph quads
+
+	static glm::vec2 viewportSize;	// text is positioned in pixels of this viewport
+
+	void UpdateLayout();
+	void UploadLayout();
 };
 
@@ -0,0 +1,360 @@
+#include "TextureStreamer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "Dependencies/stb-master/stb_image.h"
+
+#include "GLCallStats.h"
+
+// Textures are uploaded as GL_RGB8
+static const size_t kBytesPerTexel = 3;
+// Mips at or below this size are uploaded on load and never evicted
+static const int kTailSize = 64;
+
+GLfloat TextureStreamer::viewportHeight = 600.0f;
+
+// Public //
+
+TextureStreamer::TextureStreamer(size_t _budgetBytes)
+{
+	this->budgetBytes = _budgetBytes;
+	this->uploadBytesPerUpdate = 4 * 1024 * 1024;
+	this->residentBytes = 0;
+
+	return;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (StreamedTexture& texture : textures) {
+		glDeleteTextures(1, &texture.TextureID);
+	}
+
+	return;
+}
+
+GLuint TextureStreamer::getTexture(std::string _textureFileName)
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+
+	stbi_uc* image = stbi_load(_textureFileName.c_str(), &width, &height, &channels, STBI_rgb);
+	if (!image) {
+		std::cout << "Texture Streamer : Can't read file " << _textureFileName << std::endl;
+		return 0;
+	}
+
+	StreamedTexture texture;
+
+	// Build the whole mip chain in system memory, finer levels are streamed from here
+	texture.LevelSizes.push_back(glm::ivec2(width, height));
+	texture.Levels.push_back(std::vector<unsigned char>(image, image + width * height * kBytesPerTexel));
+	stbi_image_free(image);
+
+	while (texture.LevelSizes.back().x > 1 || texture.LevelSizes.back().y > 1) {
+		const glm::ivec2 kSrcSize = texture.LevelSizes.back();
+		const glm::ivec2 kDstSize = glm::ivec2(std::max(kSrcSize.x / 2, 1), std::max(kSrcSize.y / 2, 1));
+		const std::vector<unsigned char>& src = texture.Levels.back();
+
+		std::vector<unsigned char> dst(kDstSize.x * kDstSize.y * kBytesPerTexel);
+		for (int y = 0; y < kDstSize.y; y++) {
+			const int y0 = std::min(y * 2, kSrcSize.y - 1);
+			const int y1 = std::min(y * 2 + 1, kSrcSize.y - 1);
+
+			for (int x = 0; x < kDstSize.x; x++) {
+				const int x0 = std::min(x * 2, kSrcSize.x - 1);
+				const int x1 = std::min(x * 2 + 1, kSrcSize.x - 1);
+
+				for (size_t c = 0; c < kBytesPerTexel; c++) {
+					const int sum =
+						src[(y0 * kSrcSize.x + x0) * kBytesPerTexel + c] +
+						src[(y0 * kSrcSize.x + x1) * kBytesPerTexel + c] +
+						src[(y1 * kSrcSize.x + x0) * kBytesPerTexel + c] +
+						src[(y1 * kSrcSize.x + x1) * kBytesPerTexel + c];
+					dst[(y * kDstSize.x + x) * kBytesPerTexel + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+
+		texture.LevelSizes.push_back(kDstSize);
+		texture.Levels.push_back(std::move(dst));
+	}
+
+	const GLint kLevelCount = (GLint)texture.Levels.size();
+
+	texture.TailLevel = kLevelCount - 1;
+	while (texture.TailLevel > 0 &&
+		texture.LevelSizes[texture.TailLevel - 1].x <= kTailSize &&
+		texture.LevelSizes[texture.TailLevel - 1].y <= kTailSize) {
+		texture.TailLevel--;
+	}
+	texture.ResidentLevel = kLevelCount;
+	texture.RequiredLevel = texture.TailLevel;
+	texture.TargetLevel = texture.TailLevel;
+
+	glGenTextures(1, &texture.TextureID);
+	glBindTexture(GL_TEXTURE_2D, texture.TextureID);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, kLevelCount - 1);
+
+	// Only the low mips are resident to begin with
+	for (GLint level = kLevelCount - 1; level >= texture.TailLevel; level--) {
+		UploadLevel(texture, level);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	textures.push_back(std::move(texture));
+
+	return textures.back().TextureID;
+}
+
+void TextureStreamer::ReportUsage(GLuint _texture, glm::vec3 _center, GLfloat _radius)
+{
+	TextureUsage usage = { _texture, _center, _radius };
+	usages.push_back(usage);
+
+	return;
+}
+
+void TextureStreamer::Update(const Camera* _camera)
+{
+	ComputeRequiredLevels(_camera);
+	FitTargetsToBudget();
+	StreamLevels();
+
+	usages.clear();
+
+	return;
+}
+
+void TextureStreamer::setBudget(size_t _budgetBytes)
+{
+	this->budgetBytes = _budgetBytes;
+	return;
+}
+
+void TextureStreamer::setUploadBudget(size_t _uploadBytesPerUpdate)
+{
+	this->uploadBytesPerUpdate = _uploadBytesPerUpdate;
+	return;
+}
+
+size_t TextureStreamer::getBudget() const
+{
+	return budgetBytes;
+}
+
+size_t TextureStreamer::getResidentBytes() const
+{
+	return residentBytes;
+}
+
+size_t TextureStreamer::getPendingRequests() const
+{
+	size_t pending = 0;
+	for (const StreamedTexture& texture : textures) {
+		if (texture.ResidentLevel > texture.TargetLevel) {
+			pending += texture.ResidentLevel - texture.TargetLevel;
+		}
+	}
+
+	return pending;
+}
+
+void TextureStreamer::setViewportHeight(GLfloat _viewportHeight)
+{
+	viewportHeight = _viewportHeight;
+	return;
+}
+
+// Private //
+
+StreamedTexture* TextureStreamer::FindTexture(GLuint _texture)
+{
+	for (StreamedTexture& texture : textures) {
+		if (texture.TextureID == _texture) {
+			return &texture;
+		}
+	}
+
+	return nullptr;
+}
+
+void TextureStreamer::ComputeRequiredLevels(const Camera* _camera)
+{
+	for (StreamedTexture& texture : textures) {
+		texture.RequiredLevel = texture.TailLevel;
+	}
+
+	// projection[1][1] is 1 / tan(fov / 2), so this turns a world size at a distance into pixels
+	const GLfloat kPixelsPerUnit = _camera->GetProjectionMatrix()[1][1] * viewportHeight * 0.5f;
+	const glm::vec3 kCameraPos = _camera->GetCameraPosition();
+
+	for (const TextureUsage& usage : usages) {
+		StreamedTexture* texture = FindTexture(usage.TextureID);
+		if (!texture) {
+			continue;
+		}
+
+		const GLfloat kDistance = glm::length(usage.Center - kCameraPos);
+
+		GLint level = 0;
+		if (kDistance > usage.Radius) {
+			const GLfloat kScreenSize = 2.0f * usage.Radius * kPixelsPerUnit / kDistance;
+			const GLfloat kTextureSize = (GLfloat)std::max(texture->LevelSizes[0].x, texture->LevelSizes[0].y);
+
+			level = (GLint)std::floor(std::log2(kTextureSize / std::max(kScreenSize, 1.0f)));
+			level = std::max(0, std::min(level, texture->TailLevel));
+		}
+
+		texture->RequiredLevel = std::min(texture->RequiredLevel, level);
+	}
+
+	return;
+}
+
+void TextureStreamer::FitTargetsToBudget()
+{
+	size_t totalBytes = 0;
+	for (StreamedTexture& texture : textures) {
+		texture.TargetLevel = texture.RequiredLevel;
+		totalBytes += GetBytesFromLevel(texture, texture.TargetLevel);
+	}
+
+	// Drop one level from the largest texture until everything fits
+	while (totalBytes > budgetBytes) {
+		StreamedTexture* largest = nullptr;
+		size_t largestBytes = 0;
+
+		for (StreamedTexture& texture : textures) {
+			if (texture.TargetLevel >= texture.TailLevel) {
+				continue;
+			}
+
+			const size_t kBytes = GetLevelBytes(texture, texture.TargetLevel);
+			if (kBytes > largestBytes) {
+				largest = &texture;
+				largestBytes = kBytes;
+			}
+		}
+
+		if (!largest) {
+			break;
+		}
+
+		largest->TargetLevel++;
+		totalBytes -= largestBytes;
+	}
+
+	return;
+}
+
+void TextureStreamer::StreamLevels()
+{
+	// Anything finer than its target is released first so streaming has room
+	for (StreamedTexture& texture : textures) {
+		if (texture.ResidentLevel < texture.TargetLevel) {
+			EvictLevels(texture, texture.TargetLevel);
+		}
+	}
+
+	size_t uploadedBytes = 0;
+
+	// Coarse levels first, one level per texture per pass, so every texture improves evenly
+	bool bUploaded = true;
+	while (bUploaded) {
+		bUploaded = false;
+
+		for (StreamedTexture& texture : textures) {
+			if (texture.ResidentLevel <= texture.TargetLevel) {
+				continue;
+			}
+
+			const GLint kLevel = texture.ResidentLevel - 1;
+			const size_t kBytes = GetLevelBytes(texture, kLevel);
+			if (uploadedBytes > 0 && uploadedBytes + kBytes > uploadBytesPerUpdate) {
+				return;
+			}
+			if (residentBytes + kBytes > budgetBytes) {
+				continue;
+			}
+
+			glBindTexture(GL_TEXTURE_2D, texture.TextureID);
+			UploadLevel(texture, kLevel);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			uploadedBytes += kBytes;
+			bUploaded = true;
+		}
+	}
+
+	return;
+}
+
+void TextureStreamer::UploadLevel(StreamedTexture& _texture, GLint _level)
+{
+	// Expects the texture to be bound
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D
+	(
+		GL_TEXTURE_2D,
+		_level,
+		GL_RGB8,
+		_texture.LevelSizes[_level].x,
+		_texture.LevelSizes[_level].y,
+		0,
+		GL_RGB,
+		GL_UNSIGNED_BYTE,
+		&_texture.Levels[_level][0]
+	);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, _level);
+
+	_texture.ResidentLevel = _level;
+	residentBytes += GetLevelBytes(_texture, _level);
+
+	return;
+}
+
+void TextureStreamer::EvictLevels(StreamedTexture& _texture, GLint _level)
+{
+	glBindTexture(GL_TEXTURE_2D, _texture.TextureID);
+
+	// Stop sampling the evicted levels before releasing their storage
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, _level);
+
+	for (GLint level = _texture.ResidentLevel; level < _level; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		residentBytes -= GetLevelBytes(_texture, level);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	_texture.ResidentLevel = _level;
+
+	return;
+}
+
+size_t TextureStreamer::GetLevelBytes(const StreamedTexture& _texture, GLint _level) const
+{
+	return _texture.LevelSizes[_level].x * _texture.LevelSizes[_level].y * kBytesPerTexel;
+}
+
+size_t TextureStreamer::GetBytesFromLevel(const StreamedTexture& _texture, GLint _level) const
+{
+	size_t bytes = 0;
+	for (GLint level = _level; level < (GLint)_texture.Levels.size(); level++) {
+		bytes += GetLevelBytes(_texture, level);
+	}
+
+	return bytes;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include "Dependencies/glm/glm/glm.hpp"
+
+#include "Camera.h"
+
+struct StreamedTexture
+{
+	GLuint		TextureID;		// Texture ID handed out to renderers
+	GLint		ResidentLevel;	// finest mip level currently in VRAM
+	GLint		TailLevel;		// coarsest levels from here down are always resident
+	GLint		RequiredLevel;	// finest mip level wanted by this frame's usages
+	GLint		TargetLevel;	// RequiredLevel after fitting into the budget
+	std::vector<glm::ivec2>						LevelSizes;
+	std::vector<std::vector<unsigned char>>	Levels;	// system memory copy of every mip
+};
+
+struct TextureUsage
+{
+	GLuint		TextureID;
+	glm::vec3	Center;		// world space center of the object using the texture
+	GLfloat		Radius;		// world space bounding radius of that object
+};
+
+class TextureStreamer
+{
+public:
+	TextureStreamer(size_t _budgetBytes);
+	~TextureStreamer();
+
+	GLuint getTexture(std::string _textureFileName);
+
+	void ReportUsage(GLuint _texture, glm::vec3 _center, GLfloat _radius);
+	void Update(const Camera* _camera);
+
+	void setBudget(size_t _budgetBytes);
+	void setUploadBudget(size_t _uploadBytesPerUpdate);
+
+	size_t getBudget() const;
+	size_t getResidentBytes() const;
+	size_t getPendingRequests() const;
+
+	// Framebuffer height in pixels, mips are picked for how big a texture ends up on screen
+	static void setViewportHeight(GLfloat _viewportHeight);
+
+private:
+	static GLfloat viewportHeight;
+
+	size_t budgetBytes;
+	size_t uploadBytesPerUpdate;
+	size_t residentBytes;
+
+	std::vector<StreamedTexture> textures;
+	std::vector<TextureUsage> usages;
+
+	StreamedTexture* FindTexture(GLuint _texture);
+
+	void ComputeRequiredLevels(const Camera* _camera);
+	void FitTargetsToBudget();
+	void StreamLevels();
+
+	void UploadLevel(StreamedTexture& _texture, GLint _level);
+	void EvictLevels(StreamedTexture& _texture, GLint _level);
+
+	size_t GetLevelBytes(const StreamedTexture& _texture, GLint _level) const;
+	size_t GetBytesFromLevel(const StreamedTexture& _texture, GLint _level) const;
+};
@@ -0,0 +1,173 @@
+#include "UIBatcher.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+#include "GLCallStats.h"
+
+// Public //
+
+UIBatcher::UIBatcher(GLuint _bitmapProgram, GLuint _sdfProgram)
+{
+	this->bitmapProgram = _bitmapProgram;
+	this->sdfProgram = _sdfProgram;
+	this->vboCapacity = 0;
+	this->drawCallCount = 0;
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (void*)(offsetof(UIVertex, Position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (void*)(offsetof(UIVertex, TexCoord)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(UIVertex), (void*)(offsetof(UIVertex, Color)));
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	return;
+}
+
+UIBatcher::~UIBatcher()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void UIBatcher::Begin()
+{
+	// Batches are kept between frames so their vectors keep their capacity
+	for (UIBatch& batch : batches) {
+		batch.Vertices.clear();
+	}
+
+	return;
+}
+
+void UIBatcher::AddText(TextRenderer* _text)
+{
+	Font* font = _text->getFont();
+	if (!font || !_text->isVisible()) {
+		return;
+	}
+
+	// Layout is cached by the label, this only copies its quads out with the label color
+	const TextLayout& layout = _text->getLayout();
+	if (layout.QuadCount == 0) {
+		return;
+	}
+
+	const glm::vec3 kColor = glm::clamp(_text->getColor(), 0.0f, 1.0f);
+
+	UIBatch& batch = FindBatch(font->getMode(), font->getAtlas());
+	batch.Vertices.reserve(batch.Vertices.size() + layout.QuadCount * 6);
+
+	for (size_t i = 0; i + 3 < layout.Quads.size(); i += 4) {
+		UIVertex vertex;
+		vertex.Position = glm::vec2(layout.Quads[i], layout.Quads[i + 1]);
+		vertex.TexCoord = glm::vec2(layout.Quads[i + 2], layout.Quads[i + 3]);
+		vertex.Color[0] = static_cast<GLubyte>(kColor.r * 255.0f + 0.5f);
+		vertex.Color[1] = static_cast<GLubyte>(kColor.g * 255.0f + 0.5f);
+		vertex.Color[2] = static_cast<GLubyte>(kColor.b * 255.0f + 0.5f);
+		vertex.Color[3] = 255;
+		batch.Vertices.push_back(vertex);
+	}
+
+	return;
+}
+
+void UIBatcher::Flush()
+{
+	Profiler::Zone zone("UIBatcher::Flush");
+
+	drawCallCount = 0;
+
+	// Group by program first so each program is bound once
+	std::stable_sort(batches.begin(), batches.end(), [](const UIBatch& a, const UIBatch& b) {
+		return a.Mode < b.Mode;
+	});
+
+	// Concatenate every batch into the frame's stream
+	stream.clear();
+	for (UIBatch& batch : batches) {
+		batch.First = static_cast<GLint>(stream.size());
+		stream.insert(stream.end(), batch.Vertices.begin(), batch.Vertices.end());
+	}
+
+	if (stream.empty()) {
+		return;
+	}
+
+	// One upload for the whole HUD, orphaning last frame's storage
+	const GLsizeiptr kBytes = sizeof(UIVertex) * stream.size();
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	if (kBytes > vboCapacity) {
+		vboCapacity = kBytes;
+	}
+	glBufferData(GL_ARRAY_BUFFER, vboCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, kBytes, &stream[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Blend and projection are set up once for the frame
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(vao);
+
+	const glm::vec2 kViewportSize = TextRenderer::getViewportSize();
+	const glm::mat4 kProjection = glm::ortho(0.0f, kViewportSize.x, 0.0f, kViewportSize.y);
+
+	GLuint currentProgram = 0;
+	for (const UIBatch& batch : batches) {
+		if (batch.Vertices.empty()) {
+			continue;
+		}
+
+		const GLuint kProgram = (batch.Mode == kSDF) ? sdfProgram : bitmapProgram;
+		if (kProgram != currentProgram) {
+			currentProgram = kProgram;
+			glUseProgram(currentProgram);
+			glUniformMatrix4fv(glGetUniformLocation(currentProgram, "projection"), 1, GL_FALSE, glm::value_ptr(kProjection));
+		}
+
+		glBindTexture(GL_TEXTURE_2D, batch.Texture);
+		glDrawArrays(GL_TRIANGLES, batch.First, static_cast<GLsizei>(batch.Vertices.size()));
+		drawCallCount++;
+	}
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glDisable(GL_BLEND);
+
+	return;
+}
+
+GLuint UIBatcher::getDrawCallCount() const
+{
+	return drawCallCount;
+}
+
+// Private //
+
+UIBatch& UIBatcher::FindBatch(FontRenderMode _mode, GLuint _texture)
+{
+	for (UIBatch& batch : batches) {
+		if (batch.Mode == _mode && batch.Texture == _texture) {
+			return batch;
+		}
+	}
+
+	UIBatch batch;
+	batch.Mode = _mode;
+	batch.Texture = _texture;
+	batch.First = 0;
+	batches.push_back(batch);
+
+	return batches.back();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include <GL/glew.h>
+#include "Dependencies/glm/glm/glm.hpp"
+#include "Dependencies/glm/glm/gtc/matrix_transform.hpp"
+#include "Dependencies/glm/glm/gtc/type_ptr.hpp"
+
+#include "TextRenderer.h"
+
+struct UIVertex
+{
+	glm::vec2	Position;	// viewport pixels
+	glm::vec2	TexCoord;	// atlas UV
+	GLubyte		Color[4];	// normalized rgba
+};
+
+struct UIBatch
+{
+	FontRenderMode			Mode;		// picks the program the batch is drawn with
+	GLuint					Texture;	// atlas page every vertex samples from
+	GLint					First;		// first vertex in the frame's stream
+	std::vector<UIVertex>	Vertices;
+};
+
+// Gathers every visible label of a frame into one dynamic vertex stream, one draw per atlas page
+class UIBatcher
+{
+public:
+	UIBatcher(GLuint _bitmapProgram, GLuint _sdfProgram);
+	~UIBatcher();
+
+	void Begin();
+	void AddText(TextRenderer* _text);
+	void Flush();
+
+	GLuint getDrawCallCount() const;
+
+private:
+	std::vector<UIBatch> batches;
+	std::vector<UIVertex> stream;
+
+	GLuint bitmapProgram;
+	GLuint sdfProgram;
+
+	GLuint vao;
+	GLuint vbo;
+	GLsizeiptr vboCapacity;	// in bytes
+
+	GLuint drawCallCount;
+
+	UIBatch& FindBatch(FontRenderMode _mode, GLuint _texture);
+};
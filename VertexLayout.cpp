@@ -0,0 +1,79 @@
+#include "VertexLayout.h"
+
+#include <tuple>
+
+#include "GLCallStats.h"
+
+// Only the buffer binding every layout reads from
+static const GLuint kVertexBufferBinding = 0;
+
+std::map<VertexLayout, GLuint> VertexArrayCache::vertexArrays;
+
+bool operator<(const VertexLayout& _a, const VertexLayout& _b)
+{
+	if (_a.AttributeCount != _b.AttributeCount) {
+		return _a.AttributeCount < _b.AttributeCount;
+	}
+
+	for (GLuint i = 0; i < _a.AttributeCount; i++) {
+		const VertexAttribute& kA = _a.Attributes[i];
+		const VertexAttribute& kB = _b.Attributes[i];
+		const auto kKeyA = std::make_tuple(kA.Location, kA.Size, kA.Type, kA.bNormalized, kA.Offset);
+		const auto kKeyB = std::make_tuple(kB.Location, kB.Size, kB.Type, kB.bNormalized, kB.Offset);
+		if (kKeyA != kKeyB) {
+			return kKeyA < kKeyB;
+		}
+	}
+
+	return false;
+}
+
+// Public //
+
+GLuint VertexArrayCache::getVertexArray(const VertexLayout& _layout)
+{
+	std::map<VertexLayout, GLuint>::iterator it = vertexArrays.find(_layout);
+	if (it != vertexArrays.end()) {
+		return it->second;
+	}
+
+	// The format is recorded once, buffers are attached per draw with glBindVertexBuffer
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	for (GLuint i = 0; i < _layout.AttributeCount; i++) {
+		const VertexAttribute& kAttribute = _layout.Attributes[i];
+		glEnableVertexAttribArray(kAttribute.Location);
+		glVertexAttribFormat(kAttribute.Location, kAttribute.Size, kAttribute.Type, kAttribute.bNormalized, kAttribute.Offset);
+		glVertexAttribBinding(kAttribute.Location, kVertexBufferBinding);
+	}
+
+	vertexArrays.insert(std::pair<VertexLayout, GLuint>(_layout, vao));
+
+	return vao;
+}
+
+void VertexArrayCache::Bind(const VertexLayout& _layout, GLuint _vbo, GLuint _ebo)
+{
+	glBindVertexArray(getVertexArray(_layout));
+	glBindVertexBuffer(kVertexBufferBinding, _vbo, 0, _layout.Stride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+
+	return;
+}
+
+size_t VertexArrayCache::getVertexArrayCount()
+{
+	return vertexArrays.size();
+}
+
+void VertexArrayCache::Clear()
+{
+	for (std::map<VertexLayout, GLuint>::iterator it = vertexArrays.begin(); it != vertexArrays.end(); it++) {
+		glDeleteVertexArrays(1, &it->second);
+	}
+	vertexArrays.clear();
+
+	return;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <map>
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+static const GLuint kMaxVertexAttributes = 8;
+
+struct VertexAttribute
+{
+	GLuint		Location;
+	GLint		Size;			// components
+	GLenum		Type;
+	GLboolean	bNormalized;
+	GLuint		Offset;			// bytes from the start of the vertex
+};
+
+// Attribute format of one interleaved vertex stream, read from buffer binding 0.
+// Stride belongs to the buffer binding so layouts that only differ in it share a vao.
+struct VertexLayout
+{
+	GLsizei			Stride;
+	GLuint			AttributeCount;
+	VertexAttribute	Attributes[kMaxVertexAttributes];
+};
+
+bool operator<(const VertexLayout& _a, const VertexLayout& _b);
+
+// Position and vertex color, used by the unlit Renderer and LightRenderer
+static const VertexLayout kColoredVertexLayout = {
+	sizeof(Vertex), 2, {
+		{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position) },
+		{ 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, color) },
+	}
+};
+
+// Position, texture coordinate and normal, used by MeshRenderer
+static const VertexLayout kLitVertexLayout = {
+	sizeof(Vertex), 3, {
+		{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position) },
+		{ 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture_coordinate) },
+		{ 2, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) },
+	}
+};
+
+// One vao per distinct layout shared by every mesh using it, drawing another mesh only rebinds its buffers
+class VertexArrayCache
+{
+public:
+	// Created the first time a layout is asked for
+	static GLuint getVertexArray(const VertexLayout& _layout);
+	// Binds the layout's vao with _vbo on binding 0 and _ebo as the element buffer
+	static void Bind(const VertexLayout& _layout, GLuint _vbo, GLuint _ebo);
+
+	static size_t getVertexArrayCount();
+	static void Clear();
+
+private:
+	static std::map<VertexLayout, GLuint> vertexArrays;
+};
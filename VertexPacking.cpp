@@ -0,0 +1,170 @@
+#include "VertexPacking.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "Dependencies/glm/glm/gtc/packing.hpp"
+
+static GLushort PackUnorm16(float _value)
+{
+	return static_cast<GLushort>(std::floor(glm::clamp(_value, 0.0f, 1.0f) * 65535.0f + 0.5f));
+}
+
+static float UnpackUnorm16(GLushort _value)
+{
+	return _value / 65535.0f;
+}
+
+static GLshort PackSnorm16(float _value)
+{
+	return static_cast<GLshort>(std::floor(glm::clamp(_value, -1.0f, 1.0f) * 32767.0f + 0.5f));
+}
+
+// Matches GL's snorm conversion, -32768 and -32767 both decode to -1
+static float UnpackSnorm16(GLshort _value)
+{
+	return glm::max(_value / 32767.0f, -1.0f);
+}
+
+static float AngleDegrees(glm::vec3 _a, glm::vec3 _b)
+{
+	// atan2 keeps precision for the tiny angles acos rounds to zero
+	return glm::degrees(std::atan2(glm::length(glm::cross(_a, _b)), glm::dot(_a, _b)));
+}
+
+// Public //
+
+PackedVertexError VertexPacking::Encode(const std::vector<Vertex>& _vertices, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds)
+{
+	PackedVertexError error = { 0.0f, 0.0f, 0.0f };
+
+	packed.clear();
+	bounds.Min = glm::vec3(0.0f);
+	bounds.Extent = glm::vec3(0.0f);
+
+	if (_vertices.empty()) {
+		return error;
+	}
+
+	glm::vec3 boundsMax = _vertices[0].position;
+	bounds.Min = _vertices[0].position;
+	for (const Vertex& vertex : _vertices) {
+		bounds.Min = glm::min(bounds.Min, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	bounds.Extent = boundsMax - bounds.Min;
+
+	// Flat axes still need a non zero extent to divide by
+	const glm::vec3 kScale = glm::vec3(
+		bounds.Extent.x > 0.0f ? 1.0f / bounds.Extent.x : 0.0f,
+		bounds.Extent.y > 0.0f ? 1.0f / bounds.Extent.y : 0.0f,
+		bounds.Extent.z > 0.0f ? 1.0f / bounds.Extent.z : 0.0f
+	);
+
+	packed.resize(_vertices.size());
+	for (size_t i = 0; i < _vertices.size(); i++) {
+		const Vertex& vertex = _vertices[i];
+		PackedVertex& out = packed[i];
+
+		const glm::vec3 kPosition = (vertex.position - bounds.Min) * kScale;
+		out.Position[0] = PackUnorm16(kPosition.x);
+		out.Position[1] = PackUnorm16(kPosition.y);
+		out.Position[2] = PackUnorm16(kPosition.z);
+		out.Position[3] = 0;
+
+		const glm::vec2 kNormal = EncodeOctahedral(vertex.normal);
+		out.Normal[0] = PackSnorm16(kNormal.x);
+		out.Normal[1] = PackSnorm16(kNormal.y);
+
+		out.TexCoord[0] = glm::packHalf1x16(vertex.texture_coordinate.x);
+		out.TexCoord[1] = glm::packHalf1x16(vertex.texture_coordinate.y);
+
+		const Vertex kDecoded = Decode(out, bounds);
+		error.MaxPosition = glm::max(error.MaxPosition, glm::length(kDecoded.position - vertex.position));
+		if (glm::length(vertex.normal) > 0.0f) {
+			error.MaxNormalDegrees = glm::max(error.MaxNormalDegrees, AngleDegrees(kDecoded.normal, glm::normalize(vertex.normal)));
+		}
+		error.MaxTexCoord = glm::max(error.MaxTexCoord, glm::length(kDecoded.texture_coordinate - vertex.texture_coordinate));
+	}
+
+	std::cout << "Vertex Packing : " << _vertices.size() << " vertices, "
+		<< sizeof(Vertex) << " -> " << sizeof(PackedVertex) << " bytes each, max error position "
+		<< error.MaxPosition << ", normal " << error.MaxNormalDegrees << " degrees, uv "
+		<< error.MaxTexCoord << std::endl;
+
+	return error;
+}
+
+Vertex VertexPacking::Decode(const PackedVertex& _packed, const PackedVertexBounds& _bounds)
+{
+	Vertex vertex;
+
+	vertex.position = _bounds.Min + glm::vec3(
+		UnpackUnorm16(_packed.Position[0]),
+		UnpackUnorm16(_packed.Position[1]),
+		UnpackUnorm16(_packed.Position[2])
+	) * _bounds.Extent;
+
+	vertex.normal = DecodeOctahedral(glm::vec2(UnpackSnorm16(_packed.Normal[0]), UnpackSnorm16(_packed.Normal[1])));
+	vertex.color = glm::vec3(1.0f, 1.0f, 1.0f);
+	vertex.texture_coordinate = glm::vec2(glm::unpackHalf1x16(_packed.TexCoord[0]), glm::unpackHalf1x16(_packed.TexCoord[1]));
+
+	return vertex;
+}
+
+glm::vec2 VertexPacking::EncodeOctahedral(glm::vec3 _normal)
+{
+	const float kLength = std::fabs(_normal.x) + std::fabs(_normal.y) + std::fabs(_normal.z);
+	if (kLength <= 0.0f) {
+		return glm::vec2(0.0f, 0.0f);
+	}
+
+	// Project onto the octahedron, then fold the lower half over the diagonals
+	glm::vec3 n = _normal / kLength;
+	glm::vec2 encoded = glm::vec2(n.x, n.y);
+	if (n.z < 0.0f) {
+		encoded = glm::vec2(
+			(1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+		);
+	}
+
+	// Rounding each component on its own isn't always closest, try the neighbouring snorm16 values
+	const glm::vec3 kTarget = glm::normalize(_normal);
+	const glm::vec2 kFloor = glm::vec2(
+		std::floor(glm::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f),
+		std::floor(glm::clamp(encoded.y, -1.0f, 1.0f) * 32767.0f)
+	);
+
+	glm::vec2 best = encoded;
+	float bestDot = -2.0f;
+	for (int dy = 0; dy <= 1; dy++) {
+		for (int dx = 0; dx <= 1; dx++) {
+			const glm::vec2 kCandidate = glm::vec2(
+				glm::clamp((kFloor.x + dx) / 32767.0f, -1.0f, 1.0f),
+				glm::clamp((kFloor.y + dy) / 32767.0f, -1.0f, 1.0f)
+			);
+			const float kDot = glm::dot(DecodeOctahedral(kCandidate), kTarget);
+			if (kDot > bestDot) {
+				bestDot = kDot;
+				best = kCandidate;
+			}
+		}
+	}
+
+	return best;
+}
+
+glm::vec3 VertexPacking::DecodeOctahedral(glm::vec2 _encoded)
+{
+	glm::vec3 n = glm::vec3(_encoded.x, _encoded.y, 1.0f - std::fabs(_encoded.x) - std::fabs(_encoded.y));
+	if (n.z < 0.0f) {
+		const float kX = n.x;
+		n.x = (1.0f - std::fabs(n.y)) * (kX >= 0.0f ? 1.0f : -1.0f);
+		n.y = (1.0f - std::fabs(kX)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return glm::normalize(n);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+// 16 byte alternative to the 44 byte Vertex, color is dropped since no renderer binds it
+struct PackedVertex
+{
+	GLushort	Position[4];	// unorm16 inside the mesh bounds, w is padding
+	GLshort		Normal[2];		// octahedral encoded, snorm16
+	GLhalf		TexCoord[2];	// half float
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Same locations as kLitVertexLayout, the program must decode it like LitTexturedModelPacked.vs
+static const VertexLayout kPackedVertexLayout = {
+	sizeof(PackedVertex), 3, {
+		{ 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, Position) },
+		{ 1, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, TexCoord) },
+		{ 2, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, Normal) },
+	}
+};
+
+// Positions decode as Min + position * Extent, passed to the shader as uniforms
+struct PackedVertexBounds
+{
+	glm::vec3	Min;
+	glm::vec3	Extent;
+};
+
+// Worst case round trip error over every vertex of a mesh
+struct PackedVertexError
+{
+	float	MaxPosition;		// world units
+	float	MaxNormalDegrees;
+	float	MaxTexCoord;
+};
+
+class VertexPacking
+{
+public:
+	static PackedVertexError Encode(const std::vector<Vertex>& _vertices, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds);
+	// CPU mirror of the shader decode, used for the error report
+	static Vertex Decode(const PackedVertex& _packed, const PackedVertexBounds& _bounds);
+
+	static glm::vec2 EncodeOctahedral(glm::vec3 _normal);
+	static glm::vec3 DecodeOctahedral(glm::vec2 _encoded);
+};
@@ -0,0 +1,107 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Profiler.h"
+
+WorkerPool::WorkerPool(unsigned int _threadCount)
+{
+	this->task = nullptr;
+	this->taskCount = 0;
+	this->nextTask = 0;
+	this->remainingTasks = 0;
+	this->bStopping = false;
+
+	for (unsigned int i = 1; i < std::max(1u, _threadCount); i++) {
+		workers.push_back(std::thread(&WorkerPool::WorkerLoop, this, i));
+	}
+
+	return;
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bStopping = true;
+	}
+	wake.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+void WorkerPool::Run(unsigned int _taskCount, const std::function<void(unsigned int)>& _task)
+{
+	if (_taskCount == 0) {
+		return;
+	}
+
+	// Nothing to hand out, skip the locking
+	if (_taskCount == 1 || workers.empty()) {
+		for (unsigned int i = 0; i < _taskCount; i++) {
+			_task(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock(runMutex);
+	std::unique_lock<std::mutex> lock(mutex);
+	task = &_task;
+	taskCount = _taskCount;
+	nextTask = 0;
+	remainingTasks = _taskCount;
+	wake.notify_all();
+
+	// The calling thread takes tasks too rather than sitting idle
+	while (nextTask < taskCount) {
+		const unsigned int kTask = nextTask++;
+		lock.unlock();
+		_task(kTask);
+		lock.lock();
+		remainingTasks--;
+	}
+
+	done.wait(lock, [this]() { return remainingTasks == 0; });
+	task = nullptr;
+	taskCount = 0;
+	nextTask = 0;
+
+	return;
+}
+
+unsigned int WorkerPool::getThreadCount() const
+{
+	return static_cast<unsigned int>(workers.size()) + 1;
+}
+
+WorkerPool& WorkerPool::getShared()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+void WorkerPool::WorkerLoop(unsigned int _index)
+{
+	Profiler::setThreadName("Worker " + std::to_string(_index));
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		wake.wait(lock, [this]() { return bStopping || nextTask < taskCount; });
+		if (bStopping) {
+			return;
+		}
+
+		const unsigned int kTask = nextTask++;
+		const std::function<void(unsigned int)>* kJob = task;
+		lock.unlock();
+		(*kJob)(kTask);
+		lock.lock();
+
+		if (--remainingTasks == 0) {
+			done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Threads started once and kept alive, per frame work hands them tasks instead of creating threads each call
+class WorkerPool
+{
+public:
+	// _threadCount includes the thread calling Run, so one less worker is started
+	explicit WorkerPool(unsigned int _threadCount);
+	~WorkerPool();
+
+	// Calls _task(i) for every i below _taskCount across the workers and the calling thread, returns once all are done.
+	// Runs from different threads take turns, a task must not call Run on the same pool.
+	void Run(unsigned int _taskCount, const std::function<void(unsigned int)>& _task);
+
+	unsigned int getThreadCount() const;
+
+	// One pool sized to the hardware threads, shared by every system, started on first use
+	static WorkerPool& getShared();
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex runMutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// Guarded by mutex
+	const std::function<void(unsigned int)>* task;
+	unsigned int taskCount;
+	unsigned int nextTask;
+	unsigned int remainingTasks;
+	bool bStopping;
+
+	void WorkerLoop(unsigned int _index);
+
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+};